@@ -41,8 +41,10 @@
 #include <stdio.h>
 
 #include "antelope.h"
+#include "relation.h"
 
 static db_output_function_t output = printf;
+static relation_t *insert_rel;
 
 void
 db_init(void)
@@ -158,3 +160,52 @@ db_processing(db_handle_t *handle)
 {
   return handle->flags & DB_HANDLE_FLAG_PROCESSING;
 }
+
+db_result_t
+db_insert_begin(char *name)
+{
+  db_result_t result;
+
+  if(insert_rel != NULL) {
+    result = db_insert_end();
+    if(DB_ERROR(result)) {
+      return result;
+    }
+  }
+
+  insert_rel = relation_load(name);
+  if(insert_rel == NULL) {
+    return DB_NAME_ERROR;
+  }
+
+  result = relation_insert_begin(insert_rel);
+  if(DB_ERROR(result)) {
+    relation_release(insert_rel);
+    insert_rel = NULL;
+  }
+  return result;
+}
+
+db_result_t
+db_insert_sync(void)
+{
+  if(insert_rel == NULL) {
+    return DB_OK;
+  }
+  return relation_insert_flush(insert_rel);
+}
+
+db_result_t
+db_insert_end(void)
+{
+  db_result_t result;
+
+  if(insert_rel == NULL) {
+    return DB_OK;
+  }
+
+  result = relation_insert_end(insert_rel);
+  relation_release(insert_rel);
+  insert_rel = NULL;
+  return result;
+}
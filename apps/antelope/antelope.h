@@ -49,5 +49,8 @@ const char *db_get_result_message(db_result_t code);
 db_result_t db_print_header(db_handle_t *handle);
 db_result_t db_print_tuple(db_handle_t *handle);
 int db_processing(db_handle_t *handle);
+db_result_t db_insert_begin(char *relation);
+db_result_t db_insert_sync(void);
+db_result_t db_insert_end(void);
 
 #endif /* DB_H */
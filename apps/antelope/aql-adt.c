@@ -120,6 +120,26 @@ aql_add_attribute(aql_adt_t *adt, char *name, domain_t domain,
   return DB_OK;
 }
 
+db_result_t
+aql_set_group(aql_adt_t *adt, char *name)
+{
+  aql_attribute_t *attr;
+
+  /* The grouping attribute need not be projected into the result. */
+  attr = get_attribute(adt, name);
+  if(attr == NULL) {
+    if(DB_ERROR(aql_add_attribute(adt, name, DOMAIN_UNSPECIFIED, 0, 1))) {
+      return DB_LIMIT_ERROR;
+    }
+    attr = &adt->attributes[adt->attribute_count - 1];
+  }
+
+  adt->group_attribute = attr - adt->attributes;
+  adt->flags |= AQL_FLAG_GROUP | AQL_FLAG_AGGREGATE;
+
+  return DB_OK;
+}
+
 db_result_t
 aql_add_value(aql_adt_t *adt, domain_t domain, void *value_ptr)
 {
@@ -90,6 +90,13 @@ aql_execute(db_handle_t *handle, aql_adt_t *adt)
     if(rel == NULL) {
       return DB_NAME_ERROR;
     }
+
+    /* Make the rows and index entries of an ongoing insertion batch
+       visible to every operation except further insertions. */
+    if(optype != AQL_TYPE_INSERT && DB_ERROR(relation_insert_flush(rel))) {
+      relation_release(rel);
+      return DB_STORAGE_ERROR;
+    }
   } else {
     rel = NULL;
   }
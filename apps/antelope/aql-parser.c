@@ -494,6 +494,11 @@ PARSER(select)
   }
 
   NEXT;
+  if(TOKEN != WHERE && TOKEN != GROUP) {
+    REWIND;
+    RETURN(OK);
+  }
+
   if(TOKEN == WHERE) {
     lvm_reset(&p, vmcode, sizeof(vmcode));
 
@@ -502,9 +507,19 @@ PARSER(select)
     }
 
     AQL_SET_CONDITION(adt, &p);
+    NEXT;
+  }
+
+  if(TOKEN == GROUP) {
+    CONSUME(BY);
+    CONSUME(IDENTIFIER);
+
+    PRINTF("Group by attribute %s\n", VALUE);
+    if(DB_ERROR(AQL_SET_GROUP(adt, VALUE))) {
+      RETURN(SYNTAX_ERROR);
+    }
   } else {
     REWIND;
-    RETURN(OK);
   }
 
   CONSUME(END);
@@ -645,6 +660,9 @@ PARSER_TOKEN(index_type)
   case MEMHASH:
     type = INDEX_MEMHASH;
     break;
+  case BTREE:
+    type = INDEX_BTREE;
+    break;
   default:
     return NONE;
   };
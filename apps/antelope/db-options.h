@@ -152,6 +152,25 @@
 #define DB_MAX_CHAR_SIZE_PER_ROW	64
 #endif /* DB_MAX_CHAR_SIZE_PER_ROW */
 
+/* The size of the buffer used for reading ahead rows during
+   sequential scans. Set to 0 to read one row at a time. */
+#ifndef DB_STORAGE_BLOCK_SIZE
+#define DB_STORAGE_BLOCK_SIZE		128
+#endif /* DB_STORAGE_BLOCK_SIZE */
+
+/* The size of the buffer used for rows inserted in a batch, which are
+   appended to storage in a single write. Set to 0 to write each row
+   immediately. */
+#ifndef DB_INSERT_BUFFER_SIZE
+#define DB_INSERT_BUFFER_SIZE		128
+#endif /* DB_INSERT_BUFFER_SIZE */
+
+/* The maximum number of index updates deferred during a batch of
+   insertions. */
+#ifndef DB_INSERT_INDEX_BUFFER
+#define DB_INSERT_INDEX_BUFFER		8
+#endif /* DB_INSERT_INDEX_BUFFER */
+
 /* The maximum file name length to use for creating various database file. */
 #ifndef DB_MAX_FILENAME_LENGTH
 #define DB_MAX_FILENAME_LENGTH		16
@@ -180,6 +199,37 @@
 
 /*----------------------------------------------------------------------------*/
 
+/* Join options. */
+
+/* The amount of RAM used for holding rows of the smaller relation in
+   a hash join. Larger relations are joined in several passes. Set to
+   0 to disable hash joins. */
+#ifndef DB_JOIN_HASH_MEMORY
+#define DB_JOIN_HASH_MEMORY		256
+#endif /* DB_JOIN_HASH_MEMORY */
+
+/* The number of buckets in the hash join table. Must be a power of 2. */
+#ifndef DB_JOIN_HASH_BUCKETS
+#define DB_JOIN_HASH_BUCKETS		16
+#endif /* DB_JOIN_HASH_BUCKETS */
+
+/*----------------------------------------------------------------------------*/
+
+/* Aggregation options. */
+
+/* The maximum number of groups aggregated in one pass over a relation.
+   Queries with more groups scan the relation several times. */
+#ifndef DB_GROUP_LIMIT
+#define DB_GROUP_LIMIT			8
+#endif /* DB_GROUP_LIMIT */
+
+/* The number of buckets in the group table. Must be a power of 2. */
+#ifndef DB_GROUP_BUCKETS
+#define DB_GROUP_BUCKETS		8
+#endif /* DB_GROUP_BUCKETS */
+
+/*----------------------------------------------------------------------------*/
+
 /* Index options. */
 
 #ifndef DB_INDEX_COST
@@ -206,6 +256,27 @@
 #define DB_HEAP_CACHE_LIMIT		1
 #endif /* DB_HEAP_CACHE_LIMIT */
 
+/* The maximum number of B+-tree indexes. */
+#ifndef DB_BTREE_INDEX_LIMIT
+#define DB_BTREE_INDEX_LIMIT		1
+#endif /* DB_BTREE_INDEX_LIMIT */
+
+/* The size of a B+-tree node in bytes. A node may hold at most 255
+   entries. */
+#ifndef DB_BTREE_NODE_SIZE
+#define DB_BTREE_NODE_SIZE		128
+#endif /* DB_BTREE_NODE_SIZE */
+
+/* The maximum number of nodes in a B+-tree index file. */
+#ifndef DB_BTREE_NODE_LIMIT
+#define DB_BTREE_NODE_LIMIT		1024
+#endif /* DB_BTREE_NODE_LIMIT */
+
+/* The number of B+-tree nodes cached in RAM. */
+#ifndef DB_BTREE_CACHE_LIMIT
+#define DB_BTREE_CACHE_LIMIT		4
+#endif /* DB_BTREE_CACHE_LIMIT */
+
 /*----------------------------------------------------------------------------*/
 
 /* LVM options. */
@@ -222,6 +293,12 @@
 #define LVM_MAX_VARIABLE_ID		AQL_ATTRIBUTE_LIMIT - 1
 #endif /* LVM_MAX_VARIABLE_ID */
 
+/* The maximum number of "variable op constant" comparisons in a
+   condition that the LVM evaluates without interpreting the code. */
+#ifndef LVM_MAX_SIMPLE_COMPARISONS
+#define LVM_MAX_SIMPLE_COMPARISONS	4
+#endif /* LVM_MAX_SIMPLE_COMPARISONS */
+
 /* Specify whether floats should be used or not inside the LVM. */
 #ifndef LVM_USE_FLOATS
 #define LVM_USE_FLOATS			DB_FEATURE_FLOATS
@@ -0,0 +1,751 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *     A B+-tree index for flash memory.
+ *
+ *     The tree is stored in a single file of fixed-size nodes. Inner
+ *     nodes hold sorted separator keys and are rewritten only when one
+ *     of their children is split. Leaves are append-only: a new entry
+ *     is written into the first unused slot of its leaf, so an insertion
+ *     normally costs one small write to previously unwritten flash. The
+ *     entries within a leaf are consequently unsorted; they get sorted
+ *     when the leaf is split. Leaves are linked to their right siblings,
+ *     so a range query is a single descent followed by a leaf walk.
+ *
+ *     The root is always stored in node 0. When the root is split, its
+ *     contents are moved into two new nodes, which means that the
+ *     location of the root never has to be written to storage.
+ *
+ *     Deletions remove entries from the leaves but do not rebalance
+ *     the tree.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cfs/cfs.h"
+#include "lib/memb.h"
+
+#include "db-options.h"
+#include "index.h"
+#include "result.h"
+#include "storage.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/uip-debug.h"
+
+typedef long btree_key_t;
+typedef uint16_t btree_node_id_t;
+
+#define ROOT_NODE	0
+#define NODE_FREE	0
+#define NODE_LEAF	1
+#define NODE_INNER	2
+
+/* The maximum height of the tree. */
+#define MAX_DEPTH	8
+
+struct node_header {
+  uint8_t type;
+  /* The number of keys in an inner node. Leaves find their number of
+     entries by looking for the first unused slot instead. */
+  uint8_t count;
+  /* The right sibling of a leaf, or 0 if it is the last leaf. */
+  btree_node_id_t next;
+};
+
+struct leaf_entry {
+  btree_key_t key;
+  /* The tuple ID plus one, so that unused slots read as zero. */
+  tuple_id_t value;
+};
+
+#define LEAF_CAPACITY	((DB_BTREE_NODE_SIZE - sizeof(struct node_header)) / \
+			 sizeof(struct leaf_entry))
+#define INNER_CAPACITY	((DB_BTREE_NODE_SIZE - sizeof(struct node_header) - \
+			  sizeof(btree_node_id_t)) /			\
+			 (sizeof(btree_key_t) + sizeof(btree_node_id_t)))
+
+struct node {
+  struct node_header header;
+  union {
+    struct leaf_entry entries[LEAF_CAPACITY];
+    struct {
+      btree_key_t keys[INNER_CAPACITY];
+      btree_node_id_t children[INNER_CAPACITY + 1];
+    } inner;
+  } u;
+};
+
+#define NODE_OFFSET(id)	((unsigned long)(id) * sizeof(struct node))
+
+struct btree {
+  db_storage_id_t storage;
+  btree_node_id_t next_free_node;
+};
+typedef struct btree btree_t;
+
+struct node_cache {
+  btree_t *tree;
+  btree_node_id_t id;
+  uint8_t count;
+  uint8_t last_use;
+  struct node node;
+};
+
+static struct node_cache node_cache[DB_BTREE_CACHE_LIMIT];
+static uint8_t cache_clock;
+
+MEMB(trees, btree_t, DB_BTREE_INDEX_LIMIT);
+
+/* Scratch space for splitting nodes. */
+static struct node work_node;
+static struct leaf_entry split_entries[LEAF_CAPACITY + 1];
+static btree_key_t split_keys[INNER_CAPACITY + 1];
+static btree_node_id_t split_children[INNER_CAPACITY + 2];
+
+static db_result_t create(index_t *);
+static db_result_t destroy(index_t *);
+static db_result_t load(index_t *);
+static db_result_t release(index_t *);
+static db_result_t insert(index_t *, attribute_value_t *, tuple_id_t);
+static db_result_t delete(index_t *, attribute_value_t *);
+static tuple_id_t get_next(index_iterator_t *);
+
+index_api_t index_btree = {
+  INDEX_BTREE,
+  INDEX_API_EXTERNAL | INDEX_API_RANGE_QUERIES,
+  create,
+  destroy,
+  load,
+  release,
+  insert,
+  delete,
+  get_next
+};
+
+static struct node_cache *
+cache_get(btree_t *tree, btree_node_id_t id)
+{
+  struct node_cache *cache;
+  struct node_cache *victim;
+
+  victim = &node_cache[0];
+  for(cache = node_cache; cache < node_cache + DB_BTREE_CACHE_LIMIT; cache++) {
+    if(cache->tree == tree && cache->id == id) {
+      cache->last_use = ++cache_clock;
+      return cache;
+    }
+    if(cache->tree == NULL) {
+      victim = cache;
+    } else if(victim->tree != NULL &&
+              (uint8_t)(cache_clock - cache->last_use) >
+              (uint8_t)(cache_clock - victim->last_use)) {
+      victim = cache;
+    }
+  }
+
+  victim->tree = NULL;
+  victim->id = id;
+  victim->last_use = ++cache_clock;
+  return victim;
+}
+
+static void
+cache_invalidate(btree_t *tree)
+{
+  int i;
+
+  for(i = 0; i < DB_BTREE_CACHE_LIMIT; i++) {
+    if(node_cache[i].tree == tree) {
+      node_cache[i].tree = NULL;
+    }
+  }
+}
+
+static uint8_t
+node_count(struct node *node)
+{
+  uint8_t count;
+
+  if(node->header.type != NODE_LEAF) {
+    return node->header.count;
+  }
+
+  for(count = 0; count < LEAF_CAPACITY; count++) {
+    if(node->u.entries[count].value == 0) {
+      break;
+    }
+  }
+  return count;
+}
+
+static struct node_cache *
+node_load(btree_t *tree, btree_node_id_t id)
+{
+  struct node_cache *cache;
+
+  cache = cache_get(tree, id);
+  if(cache->tree == tree) {
+    return cache;
+  }
+
+  if(DB_ERROR(storage_read(tree->storage, &cache->node,
+                           NODE_OFFSET(id), sizeof(cache->node)))) {
+    PRINTF("DB: Failed to read B+-tree node %u\n", (unsigned)id);
+    return NULL;
+  }
+
+  cache->tree = tree;
+  cache->count = node_count(&cache->node);
+  return cache;
+}
+
+static int
+node_write(btree_t *tree, btree_node_id_t id, struct node *node)
+{
+  struct node_cache *cache;
+
+  if(DB_ERROR(storage_write(tree->storage, node,
+                            NODE_OFFSET(id), sizeof(*node)))) {
+    PRINTF("DB: Failed to write B+-tree node %u\n", (unsigned)id);
+    return 0;
+  }
+
+  cache = cache_get(tree, id);
+  if(&cache->node != node) {
+    memcpy(&cache->node, node, sizeof(cache->node));
+  }
+  cache->tree = tree;
+  cache->count = node_count(node);
+  return 1;
+}
+
+static btree_node_id_t
+node_allocate(btree_t *tree)
+{
+  if(tree->next_free_node >= DB_BTREE_NODE_LIMIT) {
+    PRINTF("DB: No more B+-tree nodes available\n");
+    return ROOT_NODE;
+  }
+  return tree->next_free_node++;
+}
+
+static void
+make_leaf(struct node *node, struct leaf_entry *entries, int count,
+          btree_node_id_t next)
+{
+  memset(node, 0, sizeof(*node));
+  node->header.type = NODE_LEAF;
+  node->header.next = next;
+  memcpy(node->u.entries, entries, count * sizeof(*entries));
+}
+
+static void
+make_inner(struct node *node, btree_key_t *keys, btree_node_id_t *children,
+           int count)
+{
+  memset(node, 0, sizeof(*node));
+  node->header.type = NODE_INNER;
+  node->header.count = count;
+  memcpy(node->u.inner.keys, keys, count * sizeof(*keys));
+  memcpy(node->u.inner.children, children, (count + 1) * sizeof(*children));
+}
+
+/* Find the child of an inner node that may contain the key. With
+   leftmost set, the search stops at the first child that can hold
+   the key, which is where range queries must begin when there are
+   duplicate keys. Insertions go to the last such child. */
+static btree_node_id_t
+find_child(struct node_cache *cache, btree_key_t key, int leftmost)
+{
+  int i;
+
+  for(i = 0; i < cache->count; i++) {
+    if(leftmost ? key <= cache->node.u.inner.keys[i] :
+       key < cache->node.u.inner.keys[i]) {
+      break;
+    }
+  }
+  return cache->node.u.inner.children[i];
+}
+
+static int
+find_leaf(btree_t *tree, btree_key_t key, int leftmost,
+          btree_node_id_t *path, int *depth)
+{
+  struct node_cache *cache;
+  btree_node_id_t id;
+
+  for(id = ROOT_NODE, *depth = 0;; (*depth)++) {
+    cache = node_load(tree, id);
+    if(cache == NULL || *depth >= MAX_DEPTH) {
+      return -1;
+    }
+    path[*depth] = id;
+    if(cache->node.header.type == NODE_LEAF) {
+      return id;
+    }
+    id = find_child(cache, key, leftmost);
+  }
+}
+
+static int
+split_root(btree_t *tree, struct node *left, struct node *right,
+           btree_key_t separator)
+{
+  btree_node_id_t children[2];
+
+  children[0] = node_allocate(tree);
+  children[1] = node_allocate(tree);
+  if(children[0] == ROOT_NODE || children[1] == ROOT_NODE) {
+    return 0;
+  }
+
+  if(left->header.type == NODE_LEAF) {
+    left->header.next = children[1];
+  }
+
+  if(node_write(tree, children[0], left) == 0 ||
+     node_write(tree, children[1], right) == 0) {
+    return 0;
+  }
+
+  make_inner(&work_node, &separator, children, 1);
+  return node_write(tree, ROOT_NODE, &work_node);
+}
+
+static int
+insert_into_parent(btree_t *tree, btree_node_id_t *path, int depth,
+                   btree_key_t key, btree_node_id_t child)
+{
+  static struct node right;
+  struct node_cache *cache;
+  btree_node_id_t id;
+  btree_node_id_t new_id;
+  int count;
+  int i;
+  int mid;
+
+  while(depth-- > 0) {
+    id = path[depth];
+    cache = node_load(tree, id);
+    if(cache == NULL) {
+      return 0;
+    }
+
+    count = cache->count;
+    for(i = 0; i < count; i++) {
+      if(key < cache->node.u.inner.keys[i]) {
+        break;
+      }
+    }
+
+    memcpy(split_keys, cache->node.u.inner.keys, i * sizeof(btree_key_t));
+    memcpy(split_children, cache->node.u.inner.children,
+           (i + 1) * sizeof(btree_node_id_t));
+    split_keys[i] = key;
+    split_children[i + 1] = child;
+    memcpy(&split_keys[i + 1], &cache->node.u.inner.keys[i],
+           (count - i) * sizeof(btree_key_t));
+    memcpy(&split_children[i + 2], &cache->node.u.inner.children[i + 1],
+           (count - i) * sizeof(btree_node_id_t));
+    count++;
+
+    if(count <= INNER_CAPACITY) {
+      make_inner(&work_node, split_keys, split_children, count);
+      return node_write(tree, id, &work_node);
+    }
+
+    /* The inner node is full; promote its middle key. */
+    mid = count / 2;
+    make_inner(&work_node, split_keys, split_children, mid);
+    make_inner(&right, &split_keys[mid + 1], &split_children[mid + 1],
+               count - mid - 1);
+    key = split_keys[mid];
+
+    if(id == ROOT_NODE) {
+      return split_root(tree, &work_node, &right, key);
+    }
+
+    new_id = node_allocate(tree);
+    if(new_id == ROOT_NODE ||
+       node_write(tree, id, &work_node) == 0 ||
+       node_write(tree, new_id, &right) == 0) {
+      return 0;
+    }
+    child = new_id;
+  }
+
+  return 0;
+}
+
+static int
+split_leaf(btree_t *tree, btree_node_id_t *path, int depth,
+           struct leaf_entry *entry)
+{
+  static struct node right;
+  struct node_cache *cache;
+  struct leaf_entry tmp;
+  btree_node_id_t id;
+  btree_node_id_t new_id;
+  int count;
+  int half;
+  int i, j;
+
+  id = path[depth];
+  cache = node_load(tree, id);
+  if(cache == NULL) {
+    return 0;
+  }
+
+  /* Sort the entries of the full leaf together with the new one. */
+  count = cache->count;
+  memcpy(split_entries, cache->node.u.entries, count * sizeof(*entry));
+  split_entries[count++] = *entry;
+  for(i = 1; i < count; i++) {
+    tmp = split_entries[i];
+    for(j = i; j > 0 && split_entries[j - 1].key > tmp.key; j--) {
+      split_entries[j] = split_entries[j - 1];
+    }
+    split_entries[j] = tmp;
+  }
+
+  half = count / 2;
+  PRINTF("DB: Split B+-tree leaf %u at key %ld\n", (unsigned)id,
+         (long)split_entries[half].key);
+
+  make_leaf(&right, &split_entries[half], count - half,
+            cache->node.header.next);
+
+  if(id == ROOT_NODE) {
+    make_leaf(&work_node, split_entries, half, 0);
+    return split_root(tree, &work_node, &right, split_entries[half].key);
+  }
+
+  new_id = node_allocate(tree);
+  if(new_id == ROOT_NODE) {
+    return 0;
+  }
+  make_leaf(&work_node, split_entries, half, new_id);
+
+  if(node_write(tree, new_id, &right) == 0 ||
+     node_write(tree, id, &work_node) == 0) {
+    return 0;
+  }
+
+  return insert_into_parent(tree, path, depth, split_entries[half].key,
+                            new_id);
+}
+
+static int
+leaf_append(btree_t *tree, struct node_cache *cache, struct leaf_entry *entry)
+{
+  if(DB_ERROR(storage_write(tree->storage, entry,
+                            NODE_OFFSET(cache->id) +
+                            offsetof(struct node, u.entries) +
+                            cache->count * sizeof(*entry),
+                            sizeof(*entry)))) {
+    return 0;
+  }
+
+  cache->node.u.entries[cache->count++] = *entry;
+  return 1;
+}
+
+static db_result_t
+create(index_t *index)
+{
+  btree_t *tree;
+  char *filename;
+
+  filename = storage_generate_file("btree",
+                                   DB_BTREE_NODE_LIMIT * sizeof(struct node));
+  if(filename == NULL) {
+    PRINTF("DB: Failed to generate a B+-tree file\n");
+    return DB_INDEX_ERROR;
+  }
+
+  memcpy(index->descriptor_file, filename, sizeof(index->descriptor_file));
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    cfs_remove(index->descriptor_file);
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  tree->next_free_node = ROOT_NODE + 1;
+  if(tree->storage < 0) {
+    memb_free(&trees, tree);
+    index->opaque_data = NULL;
+    cfs_remove(index->descriptor_file);
+    return DB_STORAGE_ERROR;
+  }
+
+  cache_invalidate(tree);
+  make_leaf(&work_node, NULL, 0, 0);
+  if(node_write(tree, ROOT_NODE, &work_node) == 0) {
+    release(index);
+    cfs_remove(index->descriptor_file);
+    return DB_STORAGE_ERROR;
+  }
+
+  PRINTF("DB: Created a B+-tree index in %s (%u entries per leaf, %u keys per inner node)\n",
+         index->descriptor_file, (unsigned)LEAF_CAPACITY,
+         (unsigned)INNER_CAPACITY);
+
+  return DB_OK;
+}
+
+static db_result_t
+destroy(index_t *index)
+{
+  if(index->opaque_data != NULL) {
+    release(index);
+  }
+  cfs_remove(index->descriptor_file);
+  return DB_OK;
+}
+
+static db_result_t
+load(index_t *index)
+{
+  btree_t *tree;
+  btree_node_id_t low;
+  btree_node_id_t high;
+  btree_node_id_t mid;
+  uint8_t type;
+
+  index->opaque_data = tree = memb_alloc(&trees);
+  if(tree == NULL) {
+    PRINTF("DB: Failed to allocate a B+-tree\n");
+    return DB_ALLOCATION_ERROR;
+  }
+
+  tree->storage = storage_open(index->descriptor_file);
+  if(tree->storage < 0) {
+    memb_free(&trees, tree);
+    index->opaque_data = NULL;
+    return DB_STORAGE_ERROR;
+  }
+  cache_invalidate(tree);
+
+  /* Nodes are allocated in order, so the first free node can be found
+     with a binary search over the node types. */
+  for(low = ROOT_NODE + 1, high = DB_BTREE_NODE_LIMIT; low < high;) {
+    mid = low + (high - low) / 2;
+    if(DB_ERROR(storage_read(tree->storage, &type, NODE_OFFSET(mid),
+                             sizeof(type)))) {
+      release(index);
+      return DB_STORAGE_ERROR;
+    }
+    if(type == NODE_FREE) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  tree->next_free_node = low;
+
+  PRINTF("DB: Loaded a B+-tree index from %s using %u nodes\n",
+         index->descriptor_file, (unsigned)low);
+
+  return DB_OK;
+}
+
+static db_result_t
+release(index_t *index)
+{
+  btree_t *tree;
+
+  tree = index->opaque_data;
+  cache_invalidate(tree);
+  storage_close(tree->storage);
+  memb_free(&trees, tree);
+  index->opaque_data = NULL;
+  return DB_OK;
+}
+
+static db_result_t
+insert(index_t *index, attribute_value_t *key, tuple_id_t value)
+{
+  btree_t *tree;
+  btree_node_id_t path[MAX_DEPTH];
+  struct node_cache *cache;
+  struct leaf_entry entry;
+  int depth;
+  int id;
+
+  tree = (btree_t *)index->opaque_data;
+
+  entry.key = db_value_to_long(key);
+  entry.value = value + 1;
+
+  id = find_leaf(tree, entry.key, 0, path, &depth);
+  if(id < 0) {
+    return DB_INDEX_ERROR;
+  }
+
+  cache = node_load(tree, id);
+  if(cache == NULL) {
+    return DB_INDEX_ERROR;
+  }
+
+  if(cache->count < LEAF_CAPACITY) {
+    if(leaf_append(tree, cache, &entry) == 0) {
+      return DB_STORAGE_ERROR;
+    }
+  } else if(split_leaf(tree, path, depth, &entry) == 0) {
+    PRINTF("DB: Failed to insert key %ld into a B+-tree index\n",
+           (long)entry.key);
+    return DB_INDEX_ERROR;
+  }
+
+  return DB_OK;
+}
+
+static db_result_t
+delete(index_t *index, attribute_value_t *value)
+{
+  btree_t *tree;
+  btree_node_id_t path[MAX_DEPTH];
+  btree_node_id_t id;
+  btree_node_id_t next;
+  struct node_cache *cache;
+  btree_key_t key;
+  int depth;
+  int count;
+  int i;
+  int past_key;
+  int leaf;
+
+  tree = (btree_t *)index->opaque_data;
+  key = db_value_to_long(value);
+
+  leaf = find_leaf(tree, key, 1, path, &depth);
+  if(leaf < 0) {
+    return DB_INDEX_ERROR;
+  }
+
+  for(id = leaf;;) {
+    cache = node_load(tree, id);
+    if(cache == NULL) {
+      return DB_INDEX_ERROR;
+    }
+
+    next = cache->node.header.next;
+    for(i = count = past_key = 0; i < cache->count; i++) {
+      if(cache->node.u.entries[i].key != key) {
+        past_key |= cache->node.u.entries[i].key > key;
+        split_entries[count++] = cache->node.u.entries[i];
+      }
+    }
+
+    if(count < cache->count) {
+      make_leaf(&work_node, split_entries, count, next);
+      if(node_write(tree, id, &work_node) == 0) {
+        return DB_STORAGE_ERROR;
+      }
+    }
+
+    /* A leaf holding a larger key means that no later leaf can hold
+       the key that we are deleting. */
+    if(past_key || next == 0) {
+      break;
+    }
+    id = next;
+  }
+
+  return DB_OK;
+}
+
+static tuple_id_t
+get_next(index_iterator_t *iterator)
+{
+  static struct {
+    index_iterator_t *iterator;
+    btree_node_id_t leaf;
+    uint8_t slot;
+    uint8_t past_range;
+  } scan;
+  btree_t *tree;
+  btree_node_id_t path[MAX_DEPTH];
+  struct node_cache *cache;
+  struct leaf_entry *entry;
+  btree_key_t min;
+  btree_key_t max;
+  int depth;
+  int leaf;
+
+  tree = (btree_t *)iterator->index->opaque_data;
+  min = db_value_to_long(&iterator->min_value);
+  max = db_value_to_long(&iterator->max_value);
+
+  if(scan.iterator != iterator || iterator->next_item_no == 0) {
+    leaf = find_leaf(tree, min, 1, path, &depth);
+    if(leaf < 0) {
+      scan.iterator = NULL;
+      return INVALID_TUPLE;
+    }
+    scan.iterator = iterator;
+    scan.leaf = leaf;
+    scan.slot = 0;
+    scan.past_range = 0;
+  }
+
+  for(;;) {
+    cache = node_load(tree, scan.leaf);
+    if(cache == NULL) {
+      return INVALID_TUPLE;
+    }
+
+    while(scan.slot < cache->count) {
+      entry = &cache->node.u.entries[scan.slot++];
+      if(entry->key > max) {
+        scan.past_range = 1;
+      } else if(entry->key >= min) {
+        iterator->next_item_no++;
+        return entry->value - 1;
+      }
+    }
+
+    /* The keys of the following leaves are at least as large as the
+       largest key in this leaf. */
+    if(scan.past_range || cache->node.header.next == 0) {
+      return INVALID_TUPLE;
+    }
+    scan.leaf = cache->node.header.next;
+    scan.slot = 0;
+  }
+}
@@ -693,6 +693,9 @@ get_next(index_iterator_t *iterator)
     cache.end = NODE_DEPTH - 1;
     cache.found_items = cache.start = 0;
     cache.index_iterator = iterator;
+    if(iterator->next_item_no == 0) {
+      iterator->found_items = 0;
+    }
 
     /* Find the downward path through the heap consisting of all nodes
        that could possibly contain the key. */
@@ -727,7 +730,8 @@ get_next(index_iterator_t *iterator)
     next_free_slot = heap->next_free_slot[bucket_id];
     for(i = cache.start; i < next_free_slot; i++) {
       if(bcache->bucket.pairs[i].key == key) {
-        if(cache.found_items++ == iterator->next_item_no) {
+        if(cache.found_items++ == iterator->found_items) {
+	  iterator->found_items++;
 	  iterator->next_item_no++;
           cache.start = i + 1;
           PRINTF("DB: Found key %ld with value %lu\n", (long)key,
@@ -736,6 +740,8 @@ get_next(index_iterator_t *iterator)
         }
       }
     }
+    /* The next bucket is searched from its first slot. */
+    cache.start = 0;
   }
 
   if(VALUE_INT(&iterator->min_value) == VALUE_INT(&iterator->max_value)) {
@@ -743,7 +749,11 @@ get_next(index_iterator_t *iterator)
     return INVALID_TUPLE;
   }
 
-  iterator->next_item_no = 0;
+  /* Continue with the next key in the range. next_item_no keeps
+     counting the items of the whole range, so that the caller can
+     tell an empty result from the end of the range. */
+  iterator->found_items = 0;
+  cache.index_iterator = NULL;
   VALUE_INT(&iterator->min_value)++;
 
   return get_next(iterator);
@@ -297,6 +297,138 @@ eval_logic(lvm_instance_t *p, operator_t *op)
   return EXECUTION_ERROR;
 }
 
+static operator_t
+mirror_relation(operator_t op)
+{
+  /* Give the operator that yields the same result when
+     the operands are swapped. */
+  switch(op) {
+  case LVM_GE:
+    return LVM_LE;
+  case LVM_GEQ:
+    return LVM_LEQ;
+  case LVM_LE:
+    return LVM_GE;
+  case LVM_LEQ:
+    return LVM_GEQ;
+  default:
+    return op;
+  }
+}
+
+static int
+compile_relation(lvm_instance_t *p)
+{
+  operator_t op;
+  operand_t operand[2];
+  struct lvm_comparison *comparison;
+  int i;
+
+  if(get_type(p) != LVM_CMP_OP) {
+    return 0;
+  }
+
+  op = *get_operator(p);
+  if(IS_CONNECTIVE(op)) {
+    if(op == LVM_NOT ||
+       (p->connective != 0 && p->connective != (uint8_t)op)) {
+      return 0;
+    }
+    p->connective = op;
+    return compile_relation(p) && compile_relation(p);
+  }
+
+  if(p->ncomparisons == LVM_MAX_SIMPLE_COMPARISONS) {
+    return 0;
+  }
+
+  for(i = 0; i < 2; i++) {
+    if(get_type(p) != LVM_OPERAND) {
+      return 0;
+    }
+    get_operand(p, &operand[i]);
+  }
+
+  comparison = &p->comparisons[p->ncomparisons];
+  if(operand[0].type == LVM_VARIABLE && operand[1].type == LVM_LONG) {
+    comparison->id = operand[0].value.id;
+    comparison->value = operand[1].value.l;
+    comparison->op = op;
+  } else if(operand[0].type == LVM_LONG && operand[1].type == LVM_VARIABLE) {
+    comparison->id = operand[1].value.id;
+    comparison->value = operand[0].value.l;
+    comparison->op = mirror_relation(op);
+  } else {
+    return 0;
+  }
+
+  p->ncomparisons++;
+  return 1;
+}
+
+static void
+compile(lvm_instance_t *p)
+{
+  p->compiled = 1;
+  p->ncomparisons = 0;
+  p->connective = 0;
+  p->ip = 0;
+
+  if(!compile_relation(p)) {
+    /* The condition must be interpreted. */
+    p->ncomparisons = 0;
+  }
+
+  PRINTF("Compiled %d comparisons\n", p->ncomparisons);
+}
+
+static lvm_status_t
+eval_comparisons(lvm_instance_t *p)
+{
+  struct lvm_comparison *comparison;
+  struct lvm_comparison *end;
+  long l;
+  int result;
+
+  end = p->comparisons + p->ncomparisons;
+  for(comparison = p->comparisons; comparison < end; comparison++) {
+    l = variables[comparison->id].value.l;
+    switch(comparison->op) {
+    case LVM_EQ:
+      result = l == comparison->value;
+      break;
+    case LVM_NEQ:
+      result = l != comparison->value;
+      break;
+    case LVM_GE:
+      result = l > comparison->value;
+      break;
+    case LVM_GEQ:
+      result = l >= comparison->value;
+      break;
+    case LVM_LE:
+      result = l < comparison->value;
+      break;
+    case LVM_LEQ:
+      result = l <= comparison->value;
+      break;
+    default:
+      return EXECUTION_ERROR;
+    }
+
+    /* Stop at the first comparison that decides the result. */
+    if(p->connective == LVM_OR) {
+      if(result) {
+        return TRUE;
+      }
+    } else if(!result) {
+      return FALSE;
+    }
+  }
+
+  return p->connective == LVM_OR ? FALSE : TRUE;
+}
+
 void
 lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
 {
@@ -306,6 +438,8 @@ lvm_reset(lvm_instance_t *p, unsigned char *code, lvm_ip_t size)
   p->end = 0;
   p->ip = 0;
   p->error = 0;
+  p->compiled = 0;
+  p->ncomparisons = 0;
 
   memset(variables, 0, sizeof(variables));
   memset(derivations, 0, sizeof(derivations));
@@ -383,6 +517,13 @@ lvm_execute(lvm_instance_t *p)
   operator_t *operator;
   lvm_status_t status;
 
+  if(!p->compiled) {
+    compile(p);
+  }
+  if(p->ncomparisons > 0) {
+    return eval_comparisons(p);
+  }
+
   p->ip = 0;
   status = EXECUTION_ERROR;
   type = get_type(p);
@@ -472,6 +613,27 @@ lvm_set_variable_value(char *name, operand_value_t value)
   return TRUE;
 }
 
+lvm_status_t
+lvm_get_variable_id(char *name, variable_id_t *id)
+{
+  variable_id_t i;
+
+  for(i = 0; i < LVM_MAX_VARIABLE_ID - 1 && variables[i].name[0] != '\0'; i++) {
+    if(strcmp(variables[i].name, name) == 0) {
+      *id = i;
+      return TRUE;
+    }
+  }
+
+  return INVALID_IDENTIFIER;
+}
+
+void
+lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value)
+{
+  variables[id].value = value;
+}
+
 void
 lvm_set_variable(lvm_instance_t *p, char *name)
 {
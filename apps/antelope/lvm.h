@@ -40,6 +40,7 @@
 #ifndef LVM_H
 #define LVM_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "db-options.h"
@@ -63,12 +64,27 @@ typedef enum lvm_status lvm_status_t;
 
 typedef int lvm_ip_t;
 
+typedef unsigned char variable_id_t;
+
+/* A comparison between a variable and a constant. */
+struct lvm_comparison {
+  variable_id_t id;
+  uint8_t op;
+  long value;
+};
+
 struct lvm_instance {
   unsigned char *code;
   lvm_ip_t size;
   lvm_ip_t end;
   lvm_ip_t ip;
   unsigned error;
+  /* Conditions made of comparisons joined by a single type of
+     connective are compiled into a flat array on the first execution. */
+  uint8_t compiled;
+  uint8_t ncomparisons;
+  uint8_t connective;
+  struct lvm_comparison comparisons[LVM_MAX_SIMPLE_COMPARISONS];
 };
 typedef struct lvm_instance lvm_instance_t;
 
@@ -104,8 +120,6 @@ enum operand_type {
 };
 typedef enum operand_type operand_type_t;
 
-typedef unsigned char variable_id_t;
-
 typedef union {
   long l;
 #if LVM_USE_FLOATS
@@ -130,6 +144,8 @@ void lvm_print_derivations(lvm_instance_t *p);
 lvm_status_t lvm_execute(lvm_instance_t *p);
 lvm_status_t lvm_register_variable(char *name, operand_type_t type);
 lvm_status_t lvm_set_variable_value(char *name, operand_value_t value);
+lvm_status_t lvm_get_variable_id(char *name, variable_id_t *id);
+void lvm_set_variable_value_by_id(variable_id_t id, operand_value_t value);
 void lvm_print_code(lvm_instance_t *p);
 lvm_ip_t lvm_jump_to_operand(lvm_instance_t *p);
 lvm_ip_t lvm_shift_for_operator(lvm_instance_t *p, lvm_ip_t end);
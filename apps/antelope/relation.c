@@ -64,10 +64,43 @@ struct source_dest_map {
   attribute_t *to_attr;
   unsigned from_offset;
   unsigned to_offset;
+  uint8_t has_variable;
+  variable_id_t variable_id;
 };
 
 static struct source_dest_map attr_map[AQL_ATTRIBUTE_LIMIT];
 
+/*
+ * Aggregates are computed per group in a bounded table. If a query has
+ * more groups than DB_GROUP_LIMIT, the groups with the smallest keys
+ * are kept, and the relation is scanned again for the larger keys once
+ * the kept groups have been emitted. Queries without GROUP BY use a
+ * single group.
+ */
+#define GROUP_END	0xff
+
+struct group {
+  long key;
+  long count;
+  long values[AQL_ATTRIBUTE_LIMIT];
+  uint8_t next;
+};
+
+static struct {
+  struct source_dest_map *key_map;
+  long low;
+  uint8_t has_low;
+  uint8_t overflow;
+  uint8_t emitting;
+  uint8_t used;
+  uint8_t next_output;
+  uint8_t buckets[DB_GROUP_BUCKETS];
+  struct group groups[DB_GROUP_LIMIT];
+} group_table;
+
+#define GROUP_HASH(key)	((unsigned)((key) ^ ((key) >> 8)) & \
+			 (DB_GROUP_BUCKETS - 1))
+
 #if DB_FEATURE_JOIN
 /*
  * The source_map structure is used for mapping attributes to
@@ -79,6 +112,56 @@ struct source_map {
 };
 
 static struct source_map source_map[AQL_ATTRIBUTE_LIMIT];
+
+/* The offsets of the join attribute in the left and right rows. */
+static unsigned left_join_offset;
+static unsigned right_join_offset;
+
+/*
+ * A merge join steps through two relations that are sorted on the
+ * join attribute. A group of right rows with the same value is
+ * rescanned for each left row having that value.
+ */
+static struct {
+  tuple_id_t right_id;
+  tuple_id_t group_id;
+  long key;
+  uint8_t need_left;
+  uint8_t group_valid;
+} merge_join;
+
+#if DB_JOIN_HASH_MEMORY > 0
+#define HASH_JOIN_END	0xff
+
+/*
+ * A hash join loads as many rows of the smaller (build) relation as
+ * fit in the memory, and then scans the other (probe) relation once
+ * for each such batch. Each entry consists of the index of the next
+ * entry in the bucket, the value of the join attribute, and the row.
+ */
+static struct {
+  relation_t *build_rel;
+  relation_t *probe_rel;
+  attribute_t *build_attr;
+  attribute_t *probe_attr;
+  unsigned char *build_row;
+  unsigned char *probe_row;
+  unsigned build_offset;
+  unsigned probe_offset;
+  unsigned entry_size;
+  tuple_id_t next_build_id;
+  long key;
+  uint8_t build_done;
+  uint8_t capacity;
+  uint8_t chain;
+  uint8_t buckets[DB_JOIN_HASH_BUCKETS];
+  unsigned char memory[DB_JOIN_HASH_MEMORY];
+} hash_join;
+
+#define HASH_ENTRY(i)	(hash_join.memory + (i) * hash_join.entry_size)
+#define HASH_KEY(key)	((unsigned)((key) ^ ((key) >> 8)) & \
+			 (DB_JOIN_HASH_BUCKETS - 1))
+#endif /* DB_JOIN_HASH_MEMORY > 0 */
 #endif /* DB_FEATURE_JOIN */
 
 static unsigned char row[DB_MAX_ATTRIBUTES_PER_RELATION * DB_MAX_ELEMENT_SIZE];
@@ -92,6 +175,22 @@ LIST(relations);
 MEMB(relations_memb, relation_t, DB_RELATION_POOL_SIZE);
 MEMB(attributes_memb, attribute_t, DB_ATTRIBUTE_POOL_SIZE);
 
+#if DB_INSERT_BUFFER_SIZE > 0
+/* Index updates deferred during a batch of insertions. They are
+   applied in key order when the buffered rows are flushed. */
+struct index_update {
+  index_t *index;
+  long key;
+  tuple_id_t tuple_id;
+};
+
+static struct {
+  relation_t *rel;
+  uint8_t count;
+  struct index_update entries[DB_INSERT_INDEX_BUFFER];
+} index_buffer;
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+
 static relation_t *relation_find(char *);
 static attribute_t *attribute_find(relation_t *, char *);
 static int get_attribute_value_offset(relation_t *, attribute_t *);
@@ -250,7 +349,8 @@ relation_load(char *name)
   list_add(relations, rel);
 
 end:
-  if(rel->dir == DB_STORAGE && DB_ERROR(storage_load(rel))) {
+  if(rel->dir == DB_STORAGE && !RELATION_HAS_TUPLES(rel) &&
+     DB_ERROR(storage_load(rel))) {
     relation_release(rel);
     return NULL;
   }
@@ -266,6 +366,7 @@ relation_release(relation_t *rel)
   }
 
   if(rel->references == 0) {
+    relation_insert_end(rel);
     storage_unload(rel);
   }
 
@@ -467,11 +568,113 @@ relation_remove(char *name, int remove_tuples)
     return DB_BUSY_ERROR;
   }
 
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(index_buffer.rel == rel) {
+    index_buffer.rel = NULL;
+    index_buffer.count = 0;
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+
   result = storage_drop_relation(rel, remove_tuples);
   relation_free(rel);
   return result;
 }
 
+db_result_t
+relation_insert_begin(relation_t *rel)
+{
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(index_buffer.rel != NULL && index_buffer.rel != rel &&
+     DB_ERROR(relation_insert_end(index_buffer.rel))) {
+    return DB_STORAGE_ERROR;
+  }
+  index_buffer.rel = rel;
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+  return storage_begin_batch(rel);
+}
+
+db_result_t
+relation_insert_flush(relation_t *rel)
+{
+#if DB_INSERT_BUFFER_SIZE > 0
+  struct index_update *update;
+  struct index_update *next;
+  struct index_update *min;
+  struct index_update *end;
+  struct index_update tmp;
+  attribute_value_t value;
+
+  if(DB_ERROR(storage_flush(rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
+  if(index_buffer.rel != rel) {
+    return DB_OK;
+  }
+
+  /* Apply the updates in key order, so that consecutive insertions
+     into an index touch nearby parts of it. */
+  end = index_buffer.entries + index_buffer.count;
+  index_buffer.count = 0;
+  value.domain = DOMAIN_LONG;
+  for(update = index_buffer.entries; update < end; update++) {
+    for(min = update, next = update + 1; next < end; next++) {
+      if(next->index < min->index ||
+         (next->index == min->index && next->key < min->key)) {
+        min = next;
+      }
+    }
+    tmp = *min;
+    *min = *update;
+    *update = tmp;
+
+    VALUE_LONG(&value) = update->key;
+    if(DB_ERROR(index_insert(update->index, &value, update->tuple_id))) {
+      return DB_INDEX_ERROR;
+    }
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+  return DB_OK;
+}
+
+db_result_t
+relation_insert_end(relation_t *rel)
+{
+  db_result_t result;
+
+  result = relation_insert_flush(rel);
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(index_buffer.rel == rel) {
+    index_buffer.rel = NULL;
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+  if(DB_ERROR(storage_end_batch(rel))) {
+    return DB_STORAGE_ERROR;
+  }
+  return result;
+}
+
+static db_result_t
+insert_index_entry(relation_t *rel, attribute_t *attr, attribute_value_t *value)
+{
+#if DB_INSERT_BUFFER_SIZE > 0
+  struct index_update *update;
+
+  if(index_buffer.rel == rel) {
+    if(index_buffer.count == DB_INSERT_INDEX_BUFFER &&
+       DB_ERROR(relation_insert_flush(rel))) {
+      return DB_INDEX_ERROR;
+    }
+    update = &index_buffer.entries[index_buffer.count++];
+    update->index = attr->index;
+    update->key = db_value_to_long(value);
+    update->tuple_id = rel->next_row;
+    return DB_OK;
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+  return index_insert(attr->index, value, rel->next_row);
+}
+
 db_result_t
 relation_insert(relation_t *rel, attribute_value_t *values)
 {
@@ -534,7 +737,7 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 
     ptr += attr->element_size;
     if(attr->index != NULL) {
-      if(DB_ERROR(index_insert(attr->index, value, rel->next_row))) {
+      if(DB_ERROR(insert_index_entry(rel, attr, value))) {
         return DB_INDEX_ERROR;
       }
     }
@@ -548,40 +751,99 @@ relation_insert(relation_t *rel, attribute_value_t *values)
 }
 
 static void
-aggregate(attribute_t *attr, attribute_value_t *value)
+group_reset(void)
 {
-  long long_value;
+  group_table.used = 0;
+  group_table.next_output = 0;
+  group_table.overflow = 0;
+  group_table.emitting = 0;
+  memset(group_table.buckets, GROUP_END, sizeof(group_table.buckets));
+}
 
-  switch(value->domain) {
-  case DOMAIN_INT:
-    long_value = VALUE_INT(value);
-    break;
-  case DOMAIN_LONG:
-    long_value = VALUE_LONG(value);
-    break;
-  default:
-    return;
+static struct group *
+group_find(long key, struct source_dest_map *attr_map_end)
+{
+  struct group *group;
+  struct source_dest_map *attr_map_ptr;
+  uint8_t *link;
+  uint8_t victim;
+  uint8_t i;
+
+  for(i = group_table.buckets[GROUP_HASH(key)];
+      i != GROUP_END;
+      i = group_table.groups[i].next) {
+    if(group_table.groups[i].key == key) {
+      return &group_table.groups[i];
+    }
   }
 
-  switch(attr->aggregator) {
-  case AQL_COUNT:
-    attr->aggregation_value++;
-    break;
+  if(group_table.has_low && key <= group_table.low) {
+    /* The group was emitted in an earlier pass. */
+    return NULL;
+  }
+
+  if(group_table.used < DB_GROUP_LIMIT) {
+    i = group_table.used++;
+  } else {
+    /* Keep the groups with the smallest keys; the group with the
+       largest key is aggregated again in a later pass. */
+    group_table.overflow = 1;
+    for(victim = 0, i = 1; i < DB_GROUP_LIMIT; i++) {
+      if(group_table.groups[i].key > group_table.groups[victim].key) {
+        victim = i;
+      }
+    }
+    if(key > group_table.groups[victim].key) {
+      return NULL;
+    }
+
+    link = &group_table.buckets[GROUP_HASH(group_table.groups[victim].key)];
+    while(*link != victim) {
+      link = &group_table.groups[*link].next;
+    }
+    *link = group_table.groups[victim].next;
+    i = victim;
+  }
+
+  group = &group_table.groups[i];
+  group->key = key;
+  group->count = 0;
+  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+    switch(attr_map_ptr->to_attr->aggregator) {
+    case AQL_MAX:
+      group->values[attr_map_ptr - attr_map] = LONG_MIN;
+      break;
+    case AQL_MIN:
+      group->values[attr_map_ptr - attr_map] = LONG_MAX;
+      break;
+    default:
+      group->values[attr_map_ptr - attr_map] = 0;
+      break;
+    }
+  }
+
+  group->next = group_table.buckets[GROUP_HASH(key)];
+  group_table.buckets[GROUP_HASH(key)] = i;
+
+  return group;
+}
+
+static void
+aggregate(struct group *group, unsigned i, uint8_t aggregator, long value)
+{
+  switch(aggregator) {
   case AQL_SUM:
-    attr->aggregation_value += long_value;
-    break;
   case AQL_MEAN:
-    break;
-  case AQL_MEDIAN:
+    group->values[i] += value;
     break;
   case AQL_MAX:
-    if(long_value > attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+    if(value > group->values[i]) {
+      group->values[i] = value;
     }
     break;
   case AQL_MIN:
-    if(long_value < attr->aggregation_value) {
-      attr->aggregation_value = long_value;
+    if(value < group->values[i]) {
+      group->values[i] = value;
     }
     break;
   default:
@@ -589,6 +851,55 @@ aggregate(attribute_t *attr, attribute_value_t *value)
   }
 }
 
+static long
+aggregation_result(struct group *group, unsigned i, uint8_t aggregator)
+{
+  switch(aggregator) {
+  case AQL_COUNT:
+    return group->count;
+  case AQL_MEAN:
+    return group->count > 0 ? group->values[i] / group->count : 0;
+  default:
+    return group->values[i];
+  }
+}
+
+static db_result_t
+init_aggregation(aql_adt_t *adt, unsigned attribute_count)
+{
+  struct source_dest_map *attr_map_ptr;
+  char *name;
+
+  group_table.key_map = NULL;
+  group_table.has_low = 0;
+  group_reset();
+
+  if(!(AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP)) {
+    /* All rows belong to a single group, which yields a result
+       even if no row matches the condition. */
+    group_find(0, attr_map + attribute_count);
+    return DB_OK;
+  }
+
+  name = adt->attributes[adt->group_attribute].name;
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + attribute_count;
+      attr_map_ptr++) {
+    if(strcmp(attr_map_ptr->to_attr->name, name) == 0) {
+      group_table.key_map = attr_map_ptr;
+    }
+  }
+
+  if(group_table.key_map == NULL ||
+     (group_table.key_map->from_attr->domain != DOMAIN_INT &&
+      group_table.key_map->from_attr->domain != DOMAIN_LONG)) {
+    PRINTF("DB: Cannot group by the attribute %s\n", name);
+    return DB_TYPE_ERROR;
+  }
+
+  return DB_OK;
+}
+
 static db_result_t
 generate_attribute_map(struct source_dest_map *attr_map, unsigned attribute_count,
                        relation_t *from_rel, relation_t *to_rel, 
@@ -655,7 +966,7 @@ select_index(db_handle_t *handle, lvm_instance_t *lvm_instance)
 
       if(range <= min_range) {
         index = attr->index;
-        av_min.domain = av_max.domain = DOMAIN_INT;
+        av_min.domain = av_max.domain = DOMAIN_LONG;
         VALUE_LONG(&av_min) = min.l;
         VALUE_LONG(&av_max) = max.l;
       }
@@ -677,6 +988,7 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
   relation_t *result_rel;
   unsigned attribute_count;
   attribute_t *attr;
+  struct source_dest_map *attr_map_ptr;
 
   result_rel = handle->result_rel;
 
@@ -696,6 +1008,18 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     return DB_IMPLEMENTATION_ERROR;
   }
 
+  /* Bind the attributes used in the condition to their LVM variables,
+     so that the values of each row can be set without name lookups. */
+  for(attr_map_ptr = attr_map;
+      attr_map_ptr < attr_map + attribute_count;
+      attr_map_ptr++) {
+    attr_map_ptr->has_variable = adt->lvm_instance != NULL &&
+      (attr_map_ptr->to_attr->domain == DOMAIN_INT ||
+       attr_map_ptr->to_attr->domain == DOMAIN_LONG) &&
+      lvm_get_variable_id(attr_map_ptr->to_attr->name,
+                          &attr_map_ptr->variable_id) == TRUE;
+  }
+
   if(adt->lvm_instance != NULL) {
     /* Try to establish acceptable ranges for the attribute values. */
     if(!LVM_ERROR(lvm_derive(adt->lvm_instance))) {
@@ -703,6 +1027,12 @@ generate_selection_result(db_handle_t *handle, relation_t *rel, aql_adt_t *adt)
     }
   }
 
+  if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+    if(DB_ERROR(init_aggregation(adt, attribute_count))) {
+      return DB_TYPE_ERROR;
+    }
+  }
+
   handle->flags |= DB_HANDLE_FLAG_PROCESSING;
 
   return DB_OK;
@@ -743,9 +1073,10 @@ relation_process_select(void *handle_ptr)
   unsigned char *from_ptr;
   unsigned char *to_ptr;
   operand_value_t operand_value;
-  uint8_t intbuf[2];
   attribute_value_t value;
   lvm_status_t wanted_result;
+  struct group *group;
+  long long_value;
 
   handle = (db_handle_t *)handle_ptr;
   adt = (aql_adt_t *)handle->adt;
@@ -753,18 +1084,22 @@ relation_process_select(void *handle_ptr)
   attribute_count = handle->result_rel->attribute_count;
   attr_map_end = attr_map + attribute_count;
 
+  if((AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) && group_table.emitting) {
+    goto end_aggregation;
+  }
+
   if(handle->flags & DB_HANDLE_FLAG_SEARCH_INDEX) {
     handle->tuple_id = index_get_next(&handle->index_iterator);
     if(handle->tuple_id == INVALID_TUPLE) {
       PRINTF("DB: An attribute value could not be found in the index\n");
-      if(handle->index_iterator.next_item_no == 0) {
-        return DB_INDEX_ERROR;
-      }
-
       if(adt->flags & AQL_FLAG_AGGREGATE) {
         goto end_aggregation;
       }
 
+      if(handle->index_iterator.next_item_no == 0) {
+        return DB_INDEX_ERROR;
+      }
+
       return DB_FINISHED;
     }
   }
@@ -789,15 +1124,16 @@ relation_process_select(void *handle_ptr)
     result_attr = attr_map_ptr->to_attr;
 
     /* Update the internal state of the PLE. */
-    if(result_attr->domain == DOMAIN_INT) {
-      operand_value.l = from_ptr[0] << 8 | from_ptr[1];
-      lvm_set_variable_value(result_attr->name, operand_value);
-    } else if(result_attr->domain == DOMAIN_LONG) {
-      operand_value.l = (uint32_t)from_ptr[0] << 24 |
-                        (uint32_t)from_ptr[1] << 16 |
-                        (uint32_t)from_ptr[2] << 8 |
-                        from_ptr[3];
-      lvm_set_variable_value(result_attr->name, operand_value);
+    if(attr_map_ptr->has_variable) {
+      if(result_attr->domain == DOMAIN_INT) {
+        operand_value.l = from_ptr[0] << 8 | from_ptr[1];
+      } else {
+        operand_value.l = (int32_t)((uint32_t)from_ptr[0] << 24 |
+                                    (uint32_t)from_ptr[1] << 16 |
+                                    (uint32_t)from_ptr[2] << 8 |
+                                    from_ptr[3]);
+      }
+      lvm_set_variable_value_by_id(attr_map_ptr->variable_id, operand_value);
     }
 
     if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
@@ -822,13 +1158,35 @@ relation_process_select(void *handle_ptr)
   if(adt->lvm_instance == NULL ||
      lvm_execute(adt->lvm_instance) == wanted_result) {
     if(AQL_GET_FLAGS(adt) & AQL_FLAG_AGGREGATE) {
+      long_value = 0;
+      if(group_table.key_map != NULL) {
+        result = db_phy_to_value(&value, group_table.key_map->from_attr,
+                                 row + group_table.key_map->from_offset);
+        if(DB_ERROR(result)) {
+          return result;
+        }
+        long_value = db_value_to_long(&value);
+      }
+
+      group = group_find(long_value, attr_map_end);
+      if(group == NULL) {
+        /* The group belongs to another pass. */
+        return DB_OK;
+      }
+
+      group->count++;
       for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+        if(attr_map_ptr->to_attr->aggregator == AQL_NONE ||
+           attr_map_ptr->to_attr->aggregator == AQL_COUNT) {
+          continue;
+        }
         from_ptr = row + attr_map_ptr->from_offset;
-        result = db_phy_to_value(&value, attr_map_ptr->to_attr, from_ptr);
+        result = db_phy_to_value(&value, attr_map_ptr->from_attr, from_ptr);
         if(DB_ERROR(result)) {
 	  return result;
         }
-        aggregate(attr_map_ptr->to_attr, &value);
+        aggregate(group, attr_map_ptr - attr_map,
+                  attr_map_ptr->to_attr->aggregator, db_value_to_long(&value));
       }
     } else {
       if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
@@ -845,28 +1203,66 @@ relation_process_select(void *handle_ptr)
   return DB_OK;
 
 end_aggregation:
-  /* Generate aggregated result if requested. */
-  for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
-    result_attr = attr_map_ptr->to_attr;
-    to_ptr = result_row + attr_map_ptr->to_offset;
+  /* Emit one result row per group. */
+  group_table.emitting = 1;
+  if(group_table.next_output < group_table.used) {
+    group = &group_table.groups[group_table.next_output++];
+    for(attr_map_ptr = attr_map; attr_map_ptr < attr_map_end; attr_map_ptr++) {
+      result_attr = attr_map_ptr->to_attr;
+      if(result_attr->flags & ATTRIBUTE_FLAG_NO_STORE) {
+        continue;
+      }
+
+      if(attr_map_ptr == group_table.key_map) {
+        long_value = group->key;
+      } else {
+        long_value = aggregation_result(group, attr_map_ptr - attr_map,
+                                        result_attr->aggregator);
+      }
+
+      value.domain = result_attr->domain;
+      if(result_attr->domain == DOMAIN_INT) {
+        VALUE_INT(&value) = long_value;
+      } else {
+        VALUE_LONG(&value) = long_value;
+      }
+      to_ptr = result_row + attr_map_ptr->to_offset;
+      if(DB_ERROR(db_value_to_phy(to_ptr, result_attr, &value))) {
+        return DB_TYPE_ERROR;
+      }
+    }
+
+    if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
+      if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
+        PRINTF("DB: Failed to store a row in the result relation!\n");
+        return DB_STORAGE_ERROR;
+      }
+    }
 
-    intbuf[0] = result_attr->aggregation_value >> 8;
-    intbuf[1] = result_attr->aggregation_value & 0xff;
-    from_ptr = intbuf;
-    memcpy(to_ptr, from_ptr, result_attr->element_size);
+    handle->current_row++;
+    return DB_GOT_ROW;
   }
 
-  if(AQL_GET_FLAGS(adt) & AQL_FLAG_ASSIGN) {
-    if(DB_ERROR(storage_put_row(handle->result_rel, result_row))) {
-      PRINTF("DB: Failed to store a row in the result relation!\n");
-      return DB_STORAGE_ERROR;
+  if(group_table.overflow) {
+    /* Scan the relation again for the groups that did not fit. */
+    for(group = group_table.groups, long_value = group->key;
+        group < group_table.groups + group_table.used;
+        group++) {
+      if(group->key > long_value) {
+        long_value = group->key;
+      }
     }
+    PRINTF("DB: Starting a new aggregation pass after key %ld\n", long_value);
+    group_table.low = long_value;
+    group_table.has_low = 1;
+    group_reset();
+    handle->tuple_id = 0;
+    handle->index_iterator.next_item_no = 0;
+    return DB_OK;
   }
 
-  handle->current_row = 1;
   AQL_GET_FLAGS(adt) &= ~AQL_FLAG_AGGREGATE; /* Stop the aggregation. */
-
-  return DB_GOT_ROW;
+  return DB_FINISHED;
 }
 
 db_result_t
@@ -916,10 +1312,11 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     PRINTF("DB: Found attribute %s in relation %s\n",
 	attribute_name, rel->name);
 
+    /* Aggregates are computed and stored as 32-bit values. */
     attr = relation_attribute_add(handle->result_rel, dir,
 				  attribute_name, 
-				  adt->aggregators[i] ? DOMAIN_INT : attr->domain,
-				  attr->element_size);
+				  adt->aggregators[i] ? DOMAIN_LONG : attr->domain,
+				  adt->aggregators[i] ? 4 : attr->element_size);
     if(attr == NULL) {
       PRINTF("DB: Failed to add a result attribute\n");
       relation_release(handle->result_rel);
@@ -929,19 +1326,18 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
     attr->aggregator = adt->aggregators[i];
     switch(attr->aggregator) {
     case AQL_NONE:
-      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE)) {
+      if(!(adt->attributes[i].flags & ATTRIBUTE_FLAG_NO_STORE) &&
+         !((AQL_GET_FLAGS(adt) & AQL_FLAG_GROUP) &&
+           i == adt->group_attribute)) {
         /* Only count attributes projected into the result set. */
         normal_attributes++;
       }
       break;
-    case AQL_MAX:
-      attr->aggregation_value = LONG_MIN;
-      break;
-    case AQL_MIN:
-      attr->aggregation_value = LONG_MAX;
-      break;
+    case AQL_MEDIAN:
+      PRINTF("DB: The median cannot be computed in a single scan\n");
+      relation_release(handle->result_rel);
+      return DB_IMPLEMENTATION_ERROR;
     default:
-      attr->aggregation_value = 0;
       break;
     }
 
@@ -959,6 +1355,232 @@ relation_select(void *handle_ptr, relation_t *rel, void *adt_ptr)
 }
 
 #if DB_FEATURE_JOIN
+static long
+join_key(attribute_t *attr, unsigned char *row, unsigned offset)
+{
+  attribute_value_t value;
+
+  if(DB_ERROR(db_phy_to_value(&value, attr, row + offset))) {
+    return 0;
+  }
+  return db_value_to_long(&value);
+}
+
+static db_result_t
+emit_join_row(db_handle_t *handle)
+{
+  relation_t *join_rel;
+  unsigned char *join_next_attribute_ptr;
+  size_t element_size;
+  int i;
+
+  join_rel = handle->join_rel;
+
+  /* Use the source attribute map to fill in the physical representation
+     of the resulting tuple. */
+  join_next_attribute_ptr = join_row;
+
+  for(i = 0; i < join_rel->attribute_count; i++) {
+    element_size = source_map[i].attr->element_size;
+
+    memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
+    join_next_attribute_ptr += element_size;
+  }
+
+  if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
+    if(DB_ERROR(storage_put_row(join_rel, join_row))) {
+      return DB_STORAGE_ERROR;
+    }
+  }
+
+  handle->current_row++;
+  return DB_GOT_ROW;
+}
+
+static db_result_t
+process_merge_join(db_handle_t *handle)
+{
+  db_result_t result;
+  long key;
+
+  for(;;) {
+    if(merge_join.need_left) {
+      result = storage_get_row(handle->left_rel, &handle->tuple_id, left_row);
+      if(result != DB_OK) {
+        return result;
+      }
+      merge_join.need_left = 0;
+
+      key = join_key(handle->left_join_attr, left_row, left_join_offset);
+      if(merge_join.group_valid && key == merge_join.key) {
+        /* Join with the same group of right rows again. */
+        merge_join.right_id = merge_join.group_id;
+      } else {
+        /* Skip the right rows with smaller values. */
+        for(;; merge_join.right_id++) {
+          result = storage_get_row(handle->right_rel, &merge_join.right_id,
+                                   right_row);
+          if(result != DB_OK) {
+            return result;
+          }
+          if(join_key(handle->right_join_attr, right_row,
+                      right_join_offset) >= key) {
+            break;
+          }
+        }
+        merge_join.group_id = merge_join.right_id;
+        merge_join.key = key;
+        merge_join.group_valid = 1;
+      }
+    }
+
+    result = storage_get_row(handle->right_rel, &merge_join.right_id, right_row);
+    if(DB_ERROR(result)) {
+      return result;
+    }
+    if(result == DB_FINISHED ||
+       join_key(handle->right_join_attr, right_row,
+                right_join_offset) != merge_join.key) {
+      /* The group has ended; continue with the next left row. */
+      handle->tuple_id++;
+      merge_join.need_left = 1;
+      continue;
+    }
+
+    merge_join.right_id++;
+    return emit_join_row(handle);
+  }
+}
+
+#if DB_JOIN_HASH_MEMORY > 0
+static db_result_t
+build_hash_table(void)
+{
+  db_result_t result;
+  uint8_t count;
+  unsigned char *entry;
+  unsigned bucket;
+
+  memset(hash_join.buckets, HASH_JOIN_END, sizeof(hash_join.buckets));
+
+  for(count = 0; count < hash_join.capacity; count++) {
+    entry = HASH_ENTRY(count);
+    result = storage_get_row(hash_join.build_rel, &hash_join.next_build_id,
+                             entry + 1 + sizeof(long));
+    if(DB_ERROR(result)) {
+      return result;
+    } else if(result == DB_FINISHED) {
+      hash_join.build_done = 1;
+      break;
+    }
+    hash_join.next_build_id++;
+
+    hash_join.key = join_key(hash_join.build_attr, entry + 1 + sizeof(long),
+                             hash_join.build_offset);
+    memcpy(entry + 1, &hash_join.key, sizeof(long));
+
+    bucket = HASH_KEY(hash_join.key);
+    entry[0] = hash_join.buckets[bucket];
+    hash_join.buckets[bucket] = count;
+  }
+
+  PRINTF("DB: Loaded %u rows of %s into the hash table\n",
+         count, hash_join.build_rel->name);
+
+  hash_join.chain = HASH_JOIN_END;
+  return count == 0 ? DB_FINISHED : DB_OK;
+}
+
+static db_result_t
+process_hash_join(db_handle_t *handle)
+{
+  db_result_t result;
+  unsigned char *entry;
+  long key;
+
+  if(hash_join.next_build_id == 0) {
+    /* The build relation is empty. */
+    return DB_FINISHED;
+  }
+
+  for(;;) {
+    while(hash_join.chain != HASH_JOIN_END) {
+      entry = HASH_ENTRY(hash_join.chain);
+      hash_join.chain = entry[0];
+      memcpy(&key, entry + 1, sizeof(long));
+      if(key == hash_join.key) {
+        memcpy(hash_join.build_row, entry + 1 + sizeof(long),
+               hash_join.build_rel->row_length);
+        return emit_join_row(handle);
+      }
+    }
+
+    result = storage_get_row(hash_join.probe_rel, &handle->tuple_id,
+                             hash_join.probe_row);
+    if(DB_ERROR(result)) {
+      return result;
+    } else if(result == DB_FINISHED) {
+      if(hash_join.build_done) {
+        return DB_FINISHED;
+      }
+      /* Load the next batch, and scan the probe relation again. */
+      result = build_hash_table();
+      if(result != DB_OK) {
+        return result;
+      }
+      handle->tuple_id = 0;
+      continue;
+    }
+    handle->tuple_id++;
+
+    hash_join.key = join_key(hash_join.probe_attr, hash_join.probe_row,
+                             hash_join.probe_offset);
+    hash_join.chain = hash_join.buckets[HASH_KEY(hash_join.key)];
+  }
+}
+
+static db_result_t
+start_hash_join(db_handle_t *handle, tuple_id_t left_cardinality,
+                tuple_id_t right_cardinality)
+{
+  if(left_cardinality <= right_cardinality) {
+    hash_join.build_rel = handle->left_rel;
+    hash_join.build_attr = handle->left_join_attr;
+    hash_join.build_row = left_row;
+    hash_join.build_offset = left_join_offset;
+    hash_join.probe_rel = handle->right_rel;
+    hash_join.probe_attr = handle->right_join_attr;
+    hash_join.probe_row = right_row;
+    hash_join.probe_offset = right_join_offset;
+  } else {
+    hash_join.build_rel = handle->right_rel;
+    hash_join.build_attr = handle->right_join_attr;
+    hash_join.build_row = right_row;
+    hash_join.build_offset = right_join_offset;
+    hash_join.probe_rel = handle->left_rel;
+    hash_join.probe_attr = handle->left_join_attr;
+    hash_join.probe_row = left_row;
+    hash_join.probe_offset = left_join_offset;
+  }
+
+  hash_join.entry_size = 1 + sizeof(long) + hash_join.build_rel->row_length;
+  hash_join.next_build_id = 0;
+  hash_join.build_done = 0;
+  handle->tuple_id = 0;
+
+  return build_hash_table();
+}
+
+static unsigned
+hash_join_capacity(relation_t *rel)
+{
+  unsigned capacity;
+
+  capacity = DB_JOIN_HASH_MEMORY / (1 + sizeof(long) + rel->row_length);
+  return capacity < HASH_JOIN_END ? capacity : HASH_JOIN_END - 1;
+}
+#endif /* DB_JOIN_HASH_MEMORY > 0 */
+
 db_result_t
 relation_process_join(void *handle_ptr)
 {
@@ -966,17 +1588,21 @@ relation_process_join(void *handle_ptr)
   db_result_t result;
   relation_t *left_rel;
   relation_t *right_rel;
-  relation_t *join_rel;
-  unsigned char *join_next_attribute_ptr;
-  size_t element_size;
   tuple_id_t right_tuple_id;
   attribute_value_t value;
-  int i;
 
   handle = (db_handle_t *)handle_ptr;
   left_rel = handle->left_rel;
   right_rel = handle->right_rel;
-  join_rel = handle->join_rel;
+
+  if(handle->flags & DB_HANDLE_FLAG_MERGE_JOIN) {
+    return process_merge_join(handle);
+  }
+#if DB_JOIN_HASH_MEMORY > 0
+  if(handle->flags & DB_HANDLE_FLAG_HASH_JOIN) {
+    return process_hash_join(handle);
+  }
+#endif /* DB_JOIN_HASH_MEMORY > 0 */
 
   if(!(handle->flags & DB_HANDLE_FLAG_INDEX_STEP)) {
     goto inner_loop;
@@ -1030,25 +1656,7 @@ inner_loop:
         return DB_IMPLEMENTATION_ERROR;
       }
 
-      /* Use the source attribute map to fill in the physical representation
-	 of the resulting tuple. */
-      join_next_attribute_ptr = join_row;
-
-      for(i = 0; i < join_rel->attribute_count; i++) {
-	element_size = source_map[i].attr->element_size;
-
-	memcpy(join_next_attribute_ptr, source_map[i].from_ptr, element_size);
-	join_next_attribute_ptr += element_size;
-      }
-
-      if(((aql_adt_t *)handle->adt)->flags & AQL_FLAG_ASSIGN) {
-        if(DB_ERROR(storage_put_row(join_rel, join_row))) {
-          return DB_STORAGE_ERROR;
-        }
-      }
-
-      handle->current_row++;
-      return DB_GOT_ROW;
+      return emit_join_row(handle);
     }
   }
 
@@ -1107,6 +1715,86 @@ generate_join_result(db_handle_t *handle)
   return DB_OK;
 }
 
+static db_result_t
+plan_join(db_handle_t *handle)
+{
+  attribute_t *left_attr;
+  attribute_t *right_attr;
+  int left_offset;
+  int right_offset;
+  int numeric;
+#if DB_JOIN_HASH_MEMORY > 0
+  tuple_id_t left_cardinality;
+  tuple_id_t right_cardinality;
+  tuple_id_t build_cardinality;
+  unsigned capacity;
+#endif /* DB_JOIN_HASH_MEMORY > 0 */
+
+  left_attr = handle->left_join_attr;
+  right_attr = handle->right_join_attr;
+
+  left_offset = get_attribute_value_offset(handle->left_rel, left_attr);
+  right_offset = get_attribute_value_offset(handle->right_rel, right_attr);
+  if(left_offset < 0 || right_offset < 0) {
+    return DB_IMPLEMENTATION_ERROR;
+  }
+  left_join_offset = left_offset;
+  right_join_offset = right_offset;
+
+  numeric = (left_attr->domain == DOMAIN_INT ||
+             left_attr->domain == DOMAIN_LONG) &&
+            (right_attr->domain == DOMAIN_INT ||
+             right_attr->domain == DOMAIN_LONG);
+
+  /* Both relations are sorted on the join attribute. */
+  if(numeric && index_exists(left_attr) && index_exists(right_attr) &&
+     ((index_t *)left_attr->index)->type == INDEX_INLINE &&
+     ((index_t *)right_attr->index)->type == INDEX_INLINE) {
+    PRINTF("DB: Using a merge join\n");
+    merge_join.need_left = 1;
+    merge_join.group_valid = 0;
+    merge_join.right_id = 0;
+    handle->tuple_id = 0;
+    handle->flags |= DB_HANDLE_FLAG_MERGE_JOIN;
+    return DB_OK;
+  }
+
+#if DB_JOIN_HASH_MEMORY > 0
+  if(numeric) {
+    left_cardinality = relation_cardinality(handle->left_rel);
+    right_cardinality = relation_cardinality(handle->right_rel);
+    if(left_cardinality == INVALID_TUPLE || right_cardinality == INVALID_TUPLE) {
+      return DB_STORAGE_ERROR;
+    }
+
+    if(left_cardinality <= right_cardinality) {
+      build_cardinality = left_cardinality;
+      capacity = hash_join_capacity(handle->left_rel);
+    } else {
+      build_cardinality = right_cardinality;
+      capacity = hash_join_capacity(handle->right_rel);
+    }
+
+    /* Prefer an index lookup for each left row over scanning the
+       right relation several times. */
+    if(capacity > 0 &&
+       (!index_exists(right_attr) || build_cardinality <= capacity)) {
+      PRINTF("DB: Using a hash join, %u rows per pass\n", capacity);
+      hash_join.capacity = capacity;
+      handle->flags |= DB_HANDLE_FLAG_HASH_JOIN;
+      return DB_OK;
+    }
+  }
+#endif /* DB_JOIN_HASH_MEMORY > 0 */
+
+  if(!index_exists(right_attr)) {
+    PRINTF("DB: The attribute to join on is not indexed\n");
+    return DB_INDEX_ERROR;
+  }
+
+  return DB_OK;
+}
+
 db_result_t
 relation_join(void *query_result, void *adt_ptr)
 {
@@ -1120,6 +1808,7 @@ relation_join(void *query_result, void *adt_ptr)
   int i;
   char *attribute_name;
   attribute_t *attr;
+  db_result_t result;
 
   adt = (aql_adt_t *)adt_ptr;
 
@@ -1150,6 +1839,11 @@ relation_join(void *query_result, void *adt_ptr)
   left_rel = handle->left_rel;
   right_rel = handle->right_rel;
 
+  if(DB_ERROR(relation_insert_flush(left_rel)) ||
+     DB_ERROR(relation_insert_flush(right_rel))) {
+    return DB_STORAGE_ERROR;
+  }
+
   handle->left_join_attr = relation_attribute_get(left_rel, adt->attributes[0].name);
   handle->right_join_attr = relation_attribute_get(right_rel, adt->attributes[0].name);
   if(handle->left_join_attr == NULL || handle->right_join_attr == NULL) {
@@ -1158,9 +1852,9 @@ relation_join(void *query_result, void *adt_ptr)
     return DB_RELATIONAL_ERROR;
   }
 
-  if(!index_exists(handle->right_join_attr)) {
-    PRINTF("DB: The attribute to join on is not indexed\n");
-    return DB_INDEX_ERROR;
+  result = plan_join(handle);
+  if(DB_ERROR(result)) {
+    return result;
   }
 
   /*
@@ -1189,7 +1883,23 @@ relation_join(void *query_result, void *adt_ptr)
     handle->ncolumns++;
   }
 
-  return generate_join_result(handle);
+  result = generate_join_result(handle);
+  if(DB_ERROR(result)) {
+    return result;
+  }
+
+#if DB_JOIN_HASH_MEMORY > 0
+  if(handle->flags & DB_HANDLE_FLAG_HASH_JOIN) {
+    result = start_hash_join(handle, relation_cardinality(left_rel),
+                             relation_cardinality(right_rel));
+    if(result == DB_FINISHED) {
+      /* The build relation is empty. */
+      result = DB_OK;
+    }
+  }
+#endif /* DB_JOIN_HASH_MEMORY > 0 */
+
+  return result;
 }
 #endif /* DB_FEATURE_JOIN */
 
@@ -95,6 +95,9 @@ db_result_t relation_attribute_remove(relation_t *, char *);
 db_result_t relation_set_primary_key(relation_t *, char *);
 db_result_t relation_remove(char *, int);
 db_result_t relation_insert(relation_t *, attribute_value_t *);
+db_result_t relation_insert_begin(relation_t *);
+db_result_t relation_insert_flush(relation_t *);
+db_result_t relation_insert_end(relation_t *);
 db_result_t relation_select(void *, relation_t *, void *);
 db_result_t relation_join(void *, void *);
 tuple_id_t relation_cardinality(relation_t *);
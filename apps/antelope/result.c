@@ -102,8 +102,9 @@ db_phy_to_value(attribute_value_t *value, attribute_t *attr,
     PRINTF("DB: %s = %d\n", attr->name, int_value);
     break;
   case DOMAIN_LONG:
-    long_value = (long)ptr[0] << 24 | (long)ptr[1] << 16 |
-                 (long)ptr[2] << 8 | (long)ptr[3];
+    /* Sign-extend the 32-bit value on hosts with a larger long type. */
+    long_value = (int32_t)((uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 |
+                           (uint32_t)ptr[2] << 8 | ptr[3]);
     VALUE_LONG(value) = long_value;
     PRINTF("DB: %s = %ld\n", attr->name, long_value);
     break;
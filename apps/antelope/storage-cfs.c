@@ -68,6 +68,43 @@ struct index_record {
 
 #define ROW_XOR 0xf6U
 
+#if DB_STORAGE_BLOCK_SIZE > 0
+/* Rows read ahead from the relation that is being scanned. */
+static struct {
+  relation_t *rel;
+  tuple_id_t first;
+  tuple_id_t next;
+  unsigned nrows;
+  const unsigned char *rows;
+  unsigned char data[DB_STORAGE_BLOCK_SIZE];
+} row_block;
+
+#define BLOCK_INVALIDATE() (row_block.rel = NULL)
+#else
+#define BLOCK_INVALIDATE()
+#endif /* DB_STORAGE_BLOCK_SIZE > 0 */
+
+#if DB_INSERT_BUFFER_SIZE > 0
+/* Rows appended to a relation during a batch of insertions. */
+static struct {
+  relation_t *rel;
+  unsigned length;
+  unsigned char data[DB_INSERT_BUFFER_SIZE];
+} insert_buffer;
+
+#define BUFFER_FLUSH(rel)					\
+  do {								\
+    if(insert_buffer.rel == (rel) &&				\
+       DB_ERROR(storage_flush(rel))) {				\
+      return DB_STORAGE_ERROR;					\
+    }								\
+  } while(0)
+#else
+#define BUFFER_FLUSH(rel)
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+
+static db_result_t append_rows(relation_t *, unsigned char *, unsigned);
+
 static void
 merge_strings(char *dest, char *prefix, char *suffix)
 {
@@ -104,6 +141,7 @@ db_result_t
 storage_load(relation_t *rel)
 {
   PRINTF("DB: Opening the tuple file %s\n", rel->tuple_filename);
+  BLOCK_INVALIDATE();
   rel->tuple_storage = cfs_open(rel->tuple_filename,
                                 CFS_READ | CFS_WRITE | CFS_APPEND);
   if(rel->tuple_storage < 0) {
@@ -119,6 +157,8 @@ storage_unload(relation_t *rel)
 {
   if(RELATION_HAS_TUPLES(rel)) {
     PRINTF("DB: Unload tuple file %s\n", rel->tuple_filename);
+    BLOCK_INVALIDATE();
+    storage_end_batch(rel);
 
     cfs_close(rel->tuple_storage);
     rel->tuple_storage = -1;
@@ -279,6 +319,13 @@ storage_put_attribute(relation_t *rel, attribute_t *attr)
 db_result_t
 storage_drop_relation(relation_t *rel, int remove_tuples)
 {
+  BLOCK_INVALIDATE();
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(insert_buffer.rel == rel) {
+    insert_buffer.rel = NULL;
+    insert_buffer.length = 0;
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
   if(remove_tuples && RELATION_HAS_TUPLES(rel)) {
     cfs_remove(rel->tuple_filename);
   }
@@ -297,6 +344,7 @@ storage_rename_relation(char *old_name, char *new_name)
 
   result = DB_STORAGE_ERROR;
   old_fd = new_fd = -1;
+  BLOCK_INVALIDATE();
 
   old_fd = cfs_open(old_name, CFS_READ);
   new_fd = cfs_open(new_name, CFS_WRITE);
@@ -400,26 +448,53 @@ storage_put_index(index_t *index)
   return result;
 }
 
-db_result_t
-storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
+#if DB_FEATURE_COFFEE && DB_STORAGE_BLOCK_SIZE > 0
+/* Find the rows starting at tuple_id in memory-mapped storage, which
+   lets a scan use them without copying them to the row block. */
+static const unsigned char *
+map_rows(relation_t *rel, tuple_id_t tuple_id, unsigned *nrows)
 {
-  int r;
-  tuple_id_t nrows;
+  const unsigned char *rows;
+  cfs_offset_t size;
 
-  if(DB_ERROR(storage_get_row_amount(rel, &nrows))) {
-    return DB_STORAGE_ERROR;
+  if(cfs_seek(rel->tuple_storage, tuple_id * rel->row_length, CFS_SEEK_SET) ==
+     (cfs_offset_t)-1) {
+    return NULL;
   }
 
-  if(*tuple_id >= nrows) {
-    return DB_FINISHED;
+  rows = cfs_coffee_map(rel->tuple_storage, &size);
+  if(rows == NULL || size < rel->row_length) {
+    return NULL;
   }
 
-  if(cfs_seek(rel->tuple_storage, *tuple_id * rel->row_length, CFS_SEEK_SET) ==
+  size /= rel->row_length;
+  *nrows = size > (unsigned)-1 ? (unsigned)-1 : (unsigned)size;
+
+  PRINTF("DB: Mapped %u rows from relation %s\n", *nrows, rel->name);
+
+  return rows;
+}
+#endif /* DB_FEATURE_COFFEE && DB_STORAGE_BLOCK_SIZE > 0 */
+
+static db_result_t
+read_rows(relation_t *rel, tuple_id_t tuple_id, unsigned char *buf,
+          unsigned maxrows, unsigned *nrows)
+{
+  int r;
+  tuple_id_t amount;
+
+  /* Reading at the end of the relation yields no rows, so there
+     is no need to look up the row amount before each read. */
+  if(cfs_seek(rel->tuple_storage, tuple_id * rel->row_length, CFS_SEEK_SET) ==
               (cfs_offset_t)-1) {
+    if(!DB_ERROR(storage_get_row_amount(rel, &amount)) &&
+       tuple_id >= amount) {
+      return DB_FINISHED;
+    }
     return DB_STORAGE_ERROR;
   }
 
-  r = cfs_read(rel->tuple_storage, row, rel->row_length);
+  r = cfs_read(rel->tuple_storage, buf, maxrows * rel->row_length);
   if(r < 0) {
     PRINTF("DB: Reading failed on fd %d\n", rel->tuple_storage);
     return DB_STORAGE_ERROR;
@@ -430,25 +505,94 @@ storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
     return DB_STORAGE_ERROR;
   }
 
-  row[rel->row_length - 1] ^= ROW_XOR;
+  *nrows = r / rel->row_length;
 
-  PRINTF("DB: Read %d bytes from relation %s\n", rel->row_length, rel->name);
+  PRINTF("DB: Read %d bytes from relation %s\n", r, rel->name);
 
   return DB_OK;
 }
 
 db_result_t
-storage_put_row(relation_t *rel, storage_row_t row)
+storage_get_row(relation_t *rel, tuple_id_t *tuple_id, storage_row_t row)
+{
+  db_result_t result;
+  unsigned nrows;
+#if DB_STORAGE_BLOCK_SIZE > 0
+  unsigned maxrows;
+#endif
+
+  BUFFER_FLUSH(rel);
+
+#if DB_STORAGE_BLOCK_SIZE > 0
+
+  if(rel->row_length <= sizeof(row_block.data)) {
+    if(row_block.rel != rel ||
+       *tuple_id < row_block.first ||
+       *tuple_id - row_block.first >= row_block.nrows) {
+      /* Read ahead a block of rows if the relation is being scanned
+         sequentially. Random accesses, such as those made through an
+         index, read a single row. */
+      if(*tuple_id == 0 ||
+         (row_block.rel == rel && *tuple_id == row_block.next)) {
+        maxrows = sizeof(row_block.data) / rel->row_length;
+      } else {
+        maxrows = 1;
+      }
+
+      row_block.rel = NULL;
+#if DB_FEATURE_COFFEE
+      row_block.rows = map_rows(rel, *tuple_id, &nrows);
+      if(row_block.rows == NULL)
+#endif /* DB_FEATURE_COFFEE */
+      {
+        result = read_rows(rel, *tuple_id, row_block.data, maxrows, &nrows);
+        if(result != DB_OK) {
+          return result;
+        }
+        row_block.rows = row_block.data;
+      }
+      row_block.rel = rel;
+      row_block.first = *tuple_id;
+      row_block.nrows = nrows;
+    }
+
+    memcpy(row, row_block.rows +
+           (*tuple_id - row_block.first) * rel->row_length, rel->row_length);
+    row[rel->row_length - 1] ^= ROW_XOR;
+    row_block.next = *tuple_id + 1;
+
+    return DB_OK;
+  }
+#endif /* DB_STORAGE_BLOCK_SIZE > 0 */
+
+  result = read_rows(rel, *tuple_id, row, 1, &nrows);
+  if(result != DB_OK) {
+    return result;
+  }
+
+  row[rel->row_length - 1] ^= ROW_XOR;
+
+  return DB_OK;
+}
+
+static db_result_t
+append_rows(relation_t *rel, unsigned char *data, unsigned length)
 {
   cfs_offset_t end;
-  unsigned remaining;
   int r;
-  unsigned char *last_byte;
 #if DB_FEATURE_INTEGRITY
   int missing_bytes;
   char buf[rel->row_length];
 #endif
 
+#if DB_STORAGE_BLOCK_SIZE > 0
+  /* Coffee may move the file when extending it, so the mapped rows
+     cannot be trusted after an append. */
+  if(row_block.rel == rel && row_block.rows != row_block.data) {
+    BLOCK_INVALIDATE();
+  }
+#endif /* DB_STORAGE_BLOCK_SIZE > 0 */
+
   end = cfs_seek(rel->tuple_storage, 0, CFS_SEEK_END);
   if(end == (cfs_offset_t)-1) {
     return DB_STORAGE_ERROR;
@@ -465,35 +609,108 @@ storage_put_row(relation_t *rel, storage_row_t row)
   }
 #endif
 
+  while(length > 0) {
+    r = cfs_write(rel->tuple_storage, data, length);
+    if(r < 0) {
+      PRINTF("DB: Failed to store %u bytes\n", length);
+      return DB_STORAGE_ERROR;
+    }
+    data += r;
+    length -= r;
+  }
+
+  return DB_OK;
+}
+
+db_result_t
+storage_put_row(relation_t *rel, storage_row_t row)
+{
+  unsigned char *last_byte;
+  db_result_t result;
+
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(insert_buffer.rel == rel && rel->row_length <= sizeof(insert_buffer.data)) {
+    if(insert_buffer.length + rel->row_length > sizeof(insert_buffer.data)) {
+      BUFFER_FLUSH(rel);
+    }
+    last_byte = insert_buffer.data + insert_buffer.length;
+    memcpy(last_byte, row, rel->row_length);
+    last_byte[rel->row_length - 1] ^= ROW_XOR;
+    insert_buffer.length += rel->row_length;
+    return DB_OK;
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+
   /* Ensure that last written byte is separated from 0, to make file
      lengths correct in Coffee. */
   last_byte = row + rel->row_length - 1;
   *last_byte ^= ROW_XOR;
 
-  remaining = rel->row_length;
-  do {
-    r = cfs_write(rel->tuple_storage, row, remaining);
-    if(r < 0) {
-      PRINTF("DB: Failed to store %u bytes\n", remaining);
-      *last_byte ^= ROW_XOR;
-      return DB_STORAGE_ERROR;
-    }
-    row += r;
-    remaining -= r;
-  } while(remaining > 0);
+  result = append_rows(rel, row, rel->row_length);
 
   PRINTF("DB: Stored a of %d bytes\n", rel->row_length);
 
   *last_byte ^= ROW_XOR;
 
+  return result;
+}
+
+db_result_t
+storage_begin_batch(relation_t *rel)
+{
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(insert_buffer.rel != NULL && insert_buffer.rel != rel &&
+     DB_ERROR(storage_end_batch(insert_buffer.rel))) {
+    return DB_STORAGE_ERROR;
+  }
+  insert_buffer.rel = rel;
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
   return DB_OK;
 }
 
+db_result_t
+storage_flush(relation_t *rel)
+{
+#if DB_INSERT_BUFFER_SIZE > 0
+  unsigned length;
+
+  if(insert_buffer.rel != rel || insert_buffer.length == 0) {
+    return DB_OK;
+  }
+
+  /* The rows are written in one append even if the write fails, so
+     that the buffer never holds a partially written batch. */
+  length = insert_buffer.length;
+  insert_buffer.length = 0;
+
+  PRINTF("DB: Flushing %u buffered bytes to relation %s\n", length, rel->name);
+  return append_rows(rel, insert_buffer.data, length);
+#else
+  return DB_OK;
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+}
+
+db_result_t
+storage_end_batch(relation_t *rel)
+{
+  db_result_t result;
+
+  result = storage_flush(rel);
+#if DB_INSERT_BUFFER_SIZE > 0
+  if(insert_buffer.rel == rel) {
+    insert_buffer.rel = NULL;
+  }
+#endif /* DB_INSERT_BUFFER_SIZE > 0 */
+  return result;
+}
+
 db_result_t
 storage_get_row_amount(relation_t *rel, tuple_id_t *amount)
 {
   cfs_offset_t offset;
 
+  BUFFER_FLUSH(rel);
+
   if(rel->row_length == 0) {
     *amount = 0;
   } else {
@@ -548,7 +765,13 @@ storage_read(db_storage_id_t fd,
   ptr = buffer;
   while(length > 0) {
     r = cfs_read(fd, ptr, length);
-    if(r <= 0) {
+    if(r == 0) {
+      /* File systems that do not extend files on seeking reach the
+         end of the file here. */
+      memset(ptr, 0, length);
+      break;
+    }
+    if(r < 0) {
       return DB_STORAGE_ERROR;
     }
     ptr += r;
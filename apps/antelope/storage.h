@@ -68,6 +68,10 @@ db_result_t storage_get_row(relation_t *, tuple_id_t *, storage_row_t);
 db_result_t storage_put_row(relation_t *, storage_row_t);
 db_result_t storage_get_row_amount(relation_t *, tuple_id_t *);
 
+db_result_t storage_begin_batch(relation_t *);
+db_result_t storage_flush(relation_t *);
+db_result_t storage_end_batch(relation_t *);
+
 db_storage_id_t storage_open(const char *);
 void storage_close(db_storage_id_t);
 db_result_t storage_read(db_storage_id_t, void *, unsigned long, unsigned);
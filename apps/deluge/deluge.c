@@ -356,6 +356,9 @@ send_page(struct deluge_object *obj, unsigned pagenum)
   pkt.packetnum = 0;
   pkt.object_id = obj->object_id;
   pkt.crc = 0;
+#if DELUGE_PAGE_CRC
+  pkt.page_crc = obj->pages[pagenum].crc;
+#endif
 
   read_page(obj, pagenum, buf);
 
@@ -467,6 +470,20 @@ handle_packet(struct deluge_msg_packet *msg)
       packetbuf_set_attr(PACKETBUF_ATTR_PACKET_TYPE,
 			 PACKETBUF_ATTR_PACKET_TYPE_STREAM_END);
 
+#if DELUGE_PAGE_CRC
+      crc = crc16_data(current_object.current_page, S_PAGE, 0);
+      if(packet.page_crc != crc) {
+	/* Packets from different versions of the page were mixed;
+	   request the whole page again. */
+	PRINTF("page %u crc: %hu, calculated crc: %hu\n",
+	       packet.pagenum, packet.page_crc, crc);
+	page->packet_set = 0;
+	transition(DELUGE_STATE_MAINTAIN);
+	return;
+      }
+      page->crc = crc;
+#endif
+
       write_page(&current_object, packet.pagenum, current_object.current_page);
       page->version = packet.version;
       page->flags = PAGE_COMPLETE;
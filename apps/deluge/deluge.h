@@ -52,6 +52,15 @@ PROCESS_NAME(deluge_process);
     }							\
   } while (0)
 
+/* If set, data packets carry the CRC of the whole page so that pages
+   assembled from different versions are detected. This changes the
+   packet format: nodes with and without it cannot exchange pages. */
+#ifdef DELUGE_CONF_PAGE_CRC
+#define DELUGE_PAGE_CRC DELUGE_CONF_PAGE_CRC
+#else
+#define DELUGE_PAGE_CRC 0
+#endif
+
 #define DELUGE_UNICAST_CHANNEL		55
 #define DELUGE_BROADCAST_CHANNEL	56
 
@@ -117,6 +126,9 @@ struct deluge_msg_packet {
   uint8_t pagenum;
   uint8_t packetnum;
   uint16_t crc;
+#if DELUGE_PAGE_CRC
+  uint16_t page_crc;
+#endif
   deluge_object_id_t object_id;
   unsigned char payload[S_PKT];
 };
@@ -36,17 +36,22 @@
 #ifndef HAVE_SNPRINTF
 int snprintf(char *str, size_t size, const char *format, ...);
 #endif /* HAVE_SNPRINTF */
+#include <stdlib.h>
 #include <string.h>
 
 #include "contiki-net.h"
 
 #include "webserver.h"
 #include "cfs/cfs.h"
+#include "lib/crc16.h"
 #include "lib/petsciiconv.h"
 #include "http-strings.h"
 #include "urlconv.h"
 
 #include "httpd-cfs.h"
+#if HTTPD_CFS_MAP
+#include "cfs/cfs-coffee.h"
+#endif /* HTTPD_CFS_MAP */
 
 #ifndef WEBSERVER_CONF_CFS_CONNS
 #define CONNS UIP_CONNS
@@ -63,32 +68,77 @@ int snprintf(char *str, size_t size, const char *format, ...);
 #define STATE_WAITING 0
 #define STATE_OUTPUT  1
 
+#define RANGE_NONE   0
+#define RANGE_FROM   1
+#define RANGE_SUFFIX 2
+
+#define FLAG_MATCH 1
+#define FLAG_ETAG  2
+
 #define SEND_STRING(s, str) PSOCK_SEND(s, (uint8_t *)str, strlen(str))
 MEMB(conns, struct httpd_state, CONNS);
 
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
 
+/*---------------------------------------------------------------------------*/
+#if HTTPD_CFS_SEEK
+/* Reads the next segment of the file directly into the uIP buffer.
+   The protosocket calls this again for every retransmission, so the
+   data is read from the file instead of being kept in a buffer. */
+static unsigned short
+generate_file(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+#if HTTPD_CFS_MAP
+  const char *map;
+  cfs_offset_t size;
+#endif /* HTTPD_CFS_MAP */
+
+  s->len = s->end - s->offset > uip_mss() ? uip_mss() : s->end - s->offset;
+  cfs_seek(s->fd, s->offset, CFS_SEEK_SET);
+
+#if HTTPD_CFS_MAP
+  /* Copy directly from the storage if it is memory-mapped. */
+  map = cfs_coffee_map(s->fd, &size);
+  if(map != NULL) {
+    memcpy(uip_appdata, map, s->len);
+    return s->len;
+  }
+#endif /* HTTPD_CFS_MAP */
+
+  s->len = cfs_read(s->fd, uip_appdata, s->len);
+  if(s->len < 0) {
+    s->len = 0;
+  }
+  return s->len;
+}
+#endif /* HTTPD_CFS_SEEK */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(send_file(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
-  
+
+#if HTTPD_CFS_SEEK
+  while(s->offset < s->end) {
+    PSOCK_GENERATOR_SEND(&s->sout, generate_file, s);
+    s->offset += s->len;
+  }
+#else /* HTTPD_CFS_SEEK */
+  /* The file can only be read once, so it is sent from a buffer. The
+     headers have been sent, so the output buffer is free again. */
   do {
-    /* Read data from file system into buffer */
     s->len = cfs_read(s->fd, s->outputbuf, sizeof(s->outputbuf));
-
-    /* If there is data in the buffer, send it */
     if(s->len > 0) {
       PSOCK_SEND(&s->sout, (uint8_t *)s->outputbuf, s->len);
-    } else {
-      break;
     }
   } while(s->len > 0);
-      
+#endif /* HTTPD_CFS_SEEK */
+
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
@@ -125,17 +175,163 @@ get_content_type(const char *filename)
   return ptr;
 }
 /*---------------------------------------------------------------------------*/
+static void
+add_header(struct httpd_state *s, const char *str)
+{
+  int len;
+
+  len = strlen(str);
+  if(s->len + len > (int)sizeof(s->outputbuf)) {
+    len = sizeof(s->outputbuf) - s->len;
+  }
+  memcpy(&s->outputbuf[s->len], str, len);
+  s->len += len;
+}
+/*---------------------------------------------------------------------------*/
+/* Collects the response headers in the output buffer, so that they
+   are sent in as few segments as possible. The input buffer is no
+   longer in use and holds the formatted header lines. */
+static void
+format_headers(struct httpd_state *s, const char *statushdr)
+{
+  s->len = 0;
+  add_header(s, statushdr);
+
+#if HTTPD_CFS_SEEK
+  if(s->fd >= 0) {
+    if(statushdr == http_header_416) {
+      snprintf(s->inputbuf, sizeof(s->inputbuf),
+               "Content-Range: bytes */%lu\r\n", (unsigned long)s->size);
+      add_header(s, s->inputbuf);
+    } else if(statushdr != http_header_304) {
+      if(statushdr == http_header_206) {
+        snprintf(s->inputbuf, sizeof(s->inputbuf),
+                 "Content-Range: bytes %lu-%lu/%lu\r\n",
+                 (unsigned long)s->offset, (unsigned long)s->end - 1,
+                 (unsigned long)s->size);
+        add_header(s, s->inputbuf);
+      }
+      snprintf(s->inputbuf, sizeof(s->inputbuf), "Content-Length: %lu\r\n",
+               (unsigned long)(s->end - s->offset));
+      add_header(s, s->inputbuf);
+    }
+#if HTTPD_CFS_ETAG
+    if(s->flags & FLAG_ETAG) {
+      snprintf(s->inputbuf, sizeof(s->inputbuf), "ETag: \"%lx-%x\"\r\n",
+               (unsigned long)s->size, s->etag);
+      add_header(s, s->inputbuf);
+    }
+#endif /* HTTPD_CFS_ETAG */
+  }
+#endif /* HTTPD_CFS_SEEK */
+
+  if(statushdr == http_header_304 || statushdr == http_header_416) {
+    add_header(s, http_crnl);
+  } else {
+    add_header(s, get_content_type(s->filename));
+  }
+}
+/*---------------------------------------------------------------------------*/
 static
-PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+PT_THREAD(send_headers(struct httpd_state *s))
 {
   PSOCK_BEGIN(&s->sout);
 
-  SEND_STRING(&s->sout, statushdr);
-  SEND_STRING(&s->sout, get_content_type(s->filename));
+  PSOCK_SEND(&s->sout, (uint8_t *)s->outputbuf, s->len);
 
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+#if HTTPD_CFS_ETAG
+static unsigned short
+file_crc(struct httpd_state *s)
+{
+  unsigned short crc;
+  cfs_offset_t offset;
+  int len;
+#if HTTPD_CFS_MAP
+  const char *map;
+  cfs_offset_t size;
+#endif /* HTTPD_CFS_MAP */
+
+  cfs_seek(s->fd, 0, CFS_SEEK_SET);
+
+#if HTTPD_CFS_MAP
+  map = cfs_coffee_map(s->fd, &size);
+  if(map != NULL) {
+    return crc16_data((const unsigned char *)map, size, 0);
+  }
+#endif /* HTTPD_CFS_MAP */
+
+  /* Nothing has been sent yet, so the uIP buffer is free to read
+     the file into. */
+  crc = 0;
+  for(offset = 0; offset < s->size; offset += len) {
+    len = cfs_read(s->fd, uip_appdata, uip_mss());
+    if(len <= 0) {
+      break;
+    }
+    crc = crc16_data(uip_appdata, len, crc);
+  }
+  return crc;
+}
+#endif /* HTTPD_CFS_ETAG */
+/*---------------------------------------------------------------------------*/
+/* Decides how to answer the request for an opened file, and sets the
+   part of the file to send. Returns the status header. */
+static const char *
+prepare_file(struct httpd_state *s)
+{
+#if HTTPD_CFS_SEEK
+  s->size = cfs_seek(s->fd, 0, CFS_SEEK_END);
+  if(s->size < 0) {
+    s->size = 0;
+  }
+
+#if HTTPD_CFS_ETAG
+  /* The tag costs a read pass over the file. It is only computed when
+     an If-None-Match of the right size may match it, and for complete
+     responses, which hand it out. */
+  if(((s->flags & FLAG_MATCH) && s->matchsize == s->size) ||
+     s->range == RANGE_NONE) {
+    s->etag = file_crc(s);
+    s->flags |= FLAG_ETAG;
+    if((s->flags & FLAG_MATCH) &&
+       s->match == s->etag && s->matchsize == s->size) {
+      s->offset = s->end = 0;
+      return http_header_304;
+    }
+  }
+#endif /* HTTPD_CFS_ETAG */
+
+  if(s->range == RANGE_SUFFIX) {
+    /* The end holds the length of the suffix. */
+    if(s->end > s->size) {
+      s->end = s->size;
+    }
+    s->offset = s->size - s->end;
+    s->end = s->size;
+  } else if(s->range == RANGE_FROM) {
+    if(s->end < 0 || s->end > s->size) {
+      s->end = s->size;
+    }
+  } else {
+    s->offset = 0;
+    s->end = s->size;
+    return http_header_200;
+  }
+
+  if(s->offset >= s->end) {
+    s->offset = s->end = 0;
+    return http_header_416;
+  }
+  return http_header_206;
+#else /* HTTPD_CFS_SEEK */
+  /* The size is unknown, so ranges are ignored. */
+  return http_header_200;
+#endif /* HTTPD_CFS_SEEK */
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
@@ -148,8 +344,13 @@ PT_THREAD(handle_output(struct httpd_state *s))
     strcpy(s->filename, "/notfound.htm");
     s->fd = cfs_open(&s->filename[1], CFS_READ);
     petsciiconv_toascii(s->filename, sizeof(s->filename));
-    PT_WAIT_THREAD(&s->outputpt,
-                   send_headers(s, http_header_404));
+    s->flags = 0;
+    s->offset = 0;
+#if HTTPD_CFS_SEEK
+    s->size = s->end = s->fd < 0 ? 0 : cfs_seek(s->fd, 0, CFS_SEEK_END);
+#endif /* HTTPD_CFS_SEEK */
+    format_headers(s, http_header_404);
+    PT_WAIT_THREAD(&s->outputpt, send_headers(s));
     if(s->fd < 0) {
       PT_WAIT_THREAD(&s->outputpt,
                      send_string(s, "not found"));
@@ -159,8 +360,8 @@ PT_THREAD(handle_output(struct httpd_state *s))
     }
     webserver_log_file(&uip_conn->ripaddr, "404 - notfound.htm");
   } else {
-    PT_WAIT_THREAD(&s->outputpt,
-		   send_headers(s, http_header_200));
+    format_headers(s, prepare_file(s));
+    PT_WAIT_THREAD(&s->outputpt, send_headers(s));
   }
   PT_WAIT_THREAD(&s->outputpt, send_file(s));
   cfs_close(s->fd);
@@ -169,6 +370,64 @@ PT_THREAD(handle_output(struct httpd_state *s))
   PT_END(&s->outputpt);
 }
 /*---------------------------------------------------------------------------*/
+/* Parses a single byte range: "first-last", "first-" or "-suffix".
+   Ranges that cannot be parsed, and lists of ranges, are ignored and
+   the whole file is sent. */
+static void
+parse_range(struct httpd_state *s, char *str)
+{
+  char *end;
+
+  s->range = RANGE_NONE;
+  if(*str == '-') {
+    s->end = strtoul(str + 1, &end, 10);
+    if(end == str + 1) {
+      return;
+    }
+    s->range = RANGE_SUFFIX;
+  } else {
+    s->offset = strtoul(str, &end, 10);
+    if(end == str || *end != '-') {
+      return;
+    }
+    str = end + 1;
+    s->end = strtoul(str, &end, 10);
+    if(end == str) {
+      s->end = -1;
+    } else if(s->end < s->offset) {
+      return;
+    } else {
+      ++s->end;
+    }
+    s->range = RANGE_FROM;
+  }
+  if(*end == ',') {
+    s->range = RANGE_NONE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if HTTPD_CFS_ETAG
+/* Parses the first entity tag of an If-None-Match header, which
+   matches if it is one that we have sent. */
+static void
+parse_etag(struct httpd_state *s, char *str)
+{
+  char *end;
+
+  if(strncmp(str, "W/", 2) == 0) {
+    str += 2;
+  }
+  if(*str == '"') {
+    ++str;
+  }
+  s->matchsize = strtoul(str, &end, 16);
+  if(end != str && *end == '-') {
+    s->match = strtoul(end + 1, NULL, 16);
+    s->flags |= FLAG_MATCH;
+  }
+}
+#endif /* HTTPD_CFS_ETAG */
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_input(struct httpd_state *s))
 {
@@ -200,17 +459,34 @@ PT_THREAD(handle_input(struct httpd_state *s))
   petsciiconv_topetscii(s->filename, sizeof(s->filename));
   webserver_log_file(&uip_conn->ripaddr, s->filename);
   petsciiconv_toascii(s->filename, sizeof(s->filename));
-  s->state = STATE_OUTPUT;
 
+  /* Read the rest of the request line and the headers. The response
+     depends on the headers, so it is sent after the empty line that
+     ends them. */
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
 
+    if(s->inputbuf[0] == ISO_cr || s->inputbuf[0] == ISO_nl) {
+      break;
+    }
+
     if(strncmp(s->inputbuf, http_referer, 8) == 0) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
       petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
       webserver_log(s->inputbuf);
+    } else if(strncmp(s->inputbuf, http_range,
+                      sizeof(http_range) - 1) == 0) {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      parse_range(s, &s->inputbuf[sizeof(http_range) - 1]);
+#if HTTPD_CFS_ETAG
+    } else if(strncmp(s->inputbuf, http_if_none_match,
+                      sizeof(http_if_none_match) - 1) == 0) {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      parse_etag(s, &s->inputbuf[sizeof(http_if_none_match) - 1]);
+#endif /* HTTPD_CFS_ETAG */
     }
   }
+  s->state = STATE_OUTPUT;
   
   PSOCK_END(&s->sin);
 }
@@ -218,7 +494,9 @@ PT_THREAD(handle_input(struct httpd_state *s))
 static void
 handle_connection(struct httpd_state *s)
 {
-  handle_input(s);
+  if(s->state == STATE_WAITING) {
+    handle_input(s);
+  }
   if(s->state == STATE_OUTPUT) {
     handle_output(s);
   }
@@ -250,6 +528,8 @@ httpd_appcall(void *state)
     PT_INIT(&s->outputpt);
     s->fd = -1;
     s->state = STATE_WAITING;
+    s->range = RANGE_NONE;
+    s->flags = 0;
     timer_set(&s->timer, CLOCK_SECOND * 10);
     handle_connection(s);
   } else if(s != NULL) {
@@ -35,6 +35,7 @@
 #define HTTPD_CFS_H_
 
 #include "contiki-net.h"
+#include "cfs/cfs.h"
 
 #ifndef WEBSERVER_CONF_CFS_PATHLEN
 #define HTTPD_PATHLEN 80
@@ -42,16 +43,59 @@
 #define HTTPD_PATHLEN WEBSERVER_CONF_CFS_PATHLEN
 #endif /* WEBSERVER_CONF_CFS_CONNS */
 
+/* Read the file at the send offset, so that retransmissions need no
+   buffer. Without seeking, the file is read once through the output
+   buffer, and the size, ranges and ETags are unavailable. */
+#ifndef WEBSERVER_CONF_CFS_SEEK
+#define HTTPD_CFS_SEEK 1
+#else /* WEBSERVER_CONF_CFS_SEEK */
+#define HTTPD_CFS_SEEK WEBSERVER_CONF_CFS_SEEK
+#endif /* WEBSERVER_CONF_CFS_SEEK */
+
+/* Send files directly from memory-mapped Coffee storage. */
+#ifndef WEBSERVER_CONF_CFS_MAP
+#define HTTPD_CFS_MAP 0
+#else /* WEBSERVER_CONF_CFS_MAP */
+#define HTTPD_CFS_MAP WEBSERVER_CONF_CFS_MAP
+#endif /* WEBSERVER_CONF_CFS_MAP */
+
+/* Send an ETag computed from the file contents and answer a matching
+   If-None-Match with 304. Computing the tag reads the whole file
+   before a complete response or a 304 is sent. */
+#ifndef WEBSERVER_CONF_CFS_ETAG
+#define HTTPD_CFS_ETAG 0
+#else /* WEBSERVER_CONF_CFS_ETAG */
+#define HTTPD_CFS_ETAG WEBSERVER_CONF_CFS_ETAG
+#endif /* WEBSERVER_CONF_CFS_ETAG */
+
+#if !HTTPD_CFS_SEEK && (HTTPD_CFS_MAP || HTTPD_CFS_ETAG)
+#error "WEBSERVER_CONF_CFS_MAP and WEBSERVER_CONF_CFS_ETAG need WEBSERVER_CONF_CFS_SEEK"
+#endif
+
+/* The buffer that holds the response headers. */
+#ifndef WEBSERVER_CONF_CFS_HDRLEN
+#define HTTPD_HDRLEN 256
+#else /* WEBSERVER_CONF_CFS_HDRLEN */
+#define HTTPD_HDRLEN WEBSERVER_CONF_CFS_HDRLEN
+#endif /* WEBSERVER_CONF_CFS_HDRLEN */
+
 struct httpd_state {
   struct timer timer;
   struct psock sin, sout;
   struct pt outputpt;
   char inputbuf[HTTPD_PATHLEN + 30];
-  char outputbuf[UIP_TCP_MSS];
+  char outputbuf[HTTPD_HDRLEN];
   char filename[HTTPD_PATHLEN];
   char state;
+  char range;
+  char flags;
   int fd;
   int len;
+  cfs_offset_t offset, end, size;
+#if HTTPD_CFS_ETAG
+  unsigned short etag, match;
+  cfs_offset_t matchsize;
+#endif /* HTTPD_CFS_ETAG */
 };
 
 
@@ -65,8 +65,8 @@ loop:
   goto loop;
 }
 /*-----------------------------------------------------------------------------------*/
-int
-httpd_fs_open(const char *name, struct httpd_fs_file *file)
+static struct httpd_fsdata_file_noconst *
+httpd_fs_find(const char *name)
 {
 #if HTTPD_FS_STATISTICS
   uint16_t i = 0;
@@ -78,19 +78,53 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
       f = (struct httpd_fsdata_file_noconst *)f->next) {
 
     if(httpd_fs_strcmp(name, f->name) == 0) {
-      file->data = f->data;
-      file->len = f->len;
 #if HTTPD_FS_STATISTICS
       ++count[i];
 #endif /* HTTPD_FS_STATISTICS */
-      return 1;
+      return f;
     }
 #if HTTPD_FS_STATISTICS
     ++i;
 #endif /* HTTPD_FS_STATISTICS */
 
   }
-  return 0;
+  return NULL;
+}
+/*-----------------------------------------------------------------------------------*/
+int
+httpd_fs_open(const char *name, struct httpd_fs_file *file)
+{
+  struct httpd_fsdata_file_noconst *f;
+
+  f = httpd_fs_find(name);
+  if(f == NULL) {
+    return 0;
+  }
+  file->data = f->data;
+  file->len = f->len;
+  file->hdr = f->hdr;
+  return 1;
+}
+/*-----------------------------------------------------------------------------------*/
+int
+httpd_fs_open_gzip(const char *name, struct httpd_fs_file *file)
+{
+  struct httpd_fsdata_file_noconst *f;
+
+  f = httpd_fs_find(name);
+  if(f == NULL) {
+    return 0;
+  }
+  if(f->gzdata == NULL) {
+    file->data = f->data;
+    file->len = f->len;
+    file->hdr = f->hdr;
+  } else {
+    file->data = f->gzdata;
+    file->len = f->gzlen;
+    file->hdr = f->gzhdr;
+  }
+  return 1;
 }
 /*-----------------------------------------------------------------------------------*/
 void
@@ -41,12 +41,17 @@
 struct httpd_fs_file {
   char *data;
   int len;
+  const char *hdr;
 };
 
 /* file must be allocated by caller and will be filled in
    by the function. */
 int httpd_fs_open(const char *name, struct httpd_fs_file *file);
 
+/* As httpd_fs_open(), but opens the gzip-compressed variant of the
+   file if it has one. */
+int httpd_fs_open_gzip(const char *name, struct httpd_fs_file *file);
+
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1  
 uint16_t httpd_fs_count(char *name);
@@ -41,6 +41,10 @@ struct httpd_fsdata_file {
   const char *name;
   const char *data;
   const int len;
+  const char *hdr;
+  const char *gzdata;
+  const int gzlen;
+  const char *gzhdr;
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1
   uint16_t count;
@@ -53,6 +57,10 @@ struct httpd_fsdata_file_noconst {
   char *name;
   char *data;
   int len;
+  char *hdr;
+  char *gzdata;
+  int gzlen;
+  char *gzhdr;
 #ifdef HTTPD_FS_STATISTICS
 #if HTTPD_FS_STATISTICS == 1
   uint16_t count;
@@ -33,6 +33,7 @@
  */
  
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "contiki-net.h"
@@ -58,12 +59,36 @@
 MEMB(conns, struct httpd_state, CONNS);
 
 #define ISO_nl      0x0a
+#define ISO_cr      0x0d
 #define ISO_space   0x20
 #define ISO_bang    0x21
 #define ISO_percent 0x25
 #define ISO_period  0x2e
 #define ISO_slash   0x2f
 #define ISO_colon   0x3a
+#define ISO_semicolon 0x3b
+#define ISO_equal   0x3d
+#define ISO_q       0x71
+
+#if HTTPD_CGI_CACHE
+/* The output of a script, kept so that the script does not have to
+   run for every page view. */
+struct httpd_cgi_cache {
+  /* The script tag in the file system, or NULL if the entry is
+     unused. */
+  char *script;
+  /* The connection that fills the entry with the output of the
+     script. */
+  struct httpd_state *owner;
+  /* The number of connections that send the entry. */
+  unsigned char readers;
+  struct timer timer;
+  unsigned short len;
+  char data[HTTPD_CGI_CACHE_SIZE];
+};
+
+static struct httpd_cgi_cache cgi_cache[HTTPD_CGI_CACHE];
+#endif /* HTTPD_CGI_CACHE */
 
 /*---------------------------------------------------------------------------*/
 static unsigned short
@@ -105,6 +130,88 @@ PT_THREAD(send_part_of_file(struct httpd_state *s))
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+#if HTTPD_CGI_CACHE
+static struct httpd_cgi_cache *
+cache_lookup(char *script)
+{
+  uint8_t i;
+
+  for(i = 0; i < HTTPD_CGI_CACHE; ++i) {
+    if(cgi_cache[i].script == script && cgi_cache[i].owner == NULL &&
+       !timer_expired(&cgi_cache[i].timer)) {
+      ++cgi_cache[i].readers;
+      return &cgi_cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct httpd_cgi_cache *
+cache_fill(struct httpd_state *s, char *script)
+{
+  uint8_t i;
+
+  for(i = 0; i < HTTPD_CGI_CACHE; ++i) {
+    if(cgi_cache[i].owner == NULL && cgi_cache[i].readers == 0 &&
+       (cgi_cache[i].script == NULL || timer_expired(&cgi_cache[i].timer))) {
+      cgi_cache[i].script = script;
+      cgi_cache[i].owner = s;
+      cgi_cache[i].len = 0;
+      return &cgi_cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Adds the data that the script sent in this call to the entry that
+   the connection fills. Retransmissions are not added again. */
+static void
+cache_append(struct httpd_state *s)
+{
+  struct httpd_cgi_cache *c = s->cache;
+
+  if(c == NULL || c->owner != s || c->script == NULL ||
+     uip_slen == 0 || uip_rexmit()) {
+    return;
+  }
+  if(c->len + uip_slen > HTTPD_CGI_CACHE_SIZE) {
+    /* The output is too large to be cached. */
+    c->script = NULL;
+  } else {
+    memcpy(&c->data[c->len], uip_appdata, uip_slen);
+    c->len += uip_slen;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+cache_release(struct httpd_state *s, char complete)
+{
+  if(s->cache == NULL) {
+    return;
+  }
+  if(s->cache->owner == s) {
+    s->cache->owner = NULL;
+    if(!complete) {
+      s->cache->script = NULL;
+    }
+    timer_set(&s->cache->timer, HTTPD_CGI_CACHE_TIME);
+  } else {
+    --s->cache->readers;
+  }
+  s->cache = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_cached(struct httpd_state *s))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  PSOCK_SEND(&s->sout, (uint8_t *)s->cache->data, s->cache->len);
+
+  PSOCK_END(&s->sout);
+}
+#endif /* HTTPD_CGI_CACHE */
+/*---------------------------------------------------------------------------*/
 static void
 next_scriptstate(struct httpd_state *s)
 {
@@ -141,8 +248,20 @@ PT_THREAD(handle_script(struct httpd_state *s))
 	httpd_fs_open(s->scriptptr + 1, &s->file);
 	PT_WAIT_THREAD(&s->scriptpt, send_file(s));
       } else {
+#if HTTPD_CGI_CACHE
+	s->cache = cache_lookup(s->scriptptr);
+	if(s->cache != NULL) {
+	  PT_WAIT_THREAD(&s->scriptpt, send_cached(s));
+	} else {
+	  s->cache = cache_fill(s, s->scriptptr);
+	  PT_WAIT_THREAD(&s->scriptpt,
+			 httpd_cgi(s->scriptptr)(s, s->scriptptr));
+	}
+	cache_release(s, 1);
+#else /* HTTPD_CGI_CACHE */
 	PT_WAIT_THREAD(&s->scriptpt,
 		       httpd_cgi(s->scriptptr)(s, s->scriptptr));
+#endif /* HTTPD_CGI_CACHE */
       }
       next_scriptstate(s);
       
@@ -181,19 +300,12 @@ PT_THREAD(handle_script(struct httpd_state *s))
   PT_END(&s->scriptpt);
 }
 /*---------------------------------------------------------------------------*/
-static
-PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+static const char *
+get_content_type(const char *filename)
 {
-/* gcc warning if not initialized. 
- * If initialized, minimal-net platform segmentation fault if not static...
- */
-  static const char *ptr = NULL;
+  const char *ptr;
 
-  PSOCK_BEGIN(&s->sout);
-
-  SEND_STRING(&s->sout, statushdr);
-
-  ptr = strrchr(s->filename, ISO_period);
+  ptr = strrchr(filename, ISO_period);
   if(ptr == NULL) {
     ptr = http_content_type_binary;
   } else if(strncmp(http_html, ptr, 5) == 0 ||
@@ -210,10 +322,144 @@ PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
   } else {
     ptr = http_content_type_plain;
   }
-  SEND_STRING(&s->sout, ptr);
+  return ptr;
+}
+/*---------------------------------------------------------------------------*/
+/* The headers are the status line, the precomputed headers of the
+   file, if any, and the content type. */
+static const char *
+header_part(struct httpd_state *s, int i)
+{
+  if(i == 0) {
+    return s->statushdr;
+  } else if(i == 1) {
+    return s->file.hdr;
+  }
+  return get_content_type(s->filename);
+}
+/*---------------------------------------------------------------------------*/
+static int
+headers_len(struct httpd_state *s)
+{
+  int i, len;
+
+  len = 0;
+  for(i = 0; i < 3; ++i) {
+    if(header_part(s, i) != NULL) {
+      len += strlen(header_part(s, i));
+    }
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+/* Generates the headers that follow the last acknowledged segment, so
+   that all headers share as few segments as possible. */
+static unsigned short
+generate_headers(void *state)
+{
+  struct httpd_state *s = (struct httpd_state *)state;
+  const char *part;
+  int i, skip, len;
+
+  skip = s->hdroffset;
+  s->len = 0;
+  for(i = 0; i < 3 && s->len < uip_mss(); ++i) {
+    part = header_part(s, i);
+    if(part == NULL) {
+      continue;
+    }
+    len = strlen(part);
+    if(skip >= len) {
+      skip -= len;
+      continue;
+    }
+    len -= skip;
+    if(len > uip_mss() - s->len) {
+      len = uip_mss() - s->len;
+    }
+    memcpy((char *)uip_appdata + s->len, part + skip, len);
+    s->len += len;
+    skip = 0;
+  }
+  return s->len;
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_headers(struct httpd_state *s, const char *statushdr))
+{
+  PSOCK_BEGIN(&s->sout);
+
+  s->statushdr = statushdr;
+  s->hdroffset = 0;
+  while(s->hdroffset < headers_len(s)) {
+    PSOCK_GENERATOR_SEND(&s->sout, generate_headers, s);
+    s->hdroffset += s->len;
+  }
+
   PSOCK_END(&s->sout);
 }
 /*---------------------------------------------------------------------------*/
+static unsigned long
+parse_etag(const char *str)
+{
+  if(strncmp(str, "W/", 2) == 0) {
+    str += 2;
+  }
+  if(*str == '"') {
+    ++str;
+  }
+  return strtoul(str, NULL, 16);
+}
+/*---------------------------------------------------------------------------*/
+/* Returns non-zero if an Accept-Encoding list names gzip without a
+   q-value of zero, which would mean that gzip is not acceptable. */
+static char
+accepts_gzip(const char *str)
+{
+  str = strstr(str, http_gzip);
+  if(str == NULL) {
+    return 0;
+  }
+  str += sizeof(http_gzip) - 1;
+  while(*str == ISO_space) {
+    ++str;
+  }
+  if(*str != ISO_semicolon) {
+    return 1;
+  }
+  do {
+    ++str;
+  } while(*str == ISO_space);
+  if(str[0] != ISO_q || str[1] != ISO_equal) {
+    return 1;
+  }
+  /* The value is zero unless a non-zero digit follows. */
+  for(str += 2; *str == '0' || *str == ISO_period; ++str);
+  return *str >= '1' && *str <= '9';
+}
+/*---------------------------------------------------------------------------*/
+static int
+etag_matches(struct httpd_state *s)
+{
+  const char *ptr;
+
+  if(s->etag == 0 || s->file.hdr == NULL) {
+    return 0;
+  }
+  ptr = strstr(s->file.hdr, http_etag);
+  return ptr != NULL &&
+    parse_etag(ptr + sizeof(http_etag) - 1) == s->etag;
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_file(struct httpd_state *s)
+{
+  if(s->gzip) {
+    return httpd_fs_open_gzip(s->filename, &s->file);
+  }
+  return httpd_fs_open(s->filename, &s->file);
+}
+/*---------------------------------------------------------------------------*/
 static
 PT_THREAD(handle_output(struct httpd_state *s))
 {
@@ -221,14 +467,18 @@ PT_THREAD(handle_output(struct httpd_state *s))
   
   PT_BEGIN(&s->outputpt);
  
-  if(!httpd_fs_open(s->filename, &s->file)) {
+  if(!open_file(s)) {
     strcpy(s->filename, http_404_html);
-    httpd_fs_open(s->filename, &s->file);
+    open_file(s);
     PT_WAIT_THREAD(&s->outputpt,
 		   send_headers(s,
 		   http_header_404));
     PT_WAIT_THREAD(&s->outputpt,
 		   send_file(s));
+  } else if(etag_matches(s)) {
+    PT_WAIT_THREAD(&s->outputpt,
+		   send_headers(s,
+		   http_header_304));
   } else {
     PT_WAIT_THREAD(&s->outputpt,
 		   send_headers(s,
@@ -272,17 +522,31 @@ PT_THREAD(handle_input(struct httpd_state *s))
   petsciiconv_topetscii(s->filename, sizeof(s->filename));
   webserver_log_file(&uip_conn->ripaddr, s->filename);
   petsciiconv_toascii(s->filename, sizeof(s->filename));
-  s->state = STATE_OUTPUT;
 
+  /* The response depends on the headers, so it is sent after the
+     empty line that ends them. */
   while(1) {
     PSOCK_READTO(&s->sin, ISO_nl);
 
+    if(s->inputbuf[0] == ISO_cr || s->inputbuf[0] == ISO_nl) {
+      break;
+    }
+
     if(strncmp(s->inputbuf, http_referer, 8) == 0) {
       s->inputbuf[PSOCK_DATALEN(&s->sin) - 2] = 0;
       petsciiconv_topetscii(s->inputbuf, PSOCK_DATALEN(&s->sin) - 2);
       webserver_log(s->inputbuf);
+    } else if(strncmp(s->inputbuf, http_accept_encoding,
+		      sizeof(http_accept_encoding) - 1) == 0) {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      s->gzip = accepts_gzip(&s->inputbuf[sizeof(http_accept_encoding) - 1]);
+    } else if(strncmp(s->inputbuf, http_if_none_match,
+		      sizeof(http_if_none_match) - 1) == 0) {
+      s->inputbuf[PSOCK_DATALEN(&s->sin) - 1] = 0;
+      s->etag = parse_etag(&s->inputbuf[sizeof(http_if_none_match) - 1]);
     }
   }
+  s->state = STATE_OUTPUT;
   
   PSOCK_END(&s->sin);
 }
@@ -290,10 +554,15 @@ PT_THREAD(handle_input(struct httpd_state *s))
 static void
 handle_connection(struct httpd_state *s)
 {
-  handle_input(s);
+  if(s->state == STATE_WAITING) {
+    handle_input(s);
+  }
   if(s->state == STATE_OUTPUT) {
     handle_output(s);
   }
+#if HTTPD_CGI_CACHE
+  cache_append(s);
+#endif /* HTTPD_CGI_CACHE */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -303,6 +572,9 @@ httpd_appcall(void *state)
 
   if(uip_closed() || uip_aborted() || uip_timedout()) {
     if(s != NULL) {
+#if HTTPD_CGI_CACHE
+      cache_release(s, 0);
+#endif /* HTTPD_CGI_CACHE */
       memb_free(&conns, s);
     }
   } else if(uip_connected()) {
@@ -316,6 +588,11 @@ httpd_appcall(void *state)
     PSOCK_INIT(&s->sout, (uint8_t *)s->inputbuf, sizeof(s->inputbuf) - 1);
     PT_INIT(&s->outputpt);
     s->state = STATE_WAITING;
+    s->gzip = 0;
+    s->etag = 0;
+#if HTTPD_CGI_CACHE
+    s->cache = NULL;
+#endif /* HTTPD_CGI_CACHE */
     /*    timer_set(&s->timer, CLOCK_SECOND * 100);*/
     s->timer = 0;
     handle_connection(s);
@@ -324,6 +601,9 @@ httpd_appcall(void *state)
       ++s->timer;
       if(s->timer >= 20) {
 	uip_abort();
+#if HTTPD_CGI_CACHE
+	cache_release(s, 0);
+#endif /* HTTPD_CGI_CACHE */
 	memb_free(&conns, s);
       }
     } else {
@@ -38,6 +38,30 @@
 #include "contiki-net.h"
 #include "httpd-fs.h"
 
+/* The number of scripts whose output is cached, or zero to disable
+   the cache. */
+#ifndef WEBSERVER_CONF_CGI_CACHE
+#define HTTPD_CGI_CACHE 0
+#else /* WEBSERVER_CONF_CGI_CACHE */
+#define HTTPD_CGI_CACHE WEBSERVER_CONF_CGI_CACHE
+#endif /* WEBSERVER_CONF_CGI_CACHE */
+
+/* The largest script output that is cached. */
+#ifndef WEBSERVER_CONF_CGI_CACHE_SIZE
+#define HTTPD_CGI_CACHE_SIZE 256
+#else /* WEBSERVER_CONF_CGI_CACHE_SIZE */
+#define HTTPD_CGI_CACHE_SIZE WEBSERVER_CONF_CGI_CACHE_SIZE
+#endif /* WEBSERVER_CONF_CGI_CACHE_SIZE */
+
+/* How long cached script output is used. */
+#ifndef WEBSERVER_CONF_CGI_CACHE_TIME
+#define HTTPD_CGI_CACHE_TIME (CLOCK_SECOND * 5)
+#else /* WEBSERVER_CONF_CGI_CACHE_TIME */
+#define HTTPD_CGI_CACHE_TIME WEBSERVER_CONF_CGI_CACHE_TIME
+#endif /* WEBSERVER_CONF_CGI_CACHE_TIME */
+
+struct httpd_cgi_cache;
+
 struct httpd_state {
   unsigned char timer;
   struct psock sin, sout;
@@ -45,10 +69,17 @@ struct httpd_state {
   char inputbuf[50];
   char filename[20];
   char state;
+  char gzip;
   struct httpd_fs_file file;  
   int len;
   char *scriptptr;
   int scriptlen;
+  const char *statushdr;
+  int hdroffset;
+  unsigned long etag;
+#if HTTPD_CGI_CACHE
+  struct httpd_cgi_cache *cache;
+#endif /* HTTPD_CGI_CACHE */
   union {
     unsigned short count;
     void *ptr;
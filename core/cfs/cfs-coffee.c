@@ -54,7 +54,7 @@
 #define PRINTF(...)
 #endif
 
-#include "contiki-conf.h"
+#include "contiki.h"
 #include "cfs/cfs.h"
 #include "cfs-coffee-arch.h"
 #include "cfs/cfs-coffee.h"
@@ -90,6 +90,56 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING	1
 #endif
 
+/*
+ * Incremental garbage collection keeps a summary of the page states
+ * of each sector in RAM, and reclaims sectors from a background
+ * process instead of scanning the whole storage when a reservation
+ * fails. The summary costs three page counters per sector.
+ */
+#ifndef COFFEE_INCREMENTAL_GC
+#define COFFEE_INCREMENTAL_GC	0
+#endif
+
+/* The number of sectors that the background garbage collector may
+   erase before it yields to other processes. */
+#ifndef COFFEE_GC_BUDGET
+#define COFFEE_GC_BUDGET	1
+#endif
+
+/*
+ * The wear levelling allocator chooses sectors for new files using
+ * the sector summary instead of taking the first fit. Files that are
+ * likely to be modified, i.e., micro logs, files rewritten by log
+ * merges, and files created without an explicit reservation, are kept
+ * apart from files reserved with cfs_coffee_reserve(). New sectors for
+ * the former are taken from the least erased sectors, and new sectors
+ * for the latter from the most erased ones.
+ */
+#ifndef COFFEE_WEAR_LEVELLING_ALLOCATOR
+#define COFFEE_WEAR_LEVELLING_ALLOCATOR	0
+#endif
+
+#if COFFEE_WEAR_LEVELLING_ALLOCATOR && !COFFEE_INCREMENTAL_GC
+#error "COFFEE_WEAR_LEVELLING_ALLOCATOR requires COFFEE_INCREMENTAL_GC."
+#endif
+
+/* With extended wear levelling, the background garbage collector
+   leaves obsolete sectors alone until fewer than this many sectors
+   worth of free pages remain. */
+#ifndef COFFEE_GC_FREE_SECTORS
+#define COFFEE_GC_FREE_SECTORS	2
+#endif
+
+/*
+ * Vectored reads and writes transfer buffers that are adjacent in
+ * memory with a single storage operation. Non-adjacent buffers that
+ * together fit in this many bytes are gathered in a static buffer
+ * and transferred together as well.
+ */
+#ifndef COFFEE_IOV_BUFFER_SIZE
+#define COFFEE_IOV_BUFFER_SIZE	0
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -107,11 +157,14 @@
 #define REMOVE_LOG		1
 #define CLOSE_FDS		1
 #define ALLOW_GC		1
+#define HOT_FILE		1
 
 /* "Greedy" garbage collection erases as many sectors as possible. */
 #define GC_GREEDY		0
 /* "Reluctant" garbage collection stops after erasing one sector. */
 #define GC_RELUCTANT		1
+/* The background garbage collector has nothing to do. */
+#define GC_IDLE			2
 
 /* File descriptor macros. */
 #define FD_VALID(fd)					\
@@ -159,8 +212,33 @@ struct sector_status {
   coffee_page_t active;
   coffee_page_t obsolete;
   coffee_page_t free;
+  /* Obsolete pages at the start of the sector that belong to a file
+     extent whose header is in a previous sector. */
+  coffee_page_t continued;
+};
+
+#if COFFEE_INCREMENTAL_GC
+/* The page states of a sector, kept up to date when files are
+   reserved, removed, and erased. */
+struct sector_summary {
+  coffee_page_t active;
+  coffee_page_t obsolete;
+  /* Pages at the start of the sector that belong to a file
+     extent whose header is in a previous sector. */
+  coffee_page_t continued;
+#if COFFEE_WEAR_LEVELLING_ALLOCATOR
+  /* Set if the sector was opened for frequently modified files. */
+  uint8_t hot;
+#endif
+  /* Erasures since the system started. */
+  uint32_t erases;
 };
 
+#define SUMMARY_ACTIVE		0
+#define SUMMARY_OBSOLETE	1
+#define SUMMARY_REMOVE		2
+#endif /* COFFEE_INCREMENTAL_GC */
+
 /* The structure of cached file objects. */
 struct file {
   cfs_offset_t end;
@@ -217,12 +295,34 @@ static struct file_desc * const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t * const next_free = &protected_mem.next_free;
 static char * const gc_wait = &protected_mem.gc_wait;
 
+static struct cfs_coffee_stats coffee_stats;
+
+#if COFFEE_INCREMENTAL_GC
+static struct sector_summary sector_summary[COFFEE_SECTOR_COUNT];
+static char summary_valid;
+
+PROCESS(coffee_gc_process, "Coffee GC");
+#endif /* COFFEE_INCREMENTAL_GC */
+
+/* Storage access that is accounted for in the statistics. */
+#define STORAGE_WRITE(buf, size, offset)			\
+  do {								\
+    coffee_stats.bytes_written += (size);			\
+    COFFEE_WRITE((buf), (size), (offset));			\
+  } while(0)
+
+#define STORAGE_ERASE(sector)					\
+  do {								\
+    coffee_stats.sector_erases++;				\
+    COFFEE_ERASE(sector);					\
+  } while(0)
+
 /*---------------------------------------------------------------------------*/
 static void
 write_header(struct file_header *hdr, coffee_page_t page)
 {
   hdr->flags |= HDR_FLAG_VALID;
-  COFFEE_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
+  STORAGE_WRITE(hdr, sizeof(*hdr), page * COFFEE_PAGE_SIZE);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -242,6 +342,7 @@ absolute_offset(coffee_page_t page, cfs_offset_t offset)
   return page * COFFEE_PAGE_SIZE + sizeof(struct file_header) + offset;
 }
 /*---------------------------------------------------------------------------*/
+#if !COFFEE_INCREMENTAL_GC
 static coffee_page_t
 get_sector_status(uint16_t sector, struct sector_status *stats)
 {
@@ -283,10 +384,12 @@ get_sector_status(uint16_t sector, struct sector_status *stats)
   } else {
     if(skip_pages >= COFFEE_PAGES_PER_SECTOR) {
       stats->obsolete = COFFEE_PAGES_PER_SECTOR;
+      stats->continued = COFFEE_PAGES_PER_SECTOR;
       skip_pages -= COFFEE_PAGES_PER_SECTOR;
       return skip_pages >= COFFEE_PAGES_PER_SECTOR ? 0 : skip_pages;
     }
     obsolete = skip_pages;
+    stats->continued = skip_pages;
   }
 
   /* Determine the amount of pages of each type that have not been 
@@ -341,6 +444,7 @@ get_sector_status(uint16_t sector, struct sector_status *stats)
   return (last_pages_are_active || (skip_pages >= COFFEE_PAGES_PER_SECTOR)) ?
 	0 : skip_pages;
 }
+#endif /* !COFFEE_INCREMENTAL_GC */
 /*---------------------------------------------------------------------------*/
 static void
 isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
@@ -363,30 +467,301 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
 }
 /*---------------------------------------------------------------------------*/
 static void
+account_gc(clock_time_t start, int foreground)
+{
+  clock_time_t pause;
+
+  pause = clock_time() - start;
+  coffee_stats.gc_runs++;
+  coffee_stats.gc_time += pause;
+  if(foreground) {
+    coffee_stats.gc_foreground_runs++;
+    coffee_stats.gc_foreground_time += pause;
+  }
+  if(pause > coffee_stats.gc_max_pause) {
+    coffee_stats.gc_max_pause = pause;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if COFFEE_INCREMENTAL_GC
+static coffee_page_t next_file(coffee_page_t page, struct file_header *hdr);
+
+static void
+update_summary(coffee_page_t page, coffee_page_t count, int change)
+{
+  struct sector_summary *summary;
+  coffee_page_t pages;
+  unsigned sector;
+  int continued;
+
+  if(!summary_valid) {
+    return;
+  }
+
+  if(count > COFFEE_PAGE_COUNT - page) {
+    count = COFFEE_PAGE_COUNT - page;
+  }
+
+  sector = page / COFFEE_PAGES_PER_SECTOR;
+  for(continued = 0; count > 0; continued = 1, sector++) {
+    summary = &sector_summary[sector];
+    pages = (sector + 1) * COFFEE_PAGES_PER_SECTOR - page;
+    if(pages > count) {
+      pages = count;
+    }
+
+    if(change == SUMMARY_REMOVE) {
+      summary->active -= pages;
+      summary->obsolete += pages;
+    } else {
+      if(change == SUMMARY_ACTIVE) {
+        summary->active += pages;
+      } else {
+        summary->obsolete += pages;
+      }
+      if(continued) {
+        summary->continued = pages;
+      }
+    }
+
+    page += pages;
+    count -= pages;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+clear_summary(unsigned sector)
+{
+  sector_summary[sector].active = 0;
+  sector_summary[sector].obsolete = 0;
+  sector_summary[sector].continued = 0;
+#if COFFEE_WEAR_LEVELLING_ALLOCATOR
+  sector_summary[sector].hot = 0;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_summary(void)
+{
+  struct file_header hdr;
+  coffee_page_t page;
+  unsigned sector;
+
+  PRINTF("Coffee: Building the sector summary\n");
+
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    clear_summary(sector);
+  }
+  summary_valid = 1;
+
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr)) {
+      update_summary(page, hdr.max_pages, SUMMARY_ACTIVE);
+    } else if(HDR_ISOLATED(hdr)) {
+      update_summary(page, 1, SUMMARY_OBSOLETE);
+    } else if(HDR_OBSOLETE(hdr)) {
+      update_summary(page, hdr.max_pages, SUMMARY_OBSOLETE);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+reclaim_sector(unsigned sector)
+{
+  unsigned first, last;
+  coffee_page_t first_page, lead;
+
+  /*
+   * The following sectors that are completely covered by the obsolete
+   * extent must be erased at the same time, since they do not start
+   * with a header. An extent that ends within a sector is split by
+   * isolating its remaining pages, as in the scanning collector.
+   */
+  for(last = sector;
+      last + 1 < COFFEE_SECTOR_COUNT &&
+      sector_summary[last + 1].continued == COFFEE_PAGES_PER_SECTOR;
+      last++);
+
+  if(last + 1 < COFFEE_SECTOR_COUNT && sector_summary[last + 1].continued > 0) {
+    isolate_pages((last + 1) * COFFEE_PAGES_PER_SECTOR,
+                  sector_summary[last + 1].continued);
+    sector_summary[last + 1].continued = 0;
+  }
+
+  first_page = sector * COFFEE_PAGES_PER_SECTOR;
+  if(first_page < *next_free) {
+    *next_free = first_page;
+  }
+
+  lead = sector_summary[sector].continued;
+  for(first = sector; sector <= last; sector++) {
+    STORAGE_ERASE(sector);
+    clear_summary(sector);
+    sector_summary[sector].erases++;
+    PRINTF("Coffee: Erased sector %u!\n", sector);
+  }
+
+  /*
+   * The header of an obsolete extent in the previous sector still
+   * covers the first pages. These are isolated again so that no file
+   * is allocated underneath the extent, since scans that pass through
+   * the previous sector would skip the start of such a file.
+   */
+  if(lead > 0) {
+    isolate_pages(first_page, lead);
+    sector_summary[first].obsolete = lead;
+    sector_summary[first].continued = lead;
+  }
+
+  return sector - first;
+}
+/*---------------------------------------------------------------------------*/
+static int
+reclaim_sectors(int mode, unsigned budget)
+{
+  struct sector_summary *summary;
+  unsigned sector;
+  unsigned erased;
+
+  if(!summary_valid) {
+    build_summary();
+  }
+
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    summary = &sector_summary[sector];
+    /*
+     * The leading pages that belong to an extent in a previous sector
+     * are isolated again after an erase, so erasing frees only the
+     * obsolete pages beyond them. If there are none, the sector is
+     * left alone. Its leading pages become reclaimable once the
+     * sector holding the extent's header is erased, which isolates
+     * them and clears the continued count.
+     */
+    if(summary->active > 0 || summary->obsolete <= summary->continued ||
+       (mode == GC_RELUCTANT &&
+        summary->obsolete < COFFEE_PAGES_PER_SECTOR)) {
+      continue;
+    }
+
+    if(budget == 0) {
+      /* There are more sectors to reclaim. */
+      return 1;
+    }
+
+    erased = reclaim_sector(sector);
+    budget = erased < budget ? budget - erased : 0;
+    sector += erased - 1;
+  }
+
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+background_gc_mode(void)
+{
+  unsigned sector;
+  unsigned long free_pages;
+
+  free_pages = 0;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    free_pages += COFFEE_PAGES_PER_SECTOR - sector_summary[sector].active -
+                  sector_summary[sector].obsolete;
+  }
+
+  if(free_pages < COFFEE_GC_FREE_SECTORS * COFFEE_PAGES_PER_SECTOR) {
+    return GC_GREEDY;
+  }
+#if COFFEE_EXTENDED_WEAR_LEVELLING
+  return GC_IDLE;
+#else
+  return GC_RELUCTANT;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  clock_time_t start;
+  int mode;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    start = clock_time();
+    if(!summary_valid) {
+      build_summary();
+    }
+
+    mode = background_gc_mode();
+    if(mode != GC_IDLE) {
+      PRINTF("Coffee: Background garbage collection in %s mode\n",
+             mode == GC_RELUCTANT ? "reluctant" : "greedy");
+      if(reclaim_sectors(mode, COFFEE_GC_BUDGET)) {
+        /* Continue after other processes have had a chance to run. */
+        process_poll(&coffee_gc_process);
+      }
+      account_gc(start, 0);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_gc(void)
+{
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
+  process_poll(&coffee_gc_process);
+}
+#endif /* COFFEE_INCREMENTAL_GC */
+/*---------------------------------------------------------------------------*/
+static void
 collect_garbage(int mode)
 {
+  clock_time_t start;
+#if !COFFEE_INCREMENTAL_GC
   uint16_t sector;
   struct sector_status stats;
-  coffee_page_t first_page, isolation_count;
+  coffee_page_t first_page, isolation_count, lead;
+  int erased;
+#endif
 
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
 	 mode == GC_RELUCTANT ? "reluctant" : "greedy");
+
+  start = clock_time();
+#if COFFEE_INCREMENTAL_GC
+  reclaim_sectors(mode, COFFEE_SECTOR_COUNT);
+#else
   /*
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
    */
+  erased = 0;
   for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
     isolation_count = get_sector_status(sector, &stats);
     PRINTF("Coffee: Sector %u has %u active, %u obsolete, and %u free pages.\n",
         sector, (unsigned)stats.active,
 	(unsigned)stats.obsolete, (unsigned)stats.free);
 
-    if(stats.active > 0) {
+    /*
+     * Unless the previous sector has just been erased, the header of
+     * the extent that the sector starts with still covers the leading
+     * pages. They must be isolated again after the erase, so that no
+     * file is allocated where scans would skip its header.
+     */
+    lead = erased ? 0 : stats.continued;
+    erased = 0;
+
+    if(stats.active > 0 || stats.obsolete <= lead) {
       continue;
     }
 
-    if((mode == GC_RELUCTANT && stats.free == 0) ||
-       (mode == GC_GREEDY && stats.obsolete > 0)) {
+    if((mode == GC_RELUCTANT && stats.free == 0) || mode == GC_GREEDY) {
       first_page = sector * COFFEE_PAGES_PER_SECTOR;
       if(first_page < *next_free) {
         *next_free = first_page;
@@ -396,14 +771,21 @@ collect_garbage(int mode)
         isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
       }
 
-      COFFEE_ERASE(sector);
+      STORAGE_ERASE(sector);
       PRINTF("Coffee: Erased sector %d!\n", sector);
+      erased = 1;
+
+      if(lead > 0) {
+        isolate_pages(first_page, lead);
+      }
 
       if(mode == GC_RELUCTANT && isolation_count > 0) {
         break;
       }
     }
   }
+#endif /* COFFEE_INCREMENTAL_GC */
+  account_gc(start, 1);
 }
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
@@ -533,8 +915,100 @@ file_end(coffee_page_t start)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if COFFEE_WEAR_LEVELLING_ALLOCATOR
 static coffee_page_t
-find_contiguous_pages(coffee_page_t amount)
+used_pages(unsigned sector)
+{
+  return sector_summary[sector].active + sector_summary[sector].obsolete;
+}
+/*---------------------------------------------------------------------------*/
+static coffee_page_t
+free_extent(unsigned sector, coffee_page_t amount)
+{
+  coffee_page_t start, available;
+
+  /* The free pages of a sector always follow its used pages. */
+  if(used_pages(sector) == COFFEE_PAGES_PER_SECTOR) {
+    return INVALID_PAGE;
+  }
+  start = sector * COFFEE_PAGES_PER_SECTOR + used_pages(sector);
+  available = (sector + 1) * COFFEE_PAGES_PER_SECTOR - start;
+
+  /* A longer extent continues into the following empty sectors. */
+  for(sector++; available < amount && sector < COFFEE_SECTOR_COUNT; sector++) {
+    if(used_pages(sector) > 0) {
+      return INVALID_PAGE;
+    }
+    available += COFFEE_PAGES_PER_SECTOR;
+  }
+
+  return available >= amount ? start : INVALID_PAGE;
+}
+/*---------------------------------------------------------------------------*/
+static coffee_page_t
+find_contiguous_pages(coffee_page_t amount, int hot)
+{
+  unsigned sector, best;
+  coffee_page_t page;
+
+  if(!summary_valid) {
+    build_summary();
+  }
+
+  /* Continue filling an open sector of the same kind. */
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    if(used_pages(sector) > 0 && sector_summary[sector].hot == hot) {
+      page = free_extent(sector, amount);
+      if(page != INVALID_PAGE) {
+        return page;
+      }
+    }
+  }
+
+  /* Open the empty sector whose wear suits the file best. */
+  best = COFFEE_SECTOR_COUNT;
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    if(used_pages(sector) > 0 || free_extent(sector, amount) == INVALID_PAGE) {
+      continue;
+    }
+    if(best == COFFEE_SECTOR_COUNT ||
+       (hot && sector_summary[sector].erases < sector_summary[best].erases) ||
+       (!hot && sector_summary[sector].erases > sector_summary[best].erases)) {
+      best = sector;
+    }
+  }
+  if(best < COFFEE_SECTOR_COUNT) {
+    return best * COFFEE_PAGES_PER_SECTOR;
+  }
+
+  /* Share a sector with files of the other kind as a last resort. */
+  for(sector = 0; sector < COFFEE_SECTOR_COUNT; sector++) {
+    page = free_extent(sector, amount);
+    if(page != INVALID_PAGE) {
+      return page;
+    }
+  }
+
+  return INVALID_PAGE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+classify_sectors(coffee_page_t page, coffee_page_t count, int hot)
+{
+  unsigned sector;
+
+  for(sector = page / COFFEE_PAGES_PER_SECTOR;
+      sector < COFFEE_SECTOR_COUNT &&
+      sector * COFFEE_PAGES_PER_SECTOR < page + count;
+      sector++) {
+    if(used_pages(sector) == 0) {
+      sector_summary[sector].hot = hot;
+    }
+  }
+}
+#else /* COFFEE_WEAR_LEVELLING_ALLOCATOR */
+static coffee_page_t
+find_contiguous_pages(coffee_page_t amount, int hot)
 {
   coffee_page_t page, start;
   struct file_header hdr;
@@ -568,6 +1042,7 @@ find_contiguous_pages(coffee_page_t amount)
   }
   return INVALID_PAGE;
 }
+#endif /* COFFEE_WEAR_LEVELLING_ALLOCATOR */
 /*---------------------------------------------------------------------------*/
 static int
 remove_by_page(coffee_page_t page, int remove_log, int close_fds,
@@ -589,6 +1064,9 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+#if COFFEE_INCREMENTAL_GC
+  update_summary(page, hdr.max_pages, SUMMARY_REMOVE);
+#endif
 
   *gc_wait = 0;
 
@@ -609,7 +1087,11 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
     }
   }
 
-#if !COFFEE_EXTENDED_WEAR_LEVELLING
+#if COFFEE_INCREMENTAL_GC
+  if(gc_allowed) {
+    request_gc();
+  }
+#elif !COFFEE_EXTENDED_WEAR_LEVELLING
   if(gc_allowed) {
     collect_garbage(GC_RELUCTANT);
   }
@@ -627,7 +1109,7 @@ page_count(cfs_offset_t size)
 /*---------------------------------------------------------------------------*/
 static struct file *
 reserve(const char *name, coffee_page_t pages,
-	int allow_duplicates, unsigned flags)
+	int allow_duplicates, unsigned flags, int hot)
 {
   struct file_header hdr;
   coffee_page_t page;
@@ -637,13 +1119,13 @@ reserve(const char *name, coffee_page_t pages,
     return NULL;
   }
 
-  page = find_contiguous_pages(pages);
+  page = find_contiguous_pages(pages, hot);
   if(page == INVALID_PAGE) {
     if(*gc_wait) {
       return NULL;
     }
     collect_garbage(GC_GREEDY);
-    page = find_contiguous_pages(pages);
+    page = find_contiguous_pages(pages, hot);
     if(page == INVALID_PAGE) {
       *gc_wait = 1;
       return NULL;
@@ -655,6 +1137,13 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+#if COFFEE_WEAR_LEVELLING_ALLOCATOR
+  classify_sectors(page, pages, hot);
+#endif
+#if COFFEE_INCREMENTAL_GC
+  update_summary(page, pages, SUMMARY_ACTIVE);
+  request_gc();
+#endif
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
       pages, page, name);
@@ -782,7 +1271,7 @@ create_log(struct file *file, struct file_header *hdr)
   /* Log index size + log data size. */
   size = log_records * (sizeof(uint16_t) + log_record_size);
 
-  log_file = reserve(hdr->name, page_count(size), 1, HDR_FLAG_LOG);
+  log_file = reserve(hdr->name, page_count(size), 1, HDR_FLAG_LOG, HOT_FILE);
   if(log_file == NULL) {
     return INVALID_PAGE;
   }
@@ -818,7 +1307,7 @@ merge_log(coffee_page_t file_page, int extend)
    * already been accounted for in the previous reservation.
    */
   max_pages = hdr.max_pages << extend;
-  new_file = reserve(hdr.name, max_pages, 1, 0);
+  new_file = reserve(hdr.name, max_pages, 1, 0, HOT_FILE);
   if(new_file == NULL) {
     cfs_close(fd);
     return -1;
@@ -833,7 +1322,7 @@ merge_log(coffee_page_t file_page, int extend)
       cfs_close(fd);
       return -1;
     } else if(n > 0) {
-      COFFEE_WRITE(buf, n, absolute_offset(new_file->page, offset));
+      STORAGE_WRITE(buf, n, absolute_offset(new_file->page, offset));
       offset += n;
     }
   } while(n != 0);
@@ -966,11 +1455,11 @@ write_log_page(struct file *file, struct log_param *lp)
      */
     offset = absolute_offset(log_page, 0);
     ++region;
-    COFFEE_WRITE(&region, sizeof(region),
+    STORAGE_WRITE(&region, sizeof(region),
 		 offset + log_record * sizeof(region));
 
     offset += log_records * sizeof(region);
-    COFFEE_WRITE(copy_buf, sizeof(copy_buf),
+    STORAGE_WRITE(copy_buf, sizeof(copy_buf),
 		 offset + log_record * log_record_size);
     file->record_count = log_record + 1;
   }
@@ -1012,7 +1501,7 @@ cfs_open(const char *name, int flags)
     if((flags & (CFS_READ | CFS_WRITE)) == CFS_READ) {
       return -1;
     }
-    fdp->file = reserve(name, page_count(COFFEE_DYN_SIZE), 1, 0);
+    fdp->file = reserve(name, page_count(COFFEE_DYN_SIZE), 1, 0, HOT_FILE);
     if(fdp->file == NULL) {
       return -1;
     }
@@ -1218,7 +1707,7 @@ cfs_write(int fd, const void *buf, unsigned size)
 
     if(fdp->offset > file->end) {
       /* Update the original file's end with a dummy write. */
-      COFFEE_WRITE(dummy, 1, absolute_offset(file->page, fdp->offset));
+      STORAGE_WRITE(dummy, 1, absolute_offset(file->page, fdp->offset));
     }
   } else {
 #endif /* COFFEE_MICRO_LOGS */
@@ -1228,7 +1717,7 @@ cfs_write(int fd, const void *buf, unsigned size)
     }
 #endif /* COFFEE_APPEND_ONLY */
 
-    COFFEE_WRITE(buf, size, absolute_offset(file->page, fdp->offset));
+    STORAGE_WRITE(buf, size, absolute_offset(file->page, fdp->offset));
     fdp->offset += size;
 #if COFFEE_MICRO_LOGS
   }
@@ -1238,9 +1727,196 @@ cfs_write(int fd, const void *buf, unsigned size)
     file->end = fdp->offset;
   }
 
+  coffee_stats.bytes_requested += size;
+
   return size;
 }
 /*---------------------------------------------------------------------------*/
+static int
+transfer_vector(int fd, const struct cfs_iovec *iov, int iovcnt, int output)
+{
+#if COFFEE_IOV_BUFFER_SIZE > 0
+  static char buf[COFFEE_IOV_BUFFER_SIZE];
+  char *bufp;
+#endif
+  struct file_desc *fdp;
+  struct file *file;
+  cfs_offset_t total, done, run;
+  unsigned len;
+  int i, j, r;
+  int adjacent;
+
+  if(!(FD_VALID(fd) &&
+       (output ? FD_WRITABLE(fd) : FD_READABLE(fd)))) {
+    return -1;
+  }
+  fdp = &coffee_fd_set[fd];
+
+  for(total = 0, i = 0; i < iovcnt; i++) {
+    total += iov[i].iov_len;
+  }
+
+  /* Extend the file once for the whole vector. */
+  if(output) {
+#if COFFEE_IO_SEMANTICS
+    if(!(fdp->io_flags & CFS_COFFEE_IO_FIRM_SIZE)) {
+#endif
+    while(total + fdp->offset + sizeof(struct file_header) >
+          (fdp->file->max_pages * COFFEE_PAGE_SIZE)) {
+      if(merge_log(fdp->file->page, 1) < 0) {
+        return -1;
+      }
+    }
+#if COFFEE_IO_SEMANTICS
+    }
+#endif
+  }
+
+  file = fdp->file;
+  if(FILE_MODIFIED(file) || (output && fdp->offset < file->end)) {
+    /* Logged data and overwrites take the ordinary path. */
+    for(done = 0; iovcnt > 0; iov++, iovcnt--) {
+      r = output ? cfs_write(fd, iov->iov_base, iov->iov_len) :
+                   cfs_read(fd, iov->iov_base, iov->iov_len);
+      if(r < 0) {
+        return done > 0 ? done : -1;
+      }
+      done += r;
+      if(r < iov->iov_len) {
+        break;
+      }
+    }
+    return done;
+  }
+
+  if(!output && fdp->offset + total > file->end) {
+    total = file->end - fdp->offset;
+  }
+
+  for(done = 0, i = 0; done < total; done += run, i = j) {
+    /*
+     * Collect a run of buffers that can be transferred with one
+     * storage operation: either buffers that are adjacent in memory,
+     * or buffers that fit together in the gather buffer.
+     */
+    run = iov[i].iov_len < total - done ? iov[i].iov_len : total - done;
+    adjacent = 1;
+    for(j = i + 1; j < iovcnt && done + run < total; j++) {
+      len = iov[j].iov_len < total - done - run ?
+            iov[j].iov_len : total - done - run;
+      if(adjacent &&
+         (char *)iov[j - 1].iov_base + iov[j - 1].iov_len ==
+         (char *)iov[j].iov_base) {
+        run += len;
+#if COFFEE_IOV_BUFFER_SIZE > 0
+      } else if(run + len <= sizeof(buf)) {
+        adjacent = 0;
+        run += len;
+#endif
+      } else {
+        break;
+      }
+    }
+
+    if(adjacent) {
+      if(output) {
+        STORAGE_WRITE(iov[i].iov_base, run,
+                      absolute_offset(file->page, fdp->offset));
+      } else {
+        COFFEE_READ(iov[i].iov_base, run,
+                    absolute_offset(file->page, fdp->offset));
+      }
+    }
+#if COFFEE_IOV_BUFFER_SIZE > 0
+    else {
+      if(!output) {
+        COFFEE_READ(buf, run, absolute_offset(file->page, fdp->offset));
+      }
+      for(bufp = buf; i < j; i++) {
+        len = iov[i].iov_len < buf + run - bufp ?
+              iov[i].iov_len : buf + run - bufp;
+        if(output) {
+          memcpy(bufp, iov[i].iov_base, len);
+        } else {
+          memcpy(iov[i].iov_base, bufp, len);
+        }
+        bufp += len;
+      }
+      if(output) {
+        STORAGE_WRITE(buf, run, absolute_offset(file->page, fdp->offset));
+      }
+    }
+#endif /* COFFEE_IOV_BUFFER_SIZE > 0 */
+    fdp->offset += run;
+  }
+
+  if(output) {
+    if(fdp->offset > file->end) {
+      file->end = fdp->offset;
+    }
+    coffee_stats.bytes_requested += total;
+  }
+
+  return total;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_readv(int fd, const struct cfs_iovec *iov, int iovcnt)
+{
+  return transfer_vector(fd, iov, iovcnt, 0);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_writev(int fd, const struct cfs_iovec *iov, int iovcnt)
+{
+  return transfer_vector(fd, iov, iovcnt, 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_pread(int fd, void *buf, unsigned size, cfs_offset_t offset)
+{
+  struct file_desc *fdp;
+  cfs_offset_t saved_offset;
+  int r;
+
+  if(!(FD_VALID(fd) && FD_READABLE(fd)) || offset < 0) {
+    return -1;
+  }
+  fdp = &coffee_fd_set[fd];
+
+  /* Unlike cfs_seek(), a read beyond the end does not extend the file. */
+  if(offset >= fdp->file->end) {
+    return 0;
+  }
+
+  saved_offset = fdp->offset;
+  fdp->offset = offset;
+  r = cfs_read(fd, buf, size);
+  fdp->offset = saved_offset;
+
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_pwrite(int fd, const void *buf, unsigned size, cfs_offset_t offset)
+{
+  cfs_offset_t saved_offset;
+  int r;
+
+  if(!FD_VALID(fd)) {
+    return -1;
+  }
+
+  saved_offset = coffee_fd_set[fd].offset;
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) == (cfs_offset_t)-1) {
+    return -1;
+  }
+  r = cfs_write(fd, buf, size);
+  coffee_fd_set[fd].offset = saved_offset;
+
+  return r;
+}
+/*---------------------------------------------------------------------------*/
 int
 cfs_opendir(struct cfs_dir *dir, const char *name)
 {
@@ -1284,10 +1960,36 @@ cfs_closedir(struct cfs_dir *dir)
   return;
 }
 /*---------------------------------------------------------------------------*/
+const void *
+cfs_coffee_map(int fd, cfs_offset_t *size)
+{
+#ifdef COFFEE_MAP
+  struct file_desc *fdp;
+
+  if(!(FD_VALID(fd) && FD_READABLE(fd))) {
+    return NULL;
+  }
+
+  fdp = &coffee_fd_set[fd];
+  if(FILE_MODIFIED(fdp->file)) {
+    /* Parts of the file may reside in its micro log. */
+    return NULL;
+  }
+  if(fdp->offset >= fdp->file->end) {
+    return NULL;
+  }
+
+  *size = fdp->file->end - fdp->offset;
+  return COFFEE_MAP(absolute_offset(fdp->file->page, fdp->offset));
+#else
+  return NULL;
+#endif /* COFFEE_MAP */
+}
+/*---------------------------------------------------------------------------*/
 int
 cfs_coffee_reserve(const char *name, cfs_offset_t size)
 {
-  return reserve(name, page_count(size), 0, 0) == NULL ? -1 : 0;
+  return reserve(name, page_count(size), 0, 0, !HOT_FILE) == NULL ? -1 : 0;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -1344,12 +2046,19 @@ cfs_coffee_format(void)
   *next_free = 0;
 
   for(i = 0; i < COFFEE_SECTOR_COUNT; i++) {
-    COFFEE_ERASE(i);
+    STORAGE_ERASE(i);
+#if COFFEE_INCREMENTAL_GC
+    clear_summary(i);
+    sector_summary[i].erases++;
+#endif
     PRINTF(".");
   }
 
   /* Formatting invalidates the file information. */
   memset(&protected_mem, 0, sizeof(protected_mem));
+#if COFFEE_INCREMENTAL_GC
+  summary_valid = 1;
+#endif
 
   PRINTF(" done!\n");
 
@@ -1359,6 +2068,29 @@ cfs_coffee_format(void)
 void *
 cfs_coffee_get_protected_mem(unsigned *size)
 {
+#if COFFEE_INCREMENTAL_GC
+  /* The storage may be rolled back, so rebuild the summary later. */
+  summary_valid = 0;
+#endif
   *size = sizeof(protected_mem);
   return &protected_mem;
 }
+/*---------------------------------------------------------------------------*/
+#if COFFEE_INCREMENTAL_GC
+unsigned
+cfs_coffee_get_erase_counts(unsigned long *counts, unsigned sectors)
+{
+  unsigned i;
+
+  for(i = 0; i < sectors && i < COFFEE_SECTOR_COUNT; i++) {
+    counts[i] = sector_summary[i].erases;
+  }
+  return COFFEE_SECTOR_COUNT;
+}
+#endif /* COFFEE_INCREMENTAL_GC */
+/*---------------------------------------------------------------------------*/
+void
+cfs_coffee_get_stats(struct cfs_coffee_stats *stats)
+{
+  memcpy(stats, &coffee_stats, sizeof(*stats));
+}
@@ -39,6 +39,7 @@
 #define CFS_COFFEE_H
 
 #include "cfs.h"
+#include "sys/clock.h"
 
 /**
  * Instruct Coffee that the access pattern to this file is adapted to 
@@ -63,6 +64,30 @@
  */
 #define CFS_COFFEE_IO_FIRM_SIZE		0x2
 
+/**
+ * Statistics about the storage activity and the garbage collection
+ * of Coffee. The write amplification is the ratio between
+ * bytes_written and bytes_requested.
+ *
+ * \sa cfs_coffee_get_stats()
+ */
+struct cfs_coffee_stats {
+  /** Bytes written by applications through cfs_write(). */
+  unsigned long bytes_requested;
+  /** Bytes written to the storage, including headers, logs, and merges. */
+  unsigned long bytes_written;
+  /** Erased sectors. */
+  unsigned long sector_erases;
+  /** Garbage collection runs, and the runs that stalled a file operation. */
+  unsigned long gc_runs;
+  unsigned long gc_foreground_runs;
+  /** Time spent collecting garbage, in total and during file operations. */
+  clock_time_t gc_time;
+  clock_time_t gc_foreground_time;
+  /** The longest single garbage collection run. */
+  clock_time_t gc_max_pause;
+};
+
 /**
  * \file
  *	Header for the Coffee file system.
@@ -116,6 +141,28 @@ int cfs_coffee_configure_log(const char *file, unsigned log_size,
  */
 int cfs_coffee_set_io_semantics(int fd, unsigned flags);
 
+/**
+ * \brief Get direct read access to the data of a file.
+ * \param fd The file descriptor through which the file is read.
+ * \param size A pointer to the number of bytes that can be read.
+ * \return A pointer to the data at the current file offset, or NULL.
+ *
+ * If the storage is memory-mapped, as configured through COFFEE_MAP
+ * in cfs-coffee-arch.h, this function returns a pointer to the file
+ * data from the current offset of the file descriptor to the end of
+ * the file, and writes the number of bytes available to size. The
+ * file offset is not moved.
+ *
+ * NULL is returned if the storage is not memory-mapped, if the file
+ * has been modified through a micro log, or if the offset is at the
+ * end of the file. The caller must then read the file with cfs_read()
+ * instead.
+ *
+ * The pointer is valid until the file is written to or removed, since
+ * Coffee may move a file when extending it.
+ */
+const void *cfs_coffee_map(int fd, cfs_offset_t *size);
+
 /**
  * \brief Format the storage area assigned to Coffee.
  * \return 0 on success, -1 on failure.
@@ -138,6 +185,29 @@ int cfs_coffee_format(void);
  */
 void *cfs_coffee_get_protected_mem(unsigned *size);
 
+/**
+ * \brief Get the storage and garbage collection statistics.
+ * \param stats A pointer to the structure to fill in.
+ *
+ * The statistics accumulate from system startup. When Coffee is
+ * configured with COFFEE_INCREMENTAL_GC, most sectors are reclaimed
+ * by a background process, and gc_foreground_runs only counts the
+ * collections that a failed reservation forced.
+ */
+void cfs_coffee_get_stats(struct cfs_coffee_stats *stats);
+
+/**
+ * \brief Get the number of times each sector has been erased.
+ * \param counts An array to fill in with the erase counts.
+ * \param sectors The number of elements in the array.
+ * \return The number of sectors of the file system.
+ *
+ * The erase counts are kept in RAM and accumulate from system
+ * startup. This function is only available when Coffee is
+ * configured with COFFEE_INCREMENTAL_GC.
+ */
+unsigned cfs_coffee_get_erase_counts(unsigned long *counts, unsigned sectors);
+
 /** @} */
 /** @} */
 
@@ -107,6 +107,10 @@ cfs_write(int f, const void *buf, unsigned int len)
 cfs_offset_t
 cfs_seek(int f, cfs_offset_t o, int w)
 {
+  if(w == CFS_SEEK_CUR) {
+    o += file.fileptr;
+    w = CFS_SEEK_SET;
+  }
   if(w == CFS_SEEK_SET && f == 1) {
     file.fileptr = o;
     return o;
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Vectored and positional I/O built on cfs_seek(), cfs_read(),
+ *         and cfs_write(). File systems that have no faster way to do
+ *         these operations link this file alongside their backend.
+ */
+
+#include "cfs/cfs.h"
+
+/*---------------------------------------------------------------------------*/
+static int
+transfer_vector(int fd, const struct cfs_iovec *iov, int iovcnt, int output)
+{
+  int total;
+  int r;
+
+  for(total = 0; iovcnt > 0; iov++, iovcnt--) {
+    r = output ? cfs_write(fd, iov->iov_base, iov->iov_len) :
+                 cfs_read(fd, iov->iov_base, iov->iov_len);
+    if(r < 0) {
+      return total > 0 ? total : -1;
+    }
+    total += r;
+    if(r < iov->iov_len) {
+      break;
+    }
+  }
+  return total;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transfer_at(int fd, void *buf, unsigned int len, cfs_offset_t offset,
+            int output)
+{
+  cfs_offset_t pos;
+  int r;
+
+  pos = cfs_seek(fd, 0, CFS_SEEK_CUR);
+  if(pos == (cfs_offset_t)-1) {
+    return -1;
+  }
+
+  r = -1;
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) == offset) {
+    r = output ? cfs_write(fd, buf, len) : cfs_read(fd, buf, len);
+  }
+
+  /* Leave the file position where it was. */
+  cfs_seek(fd, pos, CFS_SEEK_SET);
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_readv(int fd, const struct cfs_iovec *iov, int iovcnt)
+{
+  return transfer_vector(fd, iov, iovcnt, 0);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_writev(int fd, const struct cfs_iovec *iov, int iovcnt)
+{
+  return transfer_vector(fd, iov, iovcnt, 1);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_pread(int fd, void *buf, unsigned int len, cfs_offset_t offset)
+{
+  return transfer_at(fd, buf, len, offset, 0);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_pwrite(int fd, const void *buf, unsigned int len, cfs_offset_t offset)
+{
+  return transfer_at(fd, (void *)buf, len, offset, 1);
+}
+/*---------------------------------------------------------------------------*/
@@ -40,8 +40,18 @@
 #include <unistd.h>
 #endif
 
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#define POSITIONAL_IO 0
+#else
+#define POSITIONAL_IO 1
+#include <sys/uio.h>
+#endif
+
 #include "cfs/cfs.h"
 
+/* The number of buffers passed to the system in each call. */
+#define IOV_BATCH 16
+
 /*---------------------------------------------------------------------------*/
 int
 cfs_open(const char *n, int f)
@@ -99,6 +109,97 @@ cfs_seek(int f, cfs_offset_t o, int w)
   return lseek(f, o, w);
 }
 /*---------------------------------------------------------------------------*/
+static int
+transfer_vector(int f, const struct cfs_iovec *iov, int iovcnt, int output)
+{
+  int total;
+  int r;
+#if !POSITIONAL_IO
+  for(total = 0; iovcnt > 0; iov++, iovcnt--) {
+    r = output ? cfs_write(f, iov->iov_base, iov->iov_len) :
+                cfs_read(f, iov->iov_base, iov->iov_len);
+    if(r < 0) {
+      return total > 0 ? total : -1;
+    }
+    total += r;
+    if(r < iov->iov_len) {
+      break;
+    }
+  }
+#else
+  struct iovec v[IOV_BATCH];
+  size_t requested;
+  int i, n;
+
+  for(total = 0; iovcnt > 0; iov += n, iovcnt -= n) {
+    n = iovcnt < IOV_BATCH ? iovcnt : IOV_BATCH;
+    for(requested = 0, i = 0; i < n; i++) {
+      v[i].iov_base = iov[i].iov_base;
+      v[i].iov_len = iov[i].iov_len;
+      requested += iov[i].iov_len;
+    }
+    r = output ? writev(f, v, n) : readv(f, v, n);
+    if(r < 0) {
+      return total > 0 ? total : -1;
+    }
+    total += r;
+    if(r < requested) {
+      break;
+    }
+  }
+#endif /* !POSITIONAL_IO */
+  return total;
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_readv(int f, const struct cfs_iovec *iov, int iovcnt)
+{
+  return transfer_vector(f, iov, iovcnt, 0);
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_writev(int f, const struct cfs_iovec *iov, int iovcnt)
+{
+  return transfer_vector(f, iov, iovcnt, 1);
+}
+/*---------------------------------------------------------------------------*/
+#if !POSITIONAL_IO
+static int
+transfer_at(int f, void *b, unsigned int l, cfs_offset_t o, int output)
+{
+  long current;
+  int r;
+
+  current = lseek(f, 0, SEEK_CUR);
+  if(current < 0 || lseek(f, o, SEEK_SET) < 0) {
+    return -1;
+  }
+  r = output ? write(f, b, l) : read(f, b, l);
+  lseek(f, current, SEEK_SET);
+  return r;
+}
+#endif /* !POSITIONAL_IO */
+/*---------------------------------------------------------------------------*/
+int
+cfs_pread(int f, void *b, unsigned int l, cfs_offset_t o)
+{
+#if !POSITIONAL_IO
+  return transfer_at(f, b, l, o, 0);
+#else
+  return pread(f, b, l, o);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+int
+cfs_pwrite(int f, const void *b, unsigned int l, cfs_offset_t o)
+{
+#if !POSITIONAL_IO
+  return transfer_at(f, (void *)b, l, o, 1);
+#else
+  return pwrite(f, b, l, o);
+#endif
+}
+/*---------------------------------------------------------------------------*/
 int
 cfs_remove(const char *name)
 {
@@ -75,6 +75,16 @@ struct cfs_dirent {
   cfs_offset_t size;
 };
 
+/**
+ * A buffer that is part of a vectored read or write.
+ * \sa cfs_readv()
+ * \sa cfs_writev()
+ */
+struct cfs_iovec {
+  void *iov_base;
+  unsigned int iov_len;
+};
+
 /**
  * Specify that cfs_open() should open a file for reading.
  *
@@ -228,6 +238,76 @@ CCIF int cfs_write(int fd, const void *buf, unsigned int len);
 CCIF cfs_offset_t cfs_seek(int fd, cfs_offset_t offset, int whence);
 #endif
 
+/**
+ * \brief      Read data from an open file into several buffers.
+ * \param fd   The file descriptor of the open file.
+ * \param iov  The buffers in which data should be read from the file.
+ * \param iovcnt The number of buffers.
+ * \return     The number of bytes that was actually read from the
+ *             file, or -1 if nothing could be read.
+ *             This function fills the buffers in order, as if
+ *             cfs_read() had been called for each of them, but lets
+ *             the file system transfer the data with fewer operations
+ *             on the storage. Reading stops early at the end of the
+ *             file.
+ * \sa         cfs_read()
+ */
+#ifndef cfs_readv
+CCIF int cfs_readv(int fd, const struct cfs_iovec *iov, int iovcnt);
+#endif
+
+/**
+ * \brief      Write data from several buffers to an open file.
+ * \param fd   The file descriptor of the open file.
+ * \param iov  The buffers from which data should be written to the file.
+ * \param iovcnt The number of buffers.
+ * \return     The number of bytes that was actually written to the
+ *             file, or -1 if nothing could be written.
+ *             This function writes the buffers in order, as if
+ *             cfs_write() had been called for each of them, but lets
+ *             the file system transfer the data with fewer operations
+ *             on the storage.
+ * \sa         cfs_write()
+ */
+#ifndef cfs_writev
+CCIF int cfs_writev(int fd, const struct cfs_iovec *iov, int iovcnt);
+#endif
+
+/**
+ * \brief      Read data from a given position in an open file.
+ * \param fd   The file descriptor of the open file.
+ * \param buf  The buffer in which data should be read from the file.
+ * \param len  The number of bytes that should be read.
+ * \param offset The position in the file from which to read.
+ * \return     The number of bytes that was actually read from the
+ *             file, or -1 if the read failed.
+ *             This function reads data as cfs_read() does after a
+ *             cfs_seek() to the offset, but it does not move the file
+ *             position.
+ * \sa         cfs_read()
+ */
+#ifndef cfs_pread
+CCIF int cfs_pread(int fd, void *buf, unsigned int len, cfs_offset_t offset);
+#endif
+
+/**
+ * \brief      Write data to a given position in an open file.
+ * \param fd   The file descriptor of the open file.
+ * \param buf  The buffer from which data should be written to the file.
+ * \param len  The number of bytes that should be written.
+ * \param offset The position in the file at which to write.
+ * \return     The number of bytes that was actually written to the
+ *             file, or -1 if the write failed.
+ *             This function writes data as cfs_write() does after a
+ *             cfs_seek() to the offset, but it does not move the file
+ *             position.
+ * \sa         cfs_write()
+ */
+#ifndef cfs_pwrite
+CCIF int cfs_pwrite(int fd, const void *buf, unsigned int len,
+                    cfs_offset_t offset);
+#endif
+
 /**
  * \brief      Remove a file.
  * \param name The name of the file.
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The loader of compact ELF (CELF) modules.
+ */
+
+#include "contiki.h"
+
+#include "loader/elfloader.h"
+
+/* The modules are read into raw little-endian structs, so the loader
+   is only compiled where CELF modules are enabled. */
+#if ELFLOADER_CELF
+
+#include "loader/elfloader-arch.h"
+#include "loader/celfloader.h"
+
+#include "cfs/cfs.h"
+#include "loader/symtab.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...) do {} while (0)
+#endif
+
+/* The number of relocations read from the file at a time. */
+#ifdef CELFLOADER_CONF_RELOCS
+#define CELFLOADER_RELOCS CELFLOADER_CONF_RELOCS
+#else
+#define CELFLOADER_RELOCS 8
+#endif
+
+/*---------------------------------------------------------------------------*/
+static int
+seek_read(int fd, unsigned int offset, void *buf, int len)
+{
+  cfs_seek(fd, offset, CFS_SEEK_SET);
+  return cfs_read(fd, buf, len) == len;
+}
+/*---------------------------------------------------------------------------*/
+int
+celfloader_load(int fd)
+{
+  struct celf_header hdr;
+  struct celf_group group;
+  struct celf_reloc reloc[CELFLOADER_RELOCS];
+  struct elf32_rela rela;
+  char *segment[CELF_SEGMENTS];
+  unsigned int segmentoff[CELF_SEGMENTS];
+  unsigned int off;
+  unsigned short g, i, j, n;
+  char *addr;
+
+  elfloader_unknown[0] = 0;
+
+  if(!seek_read(fd, 0, &hdr, sizeof(hdr)) ||
+     memcmp(hdr.magic, CELF_MAGIC, CELF_MAGIC_SIZE) != 0 ||
+     hdr.version != CELF_VERSION) {
+    PRINTF("celfloader: bad header\n");
+    return ELFLOADER_BAD_ELF_HEADER;
+  }
+  if(hdr.segment_size[CELF_TEXT] == 0) {
+    return ELFLOADER_NO_TEXT;
+  }
+
+  /* The same memory layout as that of elfloader_load(). */
+  segment[CELF_BSS] =
+    elfloader_arch_allocate_ram(hdr.segment_size[CELF_BSS] +
+				hdr.segment_size[CELF_DATA]);
+  segment[CELF_DATA] = segment[CELF_BSS] + hdr.segment_size[CELF_BSS];
+  segment[CELF_TEXT] =
+    elfloader_arch_allocate_rom(hdr.segment_size[CELF_TEXT] +
+				hdr.segment_size[CELF_RODATA]);
+  segment[CELF_RODATA] = segment[CELF_TEXT] + hdr.segment_size[CELF_TEXT];
+
+  off = sizeof(hdr);
+  for(i = CELF_TEXT; i < CELF_BSS; ++i) {
+    segmentoff[i] = off;
+    off += hdr.segment_size[i];
+  }
+
+  for(g = 0; g < hdr.groups; ++g) {
+    if(!seek_read(fd, off, &group, sizeof(group))) {
+      return ELFLOADER_BAD_ELF_HEADER;
+    }
+    off += sizeof(group);
+
+    if(group.target == CELF_IMPORT) {
+      if(group.namelen > CELF_NAME_MAX ||
+	 !seek_read(fd, off, elfloader_unknown, group.namelen)) {
+	return ELFLOADER_BAD_ELF_HEADER;
+      }
+      off += group.namelen;
+      elfloader_unknown[group.namelen] = 0;
+      addr = symtab_lookup(elfloader_unknown);
+      if(addr == NULL) {
+	PRINTF("celfloader: unknown name '%s'\n", elfloader_unknown);
+	return ELFLOADER_SYMBOL_NOT_FOUND;
+      }
+      elfloader_unknown[0] = 0;
+    } else if(group.target < CELF_SEGMENTS) {
+      addr = segment[group.target];
+    } else {
+      return ELFLOADER_SEGMENT_NOT_FOUND;
+    }
+
+    /* The architecture specific part writes the relocated values to
+       the file, so the relocations are read a few at a time. */
+    for(i = 0; i < group.relocs; i += n) {
+      n = group.relocs - i;
+      if(n > CELFLOADER_RELOCS) {
+	n = CELFLOADER_RELOCS;
+      }
+      if(!seek_read(fd, off, reloc, n * sizeof(reloc[0]))) {
+	return ELFLOADER_BAD_ELF_HEADER;
+      }
+      off += n * sizeof(reloc[0]);
+
+      for(j = 0; j < n; ++j) {
+	if(reloc[j].segment >= CELF_BSS) {
+	  return ELFLOADER_SEGMENT_NOT_FOUND;
+	}
+	rela.r_offset = reloc[j].offset;
+	rela.r_info = reloc[j].type;
+	rela.r_addend = reloc[j].addend;
+	elfloader_arch_relocate(fd, segmentoff[reloc[j].segment],
+				segment[reloc[j].segment], &rela, addr);
+      }
+    }
+  }
+
+  /* Write text and rodata segment into flash and data segment into RAM. */
+  elfloader_arch_write_rom(fd, segmentoff[CELF_TEXT],
+			   hdr.segment_size[CELF_TEXT], segment[CELF_TEXT]);
+  elfloader_arch_write_rom(fd, segmentoff[CELF_RODATA],
+			   hdr.segment_size[CELF_RODATA], segment[CELF_RODATA]);
+
+  memset(segment[CELF_BSS], 0, hdr.segment_size[CELF_BSS]);
+  seek_read(fd, segmentoff[CELF_DATA], segment[CELF_DATA],
+	    hdr.segment_size[CELF_DATA]);
+
+  if(hdr.autostart_segment >= CELF_SEGMENTS) {
+    PRINTF("celfloader: no autostart\n");
+    return ELFLOADER_NO_STARTPOINT;
+  }
+  elfloader_autostart_processes = (struct process * const *)
+    &segment[hdr.autostart_segment][hdr.autostart_offset];
+  return ELFLOADER_OK;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* ELFLOADER_CELF */
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the loader of compact ELF (CELF) modules.
+ *
+ *         A CELF module is an ELF module that has been prelinked on
+ *         the host by tools/elf2celf. Relocations against symbols in
+ *         the module already refer to a segment of the module, so
+ *         only the symbols imported from the system are looked up
+ *         by name, once each. The relocations are grouped by target
+ *         and sorted by offset, and they are applied in a single
+ *         pass over the file. The symbol and string tables and the
+ *         section headers are not transferred.
+ *
+ *         The file starts with a struct celf_header, followed by the
+ *         contents of the text, rodata and data segments. Then
+ *         follow the relocation groups: a struct celf_group, the
+ *         name of the imported symbol, if any, and the struct
+ *         celf_reloc entries of the group. All fields are
+ *         little-endian.
+ */
+
+#ifndef CELFLOADER_H_
+#define CELFLOADER_H_
+
+#include <stdint.h>
+
+#define CELF_MAGIC      "CELF"
+#define CELF_MAGIC_SIZE 4
+#define CELF_VERSION    1
+
+/* The segments of a module, in the order their contents are stored. */
+#define CELF_TEXT     0
+#define CELF_RODATA   1
+#define CELF_DATA     2
+#define CELF_BSS      3
+#define CELF_SEGMENTS 4
+
+/* The target of a group that is imported from the system. */
+#define CELF_IMPORT   0xff
+
+/* The longest name of an imported symbol. */
+#define CELF_NAME_MAX 29
+
+struct celf_header {
+  uint8_t magic[CELF_MAGIC_SIZE];
+  uint8_t version;
+  /* The segment of autostart_processes, or CELF_IMPORT if none. */
+  uint8_t autostart_segment;
+  uint16_t autostart_offset;
+  uint16_t segment_size[CELF_SEGMENTS];
+  uint16_t groups;
+  uint16_t relocs;
+};
+
+struct celf_group {
+  /* A segment of the module, or CELF_IMPORT. */
+  uint8_t target;
+  /* The length of the name that follows, without a terminator. */
+  uint8_t namelen;
+  uint16_t relocs;
+};
+
+struct celf_reloc {
+  /* The location, relative to the start of the segment. */
+  uint16_t offset;
+  uint8_t segment;
+  /* The architecture specific relocation type. */
+  uint8_t type;
+  /* Includes the value of symbols in the module. */
+  int32_t addend;
+};
+
+/**
+ * \brief      Load and relocate a CELF module.
+ * \param fd   An open CFS file descriptor.
+ * \return     ELFLOADER_OK if loading and relocation worked.
+ *             Otherwise an error value.
+ *
+ *             Like elfloader_load(), this function modifies the
+ *             file, uses the architecture specific parts of the ELF
+ *             loader, and sets elfloader_autostart_processes.
+ */
+int celfloader_load(int fd);
+
+#endif /* CELFLOADER_H_ */
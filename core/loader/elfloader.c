@@ -37,6 +37,9 @@
 
 #include "cfs/cfs.h"
 #include "loader/symtab.h"
+#if ELFLOADER_CELF
+#include "loader/celfloader.h"
+#endif /* ELFLOADER_CELF */
 
 #include <stddef.h>
 #include <string.h>
@@ -137,6 +140,34 @@ struct process * const * elfloader_autostart_processes;
 
 static struct relevant_section bss, data, rodata, text;
 
+#if ELFLOADER_READ_BUFFER_SIZE
+struct read_buffer {
+  int fd;
+  unsigned int offset;
+  unsigned short len;
+  char data[ELFLOADER_READ_BUFFER_SIZE];
+};
+
+/* One buffer for the relocation and symbol tables, and one for the
+   symbol names, so that reading the names does not evict the
+   tables. */
+static struct read_buffer tablebuf, namebuf;
+#endif /* ELFLOADER_READ_BUFFER_SIZE */
+
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+struct symbol_cache_entry {
+  char *address;
+  unsigned short hash;
+};
+
+/* Indexed by the symbol number. The address is NULL until the symbol
+   has been resolved. */
+static struct symbol_cache_entry symbol_cache[ELFLOADER_SYMBOL_CACHE_SIZE];
+/* The number of symbols in the module, or zero if the module has too
+   many symbols to be cached. */
+static unsigned short symbol_cache_num;
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
+
 static const unsigned char elf_magic_header[] =
   {0x7f, 0x45, 0x4c, 0x46,  /* 0x7f, 'E', 'L', 'F' */
    0x01,                    /* Only 32-bit objects. */
@@ -163,6 +194,104 @@ seek_read(int fd, unsigned int offset, char *buf, int len)
 #endif /* DEBUG */
 }
 /*---------------------------------------------------------------------------*/
+#if ELFLOADER_READ_BUFFER_SIZE
+static void
+buffered_read(struct read_buffer *b, int fd, unsigned int offset,
+	      char *buf, int len)
+{
+  int r;
+
+  if(fd != b->fd || offset < b->offset ||
+     offset + len > b->offset + b->len) {
+    if(len > sizeof(b->data)) {
+      seek_read(fd, offset, buf, len);
+      return;
+    }
+    cfs_seek(fd, offset, CFS_SEEK_SET);
+    r = cfs_read(fd, b->data, sizeof(b->data));
+    b->fd = fd;
+    b->offset = offset;
+    b->len = r < 0 ? 0 : r;
+    if(len > b->len) {
+      seek_read(fd, offset, buf, len);
+      return;
+    }
+  }
+  memcpy(buf, &b->data[offset - b->offset], len);
+}
+#define read_table(fd, offset, buf, len) \
+  buffered_read(&tablebuf, fd, offset, buf, len)
+#define read_string(fd, offset, buf, len) \
+  buffered_read(&namebuf, fd, offset, buf, len)
+#else /* ELFLOADER_READ_BUFFER_SIZE */
+#define read_table seek_read
+#define read_string seek_read
+#endif /* ELFLOADER_READ_BUFFER_SIZE */
+/*---------------------------------------------------------------------------*/
+static void
+read_name(int fd, unsigned int offset, char *name, int len)
+{
+  read_string(fd, offset, name, len);
+  name[len - 1] = 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct relevant_section *
+find_section(elf32_half shndx)
+{
+  if(shndx == bss.number) {
+    return &bss;
+  } else if(shndx == data.number) {
+    return &data;
+  } else if(shndx == rodata.number) {
+    return &rodata;
+  } else if(shndx == text.number) {
+    return &text;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+static unsigned short
+name_hash(const char *name)
+{
+  unsigned short hash;
+
+  for(hash = 0; *name != 0; ++name) {
+    hash = (hash << 5) + hash + (unsigned char)*name;
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+/* Reads the symbol table once, so that symbols can be looked up by
+   the hash of their names instead of by reading every name. */
+static void
+load_symbols(int fd, unsigned int symtab, unsigned short symtabsize,
+	     unsigned int strtab)
+{
+  struct elf32_sym s;
+  char name[30];
+  unsigned short i, num;
+
+  symbol_cache_num = 0;
+  num = symtabsize / sizeof(s);
+  if(num > ELFLOADER_SYMBOL_CACHE_SIZE) {
+    PRINTF("elfloader: %u symbols, not cached\n", num);
+    return;
+  }
+
+  for(i = 0; i < num; ++i) {
+    read_table(fd, symtab + i * sizeof(s), (char *)&s, sizeof(s));
+    symbol_cache[i].address = NULL;
+    symbol_cache[i].hash = 0;
+    if(s.st_name != 0) {
+      read_name(fd, strtab + s.st_name, name, sizeof(name));
+      symbol_cache[i].hash = name_hash(name);
+    }
+  }
+  symbol_cache_num = num;
+}
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
+/*---------------------------------------------------------------------------*/
 /*
 static void
 seek_write(int fd, unsigned int offset, char *buf, int len)
@@ -181,22 +310,37 @@ find_local_symbol(int fd, const char *symbol,
   unsigned int a;
   char name[30];
   struct relevant_section *sect;
-  
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+  unsigned short i, hash;
+
+  if(symbol_cache_num > 0) {
+    /* Only the symbols with the same name hash have to be read. */
+    hash = name_hash(symbol);
+    for(i = 0; i < symbol_cache_num; ++i) {
+      if(symbol_cache[i].hash != hash) {
+	continue;
+      }
+      seek_read(fd, symtab + i * sizeof(s), (char *)&s, sizeof(s));
+      if(s.st_name != 0) {
+	read_name(fd, strtab + s.st_name, name, sizeof(name));
+	if(strcmp(name, symbol) == 0) {
+	  sect = find_section(s.st_shndx);
+	  return sect == NULL ? NULL : &(sect->address[s.st_value]);
+	}
+      }
+    }
+    return NULL;
+  }
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
+
   for(a = symtab; a < symtab + symtabsize; a += sizeof(s)) {
-    seek_read(fd, a, (char *)&s, sizeof(s));
+    read_table(fd, a, (char *)&s, sizeof(s));
 
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      read_name(fd, strtab + s.st_name, name, sizeof(name));
       if(strcmp(name, symbol) == 0) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-  } else if(s.st_shndx == rodata.number) {
-    sect = &rodata;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
+	sect = find_section(s.st_shndx);
+	if(sect == NULL) {
 	  return NULL;
 	}
 	return &(sect->address[s.st_value]);
@@ -224,6 +368,9 @@ relocate_section(int fd,
   char name[30];
   char *addr;
   struct relevant_section *sect;
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+  unsigned short symbol;
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
 
   /* determine correct relocation entry sizes */
   if(using_relas) {
@@ -233,12 +380,19 @@ relocate_section(int fd,
   }
   
   for(a = section; a < section + size; a += rel_size) {
-    seek_read(fd, a, (char *)&rela, rel_size);
+    read_table(fd, a, (char *)&rela, rel_size);
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+    symbol = ELF32_R_SYM(rela.r_info);
+    if(symbol < symbol_cache_num && symbol_cache[symbol].address != NULL) {
+      addr = symbol_cache[symbol].address;
+      goto relocate;
+    }
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
     seek_read(fd,
 	      symtab + sizeof(struct elf32_sym) * ELF32_R_SYM(rela.r_info),
 	      (char *)&s, sizeof(s));
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      read_name(fd, strtab + s.st_name, name, sizeof(name));
       PRINTF("name: %s\n", name);
       addr = (char *)symtab_lookup(name);
       /* ADDED */
@@ -248,15 +402,8 @@ relocate_section(int fd,
 	PRINTF("found address %p\n", addr);
       }
       if(addr == NULL) {
-	if(s.st_shndx == bss.number) {
-	  sect = &bss;
-	} else if(s.st_shndx == data.number) {
-	  sect = &data;
-	} else if(s.st_shndx == rodata.number) {
-	  sect = &rodata;
-	} else if(s.st_shndx == text.number) {
-	  sect = &text;
-	} else {
+	sect = find_section(s.st_shndx);
+	if(sect == NULL) {
 	  PRINTF("elfloader unknown name: '%30s'\n", name);
 	  memcpy(elfloader_unknown, name, sizeof(elfloader_unknown));
 	  elfloader_unknown[sizeof(elfloader_unknown) - 1] = 0;
@@ -265,21 +412,20 @@ relocate_section(int fd,
 	addr = sect->address;
       }
     } else {
-      if(s.st_shndx == bss.number) {
-	sect = &bss;
-      } else if(s.st_shndx == data.number) {
-	sect = &data;
-      } else if(s.st_shndx == rodata.number) {
-	sect = &rodata;
-      } else if(s.st_shndx == text.number) {
-	sect = &text;
-      } else {
+      sect = find_section(s.st_shndx);
+      if(sect == NULL) {
 	return ELFLOADER_SEGMENT_NOT_FOUND;
       }
       
       addr = sect->address;
     }
 
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+    if(symbol < symbol_cache_num) {
+      symbol_cache[symbol].address = addr;
+    }
+  relocate:
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
     if(!using_relas) {
       /* copy addend to rela structure */
       seek_read(fd, sectionaddr + rela.r_offset, (char *)&rela.r_addend, 4);
@@ -300,10 +446,10 @@ find_program_processes(int fd,
   char name[30];
   
   for(a = symtab; a < symtab + size; a += sizeof(s)) {
-    seek_read(fd, a, (char *)&s, sizeof(s));
+    read_table(fd, a, (char *)&s, sizeof(s));
 
     if(s.st_name != 0) {
-      seek_read(fd, strtab + s.st_name, name, sizeof(name));
+      read_name(fd, strtab + s.st_name, name, sizeof(name));
       if(strcmp(name, "autostart_processes") == 0) {
 	return &data.address[s.st_value];
       }
@@ -361,6 +507,10 @@ elfloader_load(int fd)
   int ret;
 
   elfloader_unknown[0] = 0;
+#if ELFLOADER_READ_BUFFER_SIZE
+  /* The descriptor may be that of an earlier file. */
+  tablebuf.len = namebuf.len = 0;
+#endif /* ELFLOADER_READ_BUFFER_SIZE */
 
   /* The ELF header is located at the start of the buffer. */
   seek_read(fd, 0, (char *)&ehdr, sizeof(ehdr));
@@ -369,6 +519,11 @@ elfloader_load(int fd)
       print_chars(elf_magic_header, sizeof(elf_magic_header));*/
   /* Make sure that we have a correct and compatible ELF header. */
   if(memcmp(ehdr.e_ident, elf_magic_header, sizeof(elf_magic_header)) != 0) {
+#if ELFLOADER_CELF
+    if(memcmp(ehdr.e_ident, CELF_MAGIC, CELF_MAGIC_SIZE) == 0) {
+      return celfloader_load(fd);
+    }
+#endif /* ELFLOADER_CELF */
     PRINTF("ELF header problems\n");
     return ELFLOADER_BAD_ELF_HEADER;
   }
@@ -438,7 +593,8 @@ elfloader_load(int fd)
       PRINTF("symtab\n");
       symtaboff = shdr.sh_offset;
       symtabsize = shdr.sh_size;
-    } else if(shdr.sh_type == SHT_STRTAB/*strncmp(name, ".strtab", 7) == 0*/) {
+    } else if(shdr.sh_type == SHT_STRTAB/*strncmp(name, ".strtab", 7) == 0*/ &&
+	      i != ehdr.e_shstrndx) {
       PRINTF("strtab\n");
       strtaboff = shdr.sh_offset;
       strtabsize = shdr.sh_size;
@@ -517,6 +673,9 @@ elfloader_load(int fd)
   PRINTF("text base address: text.address = 0x%08x\n", text.address);
   PRINTF("rodata base address: rodata.address = 0x%08x\n", rodata.address);
 
+#if ELFLOADER_SYMBOL_CACHE_SIZE
+  load_symbols(fd, symtaboff, symtabsize, strtaboff);
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
 
   /* If we have text segment relocations, we process them. */
   PRINTF("elfloader: relocate text\n");
@@ -76,6 +76,8 @@
 
 #include "cfs/cfs.h"
 
+#include <stdint.h>
+
 /**
  * Return value from elfloader_load() indicating that loading worked.
  */
@@ -174,11 +176,52 @@ extern char elfloader_unknown[30];
 #endif
 #endif /* ELFLOADER_TEXTMEMORY_SIZE */
 
-typedef unsigned long  elf32_word;
-typedef   signed long  elf32_sword;
-typedef unsigned short elf32_half;
-typedef unsigned long  elf32_off;
-typedef unsigned long  elf32_addr;
+/**
+ * The size of the buffers used for the sequential reads of the
+ * relocation, symbol and string tables, or zero to read every entry
+ * directly from the file. Two buffers of this size are used.
+ */
+#ifndef ELFLOADER_READ_BUFFER_SIZE
+#ifdef ELFLOADER_CONF_READ_BUFFER_SIZE
+#define ELFLOADER_READ_BUFFER_SIZE ELFLOADER_CONF_READ_BUFFER_SIZE
+#else
+#define ELFLOADER_READ_BUFFER_SIZE 0
+#endif
+#endif /* ELFLOADER_READ_BUFFER_SIZE */
+
+/**
+ * The largest number of module symbols whose name hashes and resolved
+ * addresses are kept in RAM during elfloader_load(), or zero to
+ * resolve every relocation from the file. Modules with more symbols
+ * are loaded without the cache.
+ */
+#ifndef ELFLOADER_SYMBOL_CACHE_SIZE
+#ifdef ELFLOADER_CONF_SYMBOL_CACHE_SIZE
+#define ELFLOADER_SYMBOL_CACHE_SIZE ELFLOADER_CONF_SYMBOL_CACHE_SIZE
+#else
+#define ELFLOADER_SYMBOL_CACHE_SIZE 0
+#endif
+#endif /* ELFLOADER_SYMBOL_CACHE_SIZE */
+
+/**
+ * Whether elfloader_load() also loads compact ELF modules made by
+ * tools/elf2celf, see celfloader.h.
+ */
+#ifndef ELFLOADER_CELF
+#ifdef ELFLOADER_CONF_CELF
+#define ELFLOADER_CELF ELFLOADER_CONF_CELF
+#else
+#define ELFLOADER_CELF 0
+#endif
+#endif /* ELFLOADER_CELF */
+
+/* The ELF32 types have fixed widths, so that the structures match the
+   file also where long is 64 bits wide. */
+typedef uint32_t elf32_word;
+typedef int32_t  elf32_sword;
+typedef uint16_t elf32_half;
+typedef uint32_t elf32_off;
+typedef uint32_t elf32_addr;
 
 struct elf32_rela {
   elf32_addr      r_offset;       /* Location to be relocated. */
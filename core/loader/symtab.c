@@ -41,10 +41,23 @@
 #define SYMTAB_CONF_BINARY_SEARCH 1
 #endif
 
+/* The number of slots in a hash index of the symbol table, which is
+   built in RAM on the first lookup. Must be a power of two larger
+   than the number of symbols; zero disables the index. */
+#ifndef SYMTAB_CONF_HASH_SIZE
+#define SYMTAB_CONF_HASH_SIZE 0
+#endif
+
+#if SYMTAB_CONF_HASH_SIZE
+/* The symbol number plus one, or zero for an empty slot. */
+static unsigned short hash_index[SYMTAB_CONF_HASH_SIZE];
+static enum { HASH_UNBUILT, HASH_BUILT, HASH_TOO_SMALL } hash_state;
+#endif /* SYMTAB_CONF_HASH_SIZE */
+
 /*---------------------------------------------------------------------------*/
 #if SYMTAB_CONF_BINARY_SEARCH
-void *
-symtab_lookup(const char *name)
+static void *
+search(const char *name)
 {
   int start, middle, end;
   int r;
@@ -67,8 +80,8 @@ symtab_lookup(const char *name)
   return NULL;
 }
 #else /* SYMTAB_CONF_BINARY_SEARCH */
-void *
-symtab_lookup(const char *name)
+static void *
+search(const char *name)
 {
   const struct symbols *s;
   for(s = symbols; s->name != NULL; ++s) {
@@ -80,3 +93,56 @@ symtab_lookup(const char *name)
 }
 #endif /* SYMTAB_CONF_BINARY_SEARCH */
 /*---------------------------------------------------------------------------*/
+#if SYMTAB_CONF_HASH_SIZE
+static unsigned short
+hash(const char *name)
+{
+  unsigned short h;
+
+  for(h = 0; *name != 0; ++name) {
+    h = (h << 5) + h + (unsigned char)*name;
+  }
+  return h & (SYMTAB_CONF_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_hash_index(void)
+{
+  const struct symbols *s;
+  unsigned short h;
+
+  if(symbols_nelts >= SYMTAB_CONF_HASH_SIZE) {
+    hash_state = HASH_TOO_SMALL;
+    return;
+  }
+  for(s = symbols; s->name != NULL; ++s) {
+    for(h = hash(s->name); hash_index[h] != 0;
+	h = (h + 1) & (SYMTAB_CONF_HASH_SIZE - 1));
+    hash_index[h] = s - symbols + 1;
+  }
+  hash_state = HASH_BUILT;
+}
+#endif /* SYMTAB_CONF_HASH_SIZE */
+/*---------------------------------------------------------------------------*/
+void *
+symtab_lookup(const char *name)
+{
+#if SYMTAB_CONF_HASH_SIZE
+  unsigned short h;
+
+  if(hash_state == HASH_UNBUILT) {
+    build_hash_index();
+  }
+  if(hash_state == HASH_BUILT) {
+    for(h = hash(name); hash_index[h] != 0;
+	h = (h + 1) & (SYMTAB_CONF_HASH_SIZE - 1)) {
+      if(strcmp(name, symbols[hash_index[h] - 1].name) == 0) {
+	return symbols[hash_index[h] - 1].value;
+      }
+    }
+    return NULL;
+  }
+#endif /* SYMTAB_CONF_HASH_SIZE */
+  return search(name);
+}
+/*---------------------------------------------------------------------------*/
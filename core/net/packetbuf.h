@@ -379,11 +379,11 @@ enum {
 
 #define PACKETBUF_IS_ADDR(type) ((type) >= PACKETBUF_ADDR_FIRST)
 
-#if PACKETBUF_CONF_ATTRS_INLINE
-
 extern struct packetbuf_attr packetbuf_attrs[];
 extern struct packetbuf_addr packetbuf_addrs[];
 
+#if PACKETBUF_CONF_ATTRS_INLINE
+
 static int               packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val);
 static packetbuf_attr_t    packetbuf_attr(uint8_t type);
 static int               packetbuf_set_addr(uint8_t type, const rimeaddr_t *addr);
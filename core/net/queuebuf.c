@@ -237,12 +237,7 @@ queuebuf_flush_tmpdata(void)
     fileid = tmpdata_qbuf->swap_id / NQBUF_PER_FILE;
     offset = (tmpdata_qbuf->swap_id % NQBUF_PER_FILE) * sizeof(struct queuebuf_data);
     fd = qbuf_files[fileid].fd;
-    ret = cfs_seek(fd, offset, CFS_SEEK_SET);
-    if(ret == -1) {
-      PRINTF("queuebuf_flush_tmpdata: cfs seek error\n");
-      return -1;
-    }
-    ret = cfs_write(fd, &tmpdata, sizeof(struct queuebuf_data));
+    ret = cfs_pwrite(fd, &tmpdata, sizeof(struct queuebuf_data), offset);
     if(ret == -1) {
       PRINTF("queuebuf_flush_tmpdata: cfs write error\n");
       return -1;
@@ -268,11 +263,7 @@ queuebuf_load_to_ram(struct queuebuf *b)
       fileid = b->swap_id / NQBUF_PER_FILE;
       offset = (b->swap_id % NQBUF_PER_FILE) * sizeof(struct queuebuf_data);
       fd = qbuf_files[fileid].fd;
-      ret = cfs_seek(fd, offset, CFS_SEEK_SET);
-      if(ret == -1) {
-        PRINTF("queuebuf_load_to_ram: cfs seek error\n");
-      }
-      ret = cfs_read(fd, &tmpdata, sizeof(struct queuebuf_data));
+      ret = cfs_pread(fd, &tmpdata, sizeof(struct queuebuf_data), offset);
       if(ret == -1) {
         PRINTF("queuebuf_load_to_ram: cfs read error\n");
       }
@@ -157,6 +157,25 @@ strcasecmp(const char *s1, const char *s2)
 #define RESOLV_SUPPORTS_RECORD_EXPIRATION 1
 #endif
 
+/** The number of seconds a failed lookup is cached when the server did
+ *  not supply an SOA record telling us how long to keep it. */
+#ifndef RESOLV_CONF_NEGATIVE_TTL
+#define RESOLV_CONF_NEGATIVE_TTL 30
+#endif
+
+/** Upper bound, in seconds, on the negative caching time taken from an
+ *  SOA record. */
+#ifndef RESOLV_CONF_MAX_NEGATIVE_TTL
+#define RESOLV_CONF_MAX_NEGATIVE_TTL 300
+#endif
+
+#if RESOLV_CONF_STATS
+struct resolv_stats resolv_stats;
+#define RESOLV_STAT(code) (code)
+#else /* RESOLV_CONF_STATS */
+#define RESOLV_STAT(code)
+#endif /* RESOLV_CONF_STATS */
+
 #if RESOLV_CONF_SUPPORTS_MDNS && !RESOLV_VERIFY_ANSWER_NAMES
 #error RESOLV_CONF_SUPPORTS_MDNS cannot be set without RESOLV_CONF_VERIFY_ANSWER_NAMES
 #endif
@@ -177,6 +196,7 @@ strcasecmp(const char *s1, const char *s2)
 
 #define DNS_TYPE_A      1
 #define DNS_TYPE_CNAME  5
+#define DNS_TYPE_SOA    6
 #define DNS_TYPE_PTR   12
 #define DNS_TYPE_MX    15
 #define DNS_TYPE_TXT   16
@@ -266,6 +286,7 @@ struct namemap {
   uint8_t tmr;
   uint8_t retries;
   uint8_t seqno;
+  uint8_t hash;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
   unsigned long expiration;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
@@ -291,6 +312,10 @@ static struct uip_udp_conn *resolv_conn = NULL;
 
 static struct etimer retry;
 
+/* Set when the retry timer fires, so that retransmission timers only
+ * advance once per tick and not on every poll of the connection. */
+static uint8_t retry_tick;
+
 process_event_t resolv_event_found;
 
 PROCESS(resolv_process, "DNS resolver");
@@ -422,6 +447,41 @@ dns_name_isequal(const unsigned char *queryptr, const char *name,
 
   return name[0] == 0;
 }
+/*---------------------------------------------------------------------------*/
+#if RESOLV_CONF_SUPPORTS_MDNS
+/** \internal
+ * Hashes a DNS name in wire format the same way name_hash() hashes
+ * the dotted form, so that answers can be matched against the table
+ * without a full name comparison for every entry.
+ */
+static uint8_t
+dns_name_hash(const unsigned char *queryptr, const unsigned char *packet)
+{
+  uint8_t hash = 0;
+
+  unsigned char n = *queryptr++;
+
+  while(n) {
+    if(n & 0xc0) {
+      queryptr = packet + queryptr[0] + ((n & ~0xC0) << 8);
+      n = *queryptr++;
+      continue;
+    }
+
+    for(; n; --n) {
+      hash = hash * 31 + tolower(*queryptr++);
+    }
+
+    n = *queryptr++;
+
+    if(n) {
+      hash = hash * 31 + '.';
+    }
+  }
+
+  return hash;
+}
+#endif /* RESOLV_CONF_SUPPORTS_MDNS */
 #endif /* RESOLV_VERIFY_ANSWER_NAMES */
 /*---------------------------------------------------------------------------*/
 /** \internal
@@ -483,6 +543,116 @@ encode_name(unsigned char *query, const char *nameptr)
   return query;
 }
 /*---------------------------------------------------------------------------*/
+/** \internal
+ * Case-insensitive hash of a dotted host name. A single trailing dot
+ * is ignored, as it is by dns_name_isequal().
+ */
+static uint8_t
+name_hash(const char *name)
+{
+  uint8_t hash = 0;
+
+  for(; *name != 0; ++name) {
+    if(*name == '.' && name[1] == 0) {
+      break;
+    }
+    hash = hash * 31 + tolower((unsigned char)*name);
+  }
+
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+/** \internal
+ * Returns non-zero if the entry holds an answer, positive or negative,
+ * that may still be handed out without asking the server again.
+ */
+static uint8_t
+entry_is_fresh(const struct namemap *namemapptr)
+{
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+  return (namemapptr->state == STATE_DONE ||
+          namemapptr->state == STATE_ERROR) &&
+         clock_seconds() <= namemapptr->expiration;
+#else /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+  return 0;
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+}
+/*---------------------------------------------------------------------------*/
+/** \internal
+ * Returns non-zero if the entry can be reused without losing anything.
+ */
+static uint8_t
+entry_is_free(const struct namemap *namemapptr)
+{
+  return namemapptr->state == STATE_UNUSED
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+    || ((namemapptr->state == STATE_DONE || namemapptr->state == STATE_ERROR)
+        && clock_seconds() > namemapptr->expiration)
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+    ;
+}
+/*---------------------------------------------------------------------------*/
+/** \internal
+ * Marks the entry as the most recently used one.
+ */
+static void
+entry_touch(struct namemap *namemapptr)
+{
+  namemapptr->seqno = seqno++;
+}
+/*---------------------------------------------------------------------------*/
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+/** \internal
+ * Works out how long a negative answer may be cached. Following RFC
+ * 2308, this is the smaller of the TTL and the MINIMUM field of the
+ * SOA record in the authority section, if the server sent one.
+ */
+static unsigned long
+negative_ttl(unsigned char *queryptr, uint8_t nanswers, uint8_t nauthrr)
+{
+  const unsigned char *end = (unsigned char *)uip_appdata + uip_datalen();
+
+  unsigned long ttl, minimum;
+
+  uint16_t len;
+
+  for(; nanswers + nauthrr > 0; queryptr += 10 + len) {
+    queryptr = skip_name(queryptr);
+    if(queryptr + 10 > end) {
+      break;
+    }
+    len = (queryptr[8] << 8) | queryptr[9];
+    if(nanswers > 0) {
+      --nanswers;
+      continue;
+    }
+    --nauthrr;
+    if(((queryptr[0] << 8) | queryptr[1]) != DNS_TYPE_SOA) {
+      continue;
+    }
+
+    ttl = ((unsigned long)queryptr[4] << 24) |
+      ((unsigned long)queryptr[5] << 16) | (queryptr[6] << 8) | queryptr[7];
+
+    /* Skip MNAME and RNAME, then SERIAL, REFRESH, RETRY and EXPIRE. */
+    queryptr = skip_name(skip_name(queryptr + 10)) + 16;
+    if(queryptr + 4 > end) {
+      break;
+    }
+    minimum = ((unsigned long)queryptr[0] << 24) |
+      ((unsigned long)queryptr[1] << 16) | (queryptr[2] << 8) | queryptr[3];
+
+    if(minimum < ttl) {
+      ttl = minimum;
+    }
+    return ttl < RESOLV_CONF_MAX_NEGATIVE_TTL ?
+      ttl : RESOLV_CONF_MAX_NEGATIVE_TTL;
+  }
+
+  return RESOLV_CONF_NEGATIVE_TTL;
+}
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+/*---------------------------------------------------------------------------*/
 #if RESOLV_CONF_SUPPORTS_MDNS
 /** \internal
  */
@@ -657,11 +827,23 @@ check_entries(void)
 
   register struct namemap *namemapptr;
 
+  static uint8_t tick;
+
+  /* Only the retry timer advances the retransmission timers. Polls
+   * caused by new queries just send out the questions that are due. */
+  tick = retry_tick;
+  retry_tick = 0;
+
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     namemapptr = &names[i];
     if(namemapptr->state == STATE_NEW || namemapptr->state == STATE_ASKING) {
-      etimer_set(&retry, CLOCK_SECOND / 4);
+      if(tick || etimer_expired(&retry)) {
+        etimer_set(&retry, CLOCK_SECOND / 4);
+      }
       if(namemapptr->state == STATE_ASKING) {
+        if(!tick) {
+          continue;
+        }
         if(--namemapptr->tmr == 0) {
 #if RESOLV_CONF_SUPPORTS_MDNS
           if(++namemapptr->retries ==
@@ -673,10 +855,11 @@ check_entries(void)
           {
             /* STATE_ERROR basically means "not found". */
             namemapptr->state = STATE_ERROR;
+            RESOLV_STAT(resolv_stats.timeouts++);
 
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-            /* Keep the "not found" error valid for 30 seconds */
-            namemapptr->expiration = clock_seconds() + 30;
+            /* Keep the "not found" error valid for a while */
+            namemapptr->expiration = clock_seconds() + RESOLV_CONF_NEGATIVE_TTL;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
             resolv_found(namemapptr->name, NULL);
@@ -701,6 +884,7 @@ check_entries(void)
         namemapptr->tmr = 1;
         namemapptr->retries = 0;
       }
+      RESOLV_STAT(resolv_stats.sent++);
       hdr = (struct dns_hdr *)uip_appdata;
       memset(hdr, 0, sizeof(struct dns_hdr));
       hdr->id = RESOLV_ENCODE_INDEX(i);
@@ -766,6 +950,15 @@ check_entries(void)
       break;
     }
   }
+
+  /* One question goes out per poll. If more new names are waiting,
+   * ask for another poll instead of leaving them to the next tick. */
+  for(++i; i < RESOLV_ENTRIES; ++i) {
+    if(names[i].state == STATE_NEW) {
+      tcpip_poll_udp(resolv_conn);
+      break;
+    }
+  }
 }
 /*---------------------------------------------------------------------------*/
 /** \internal
@@ -780,6 +973,8 @@ newdata(void)
 
   register struct namemap *namemapptr;
 
+  static struct namemap *pending;
+
   struct dns_answer *ans;
 
   register struct dns_hdr const *hdr = (struct dns_hdr *)uip_appdata;
@@ -885,11 +1080,6 @@ newdata(void)
 
 /** ANSWER HANDLING SECTION **************************************************/
 
-  if(nanswers == 0) {
-    /* Skip responses with no answers. */
-    return;
-  }
-
 #if RESOLV_CONF_SUPPORTS_MDNS
   if(UIP_UDP_BUF->srcport == UIP_HTONS(MDNS_PORT) &&
      hdr->id == 0) {
@@ -897,11 +1087,20 @@ newdata(void)
      * because we can't use the `id` field. We will look up the
      * appropriate request in a later step. */
 
+    if(nanswers == 0) {
+      /* Skip responses with no answers. */
+      return;
+    }
+
     i = -1;
     namemapptr = NULL;
   } else
 #endif /* RESOLV_CONF_SUPPORTS_MDNS */
   {
+    if(is_request) {
+      return;
+    }
+
     /* The ID in the DNS header should be our entry into the name table. */
     i = RESOLV_DECODE_INDEX(hdr->id);
 
@@ -920,18 +1119,29 @@ newdata(void)
     namemapptr->err = hdr->flags2 & DNS_FLAG2_ERR_MASK;
 
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    /* If we remain in the error state, keep it cached for 30 seconds. */
-    namemapptr->expiration = clock_seconds() + 30;
+    /* If we remain in the error state, keep it cached for a while. */
+    namemapptr->expiration = clock_seconds() + RESOLV_CONF_NEGATIVE_TTL;
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
-    /* Check for error. If so, call callback to inform. */
-    if(namemapptr->err != 0) {
-      namemapptr->state = STATE_ERROR;
+    /* Check for error or an empty answer. If so, call callback to inform. */
+    if(namemapptr->err != 0 || nanswers == 0) {
+#if RESOLV_SUPPORTS_RECORD_EXPIRATION
+      if(namemapptr->err == DNS_FLAG2_ERR_NAME || namemapptr->err == 0) {
+        /* Negative answer from the server: honour its SOA. */
+        namemapptr->expiration = clock_seconds() +
+          negative_ttl(queryptr, nanswers,
+                       (uint8_t)uip_ntohs(hdr->numauthrr));
+      }
+#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
       resolv_found(namemapptr->name, NULL);
       return;
     }
   }
 
+  /* Unicast responses carry one name only; if none of the answers is
+   * usable, the caller still needs to hear about it. */
+  pending = namemapptr;
+
   i = 0;
 
   /* Answer parsing loop */
@@ -973,21 +1183,21 @@ newdata(void)
        hdr->id == 0) {
       int8_t available_i = RESOLV_ENTRIES;
 
+      uint8_t hash = dns_name_hash(queryptr, uip_appdata);
+
       DEBUG_PRINTF("resolver: MDNS query.\n");
 
       /* For MDNS, we need to actually look up the name we
-       * are looking for.
+       * are looking for. Only entries with a matching hash need
+       * the full comparison.
        */
       for(i = 0; i < RESOLV_ENTRIES; ++i) {
         namemapptr = &names[i];
-        if(dns_name_isequal(queryptr, namemapptr->name, uip_appdata)) {
+        if(namemapptr->hash == hash &&
+           dns_name_isequal(queryptr, namemapptr->name, uip_appdata)) {
           break;
         }
-        if((namemapptr->state == STATE_UNUSED)
-#if RESOLV_SUPPORTS_RECORD_EXPIRATION
-          || (namemapptr->state == STATE_DONE && clock_seconds() > namemapptr->expiration)
-#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
-        ) {
+        if(entry_is_free(namemapptr)) {
           available_i = i;
         }
       }
@@ -995,10 +1205,17 @@ newdata(void)
         DEBUG_PRINTF("resolver: Unsolicited MDNS response.\n");
         i = available_i;
         namemapptr = &names[i];
-        if(!decode_name(queryptr, namemapptr->name, uip_appdata)) {
+        if(i == RESOLV_ENTRIES) {
+          /* Handled below. */
+        } else if(!decode_name(queryptr, namemapptr->name, uip_appdata)) {
           DEBUG_PRINTF("resolver: MDNS name too big to cache.\n");
+          namemapptr->state = STATE_UNUSED;
+          namemapptr->name[0] = 0;
           namemapptr = NULL;
           goto skip_to_next_answer;
+        } else {
+          namemapptr->hash = hash;
+          entry_touch(namemapptr);
         }
       }
       if(i == RESOLV_ENTRIES) {
@@ -1034,7 +1251,8 @@ newdata(void)
 
     namemapptr->state = STATE_DONE;
 #if RESOLV_SUPPORTS_RECORD_EXPIRATION
-    namemapptr->expiration = ans->ttl[1] + (ans->ttl[0] << 8);
+    namemapptr->expiration = ((unsigned long)uip_ntohs(ans->ttl[0]) << 16) |
+      uip_ntohs(ans->ttl[1]);
     namemapptr->expiration += clock_seconds();
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
 
@@ -1046,6 +1264,10 @@ newdata(void)
     queryptr = (unsigned char *)skip_name(queryptr) + 10 + uip_htons(ans->len);
     --nanswers;
   }
+
+  if(pending != NULL && pending->state == STATE_ERROR) {
+    resolv_found(pending->name, NULL);
+  }
 }
 /*---------------------------------------------------------------------------*/
 #if RESOLV_CONF_SUPPORTS_MDNS
@@ -1153,6 +1375,9 @@ PROCESS_THREAD(resolv_process, ev, data)
     PROCESS_WAIT_EVENT();
 
     if(ev == PROCESS_EVENT_TIMER) {
+      if(data == &retry) {
+        retry_tick = 1;
+      }
       tcpip_poll_udp(resolv_conn);
     } else if(ev == tcpip_event) {
       if(uip_udp_conn == resolv_conn) {
@@ -1221,6 +1446,11 @@ remove_trailing_dots(const char *name) {
 /**
  * Queues a name so that a question for the name will be sent out.
  *
+ * If the name is already being resolved, the caller simply shares the
+ * outstanding question. If a positive or negative answer for the name
+ * is cached and has not yet expired, no question is sent and
+ * resolv_event_found is posted right away.
+ *
  * \param name The hostname that is to be queried.
  */
 void
@@ -1228,36 +1458,74 @@ resolv_query(const char *name)
 {
   static uint8_t i;
 
-  static uint8_t lseq, lseqi;
+  static uint8_t lseqi, hash;
+
+  static uint16_t lseq, age;
 
   register struct namemap *nameptr = 0;
 
+  uint8_t is_probe = 0;
+
   lseq = lseqi = 0;
 
   /* Remove trailing dots, if present. */
   name = remove_trailing_dots(name);
+  hash = name_hash(name);
+
+  RESOLV_STAT(resolv_stats.queries++);
+
+#if RESOLV_CONF_SUPPORTS_MDNS
+  is_probe = (mdns_state == MDNS_STATE_PROBING) &&
+             (0 == strcmp(name, resolv_hostname));
+#endif /* RESOLV_CONF_SUPPORTS_MDNS */
 
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     nameptr = &names[i];
-    if(0 == strcasecmp(nameptr->name, name)) {
+    if(nameptr->hash == hash && 0 == strcasecmp(nameptr->name, name)) {
       break;
     }
-    if((nameptr->state == STATE_UNUSED)
-#if RESOLV_SUPPORTS_RECORD_EXPIRATION
-      || (nameptr->state == STATE_DONE && clock_seconds() > nameptr->expiration)
-#endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
-    ) {
-      lseqi = i;
-      lseq = 255;
-    } else if(seqno - nameptr->seqno > lseq) {
-      lseq = seqno - nameptr->seqno;
+    /* Prefer free entries, then the least recently used answer, and
+     * only give up an outstanding question if there is nothing else. */
+    if(entry_is_free(nameptr)) {
+      age = 0x200;
+    } else {
+      age = (uint8_t)(seqno - nameptr->seqno);
+      if(nameptr->state != STATE_NEW && nameptr->state != STATE_ASKING) {
+        age += 0x100;
+      }
+    }
+    if(age > lseq) {
+      lseq = age;
       lseqi = i;
     }
   }
 
+  if(i < RESOLV_ENTRIES && !is_probe) {
+    if(nameptr->state == STATE_NEW || nameptr->state == STATE_ASKING) {
+      PRINTF("resolver: Joining query for \"%s\".\n", name);
+      RESOLV_STAT(resolv_stats.coalesced++);
+      entry_touch(nameptr);
+      return;
+    }
+    if(entry_is_fresh(nameptr)) {
+      PRINTF("resolver: Answering \"%s\" from cache.\n", name);
+      if(nameptr->state == STATE_DONE) {
+        RESOLV_STAT(resolv_stats.hits++);
+      } else {
+        RESOLV_STAT(resolv_stats.negative_hits++);
+      }
+      entry_touch(nameptr);
+      process_post(PROCESS_BROADCAST, resolv_event_found, nameptr->name);
+      return;
+    }
+  }
+
   if(i == RESOLV_ENTRIES) {
     i = lseqi;
     nameptr = &names[i];
+    if(lseq < 0x200) {
+      RESOLV_STAT(resolv_stats.evictions++);
+    }
   }
 
   PRINTF("resolver: Starting query for \"%s\".\n", name);
@@ -1265,9 +1533,9 @@ resolv_query(const char *name)
   memset(nameptr, 0, sizeof(*nameptr));
 
   strncpy(nameptr->name, name, sizeof(nameptr->name));
+  nameptr->hash = hash;
   nameptr->state = STATE_NEW;
-  nameptr->seqno = seqno;
-  ++seqno;
+  entry_touch(nameptr);
 
 #if RESOLV_CONF_SUPPORTS_MDNS
   {
@@ -1283,8 +1551,7 @@ resolv_query(const char *name)
       nameptr->is_mdns = 0;
     }
   }
-  nameptr->is_probe = (mdns_state == MDNS_STATE_PROBING) &&
-                      (0 == strcmp(nameptr->name, resolv_hostname));
+  nameptr->is_probe = is_probe;
 #endif /* RESOLV_CONF_SUPPORTS_MDNS */
 
   /* Force check_entires() to run on our process. */
@@ -1305,12 +1572,15 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
 {
   resolv_status_t ret = RESOLV_STATUS_UNCACHED;
 
-  static uint8_t i;
+  static uint8_t i, hash;
 
   struct namemap *nameptr;
 
   /* Remove trailing dots, if present. */
   name = remove_trailing_dots(name);
+  hash = name_hash(name);
+
+  RESOLV_STAT(resolv_stats.lookups++);
 
 #if UIP_CONF_LOOPBACK_INTERFACE
   if(strcmp(name, "localhost")) {
@@ -1332,7 +1602,8 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
   for(i = 0; i < RESOLV_ENTRIES; ++i) {
     nameptr = &names[i];
 
-    if(strcasecmp(name, nameptr->name) == 0) {
+    if(nameptr->hash == hash && strcasecmp(name, nameptr->name) == 0) {
+      entry_touch(nameptr);
       switch (nameptr->state) {
       case STATE_DONE:
         ret = RESOLV_STATUS_CACHED;
@@ -1341,6 +1612,9 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
           ret = RESOLV_STATUS_EXPIRED;
         }
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+        if(ret == RESOLV_STATUS_CACHED) {
+          RESOLV_STAT(resolv_stats.hits++);
+        }
         break;
       case STATE_NEW:
       case STATE_ASKING:
@@ -1354,6 +1628,9 @@ resolv_lookup(const char *name, uip_ipaddr_t ** ipaddr)
           ret = RESOLV_STATUS_UNCACHED;
         }
 #endif /* RESOLV_SUPPORTS_RECORD_EXPIRATION */
+        if(ret == RESOLV_STATUS_NOT_FOUND) {
+          RESOLV_STAT(resolv_stats.negative_hits++);
+        }
         break;
       }
 
@@ -51,6 +51,29 @@
 #define RESOLV_CONF_SUPPORTS_MDNS     (1)
 #endif
 
+/** If RESOLV_CONF_STATS is set, the resolver counts queries, cache
+ *  hits and the packets it sends in resolv_stats.
+ */
+#ifndef RESOLV_CONF_STATS
+#define RESOLV_CONF_STATS             (0)
+#endif
+
+#if RESOLV_CONF_STATS
+/** Resolver statistics. */
+struct resolv_stats {
+  uint16_t queries;       /**< Calls to resolv_query(). */
+  uint16_t lookups;       /**< Calls to resolv_lookup(). */
+  uint16_t coalesced;     /**< Queries that joined an outstanding question. */
+  uint16_t hits;          /**< Queries and lookups answered from the cache. */
+  uint16_t negative_hits; /**< Same, for names cached as not found. */
+  uint16_t sent;          /**< Questions sent, including retransmissions. */
+  uint16_t timeouts;      /**< Questions that ran out of retries. */
+  uint16_t evictions;     /**< Live entries replaced to make room. */
+};
+
+CCIF extern struct resolv_stats resolv_stats;
+#endif /* RESOLV_CONF_STATS */
+
 /**
  * Event that is broadcasted when a DNS name has been resolved.
  */
@@ -53,10 +53,63 @@
 #define CHAMELEON_WITH_MAC_LINK_ADDRESSES 0
 #endif /* !CHAMELEON_CONF_WITH_MAC_LINK_ADDRESSES */
 
+/* The attribute lists of the open channels are compiled into a
+   sequence of precomputed header operations the first time a channel
+   sends or receives a packet. CHAMELEON_BITOPT_CONF_LAYOUTS is the
+   number of distinct attribute lists that can be compiled and
+   CHAMELEON_BITOPT_CONF_OPS the total number of attributes they may
+   contain. Channels whose attribute list does not fit are handled by
+   interpreting the attribute list on every packet. With no layouts,
+   every attribute list is interpreted. */
+#ifdef CHAMELEON_BITOPT_CONF_LAYOUTS
+#define CHAMELEON_BITOPT_LAYOUTS CHAMELEON_BITOPT_CONF_LAYOUTS
+#else /* CHAMELEON_BITOPT_CONF_LAYOUTS */
+#define CHAMELEON_BITOPT_LAYOUTS 8
+#endif /* CHAMELEON_BITOPT_CONF_LAYOUTS */
+
+#ifdef CHAMELEON_BITOPT_CONF_OPS
+#define CHAMELEON_BITOPT_OPS CHAMELEON_BITOPT_CONF_OPS
+#else /* CHAMELEON_BITOPT_CONF_OPS */
+#define CHAMELEON_BITOPT_OPS 32
+#endif /* CHAMELEON_BITOPT_CONF_OPS */
+
 struct bitopt_hdr {
   uint8_t channel[2];
 };
 
+/* A single precompiled header operation. The field is copied
+   directly between the header and the packetbuf attribute storage. */
+struct bitopt_op {
+  uint8_t *attr;   /* The packetbuf attribute or address storage */
+  uint8_t byteptr; /* Byte offset of the field in the header */
+  uint8_t bitpos;  /* Bit offset of the field in its first byte */
+  uint8_t len;     /* Length of the field in bits */
+  uint8_t kind;    /* One of the OP_ values below */
+};
+
+/* Byte-aligned field of whole bytes: a plain copy */
+#define OP_BYTES 0
+/* Field shorter than a byte: a single masked shift */
+#define OP_SMALL 1
+/* Unaligned field of a byte or more: the generic bit copy */
+#define OP_BITS  2
+
+struct bitopt_layout {
+  const struct packetbuf_attrlist *attrlist;
+  uint8_t first, nops;
+};
+
+/* Values of the layout field in struct channel that do not refer to
+   a compiled layout. Compiled layouts are stored as index + 1. */
+#define LAYOUT_NONE        0
+#define LAYOUT_INTERPRETED 0xff
+
+#if CHAMELEON_BITOPT_LAYOUTS > 0
+static struct bitopt_op ops[CHAMELEON_BITOPT_OPS];
+static struct bitopt_layout layouts[CHAMELEON_BITOPT_LAYOUTS];
+static uint8_t num_ops, num_layouts;
+#endif /* CHAMELEON_BITOPT_LAYOUTS > 0 */
+
 static const uint8_t bitmask[9] = { 0x00, 0x80, 0xc0, 0xe0, 0xf0,
 				 0xf8, 0xfc, 0xfe, 0xff };
 
@@ -230,6 +283,127 @@ printhdr(uint8_t *hdr, int len)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if CHAMELEON_BITOPT_LAYOUTS > 0
+static uint8_t
+compile_layout(const struct packetbuf_attrlist *attrlist)
+{
+  const struct packetbuf_attrlist *a;
+  struct bitopt_layout *l;
+  struct bitopt_op *op;
+  int i, bitptr;
+
+  /* Many channels share the attribute list of their primitive, so
+     look for an existing layout first. */
+  for(i = 0; i < num_layouts; ++i) {
+    if(layouts[i].attrlist == attrlist) {
+      return i + 1;
+    }
+  }
+  if(num_layouts == CHAMELEON_BITOPT_LAYOUTS) {
+    PRINTF("chameleon-bitopt: no free layout\n");
+    return LAYOUT_INTERPRETED;
+  }
+
+  l = &layouts[num_layouts];
+  l->first = num_ops;
+  l->nops = 0;
+  bitptr = 0;
+  for(a = attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
+#if CHAMELEON_WITH_MAC_LINK_ADDRESSES
+    if(a->type == PACKETBUF_ADDR_SENDER ||
+       a->type == PACKETBUF_ADDR_RECEIVER) {
+      /* Let the link layer handle sender and receiver */
+      continue;
+    }
+#endif /* CHAMELEON_WITH_MAC_LINK_ADDRESSES */
+    if(l->first + l->nops == CHAMELEON_BITOPT_OPS) {
+      PRINTF("chameleon-bitopt: no free header operations\n");
+      return LAYOUT_INTERPRETED;
+    }
+    op = &ops[l->first + l->nops];
+    if(PACKETBUF_IS_ADDR(a->type)) {
+      op->attr = (uint8_t *)&packetbuf_addrs[a->type - PACKETBUF_ADDR_FIRST].addr;
+    } else {
+      op->attr = (uint8_t *)&packetbuf_attrs[a->type].val;
+    }
+    op->byteptr = bitptr / 8;
+    op->bitpos = bitptr & 7;
+    op->len = a->len;
+    if(a->len < 8) {
+      op->kind = OP_SMALL;
+    } else if((bitptr & 7) == 0 && (a->len & 7) == 0) {
+      op->kind = OP_BYTES;
+    } else {
+      op->kind = OP_BITS;
+    }
+    l->nops++;
+    bitptr += a->len;
+  }
+  l->attrlist = attrlist;
+  num_ops += l->nops;
+  num_layouts++;
+
+  return num_layouts;
+}
+/*---------------------------------------------------------------------------*/
+static struct bitopt_layout *
+channel_layout(struct channel *c)
+{
+  if(c->layout == LAYOUT_NONE) {
+    c->layout = compile_layout(c->attrlist);
+  }
+  if(c->layout == LAYOUT_INTERPRETED) {
+    return NULL;
+  }
+  return &layouts[c->layout - 1];
+}
+/*---------------------------------------------------------------------------*/
+static void
+pack_compiled(const struct bitopt_layout *l, uint8_t *hdrptr)
+{
+  const struct bitopt_op *op, *end;
+
+  end = &ops[l->first + l->nops];
+  for(op = &ops[l->first]; op < end; ++op) {
+    switch(op->kind) {
+    case OP_BYTES:
+      memcpy(&hdrptr[op->byteptr], op->attr, op->len / 8);
+      break;
+    case OP_SMALL:
+      set_bits_in_byte(&hdrptr[op->byteptr], op->bitpos, *op->attr, op->len);
+      break;
+    default:
+      set_bits(&hdrptr[op->byteptr], op->bitpos, op->attr, op->len);
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+unpack_compiled(const struct bitopt_layout *l, uint8_t *hdrptr)
+{
+  const struct bitopt_op *op, *end;
+
+  end = &ops[l->first + l->nops];
+  for(op = &ops[l->first]; op < end; ++op) {
+    /* Attributes shorter than the storage have their upper bits
+       cleared, as when unpacking into a zeroed packetbuf_attr_t. */
+    memset(op->attr, 0, sizeof(packetbuf_attr_t));
+    switch(op->kind) {
+    case OP_BYTES:
+      memcpy(op->attr, &hdrptr[op->byteptr], op->len / 8);
+      break;
+    case OP_SMALL:
+      *op->attr = get_bits_in_byte(&hdrptr[op->byteptr], op->bitpos, op->len);
+      break;
+    default:
+      get_bits(op->attr, &hdrptr[op->byteptr], op->bitpos, op->len);
+      break;
+    }
+  }
+}
+#endif /* CHAMELEON_BITOPT_LAYOUTS > 0 */
+/*---------------------------------------------------------------------------*/
 static int
 pack_header(struct channel *c)
 {
@@ -238,7 +412,12 @@ pack_header(struct channel *c)
   int byteptr, bitptr, len;
   uint8_t *hdrptr;
   struct bitopt_hdr *hdr;
-  
+#if CHAMELEON_BITOPT_LAYOUTS > 0
+  struct bitopt_layout *l;
+
+  l = channel_layout(c);
+#endif /* CHAMELEON_BITOPT_LAYOUTS > 0 */
+
   /* Compute the total size of the final header by summing the size of
      all attributes that are used on this channel. */
 
@@ -253,7 +432,14 @@ pack_header(struct channel *c)
 
   hdrptr = ((uint8_t *)packetbuf_hdrptr()) + sizeof(struct bitopt_hdr);
   memset(hdrptr, 0, hdrbytesize);
-  
+
+#if CHAMELEON_BITOPT_LAYOUTS > 0
+  if(l != NULL) {
+    pack_compiled(l, hdrptr);
+    return 1; /* Send out packet */
+  }
+#endif /* CHAMELEON_BITOPT_LAYOUTS > 0 */
+
   byteptr = bitptr = 0;
   
   for(a = c->attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
@@ -304,7 +490,9 @@ unpack_header(void)
   uint8_t *hdrptr;
   struct bitopt_hdr *hdr;
   struct channel *c;
-  
+#if CHAMELEON_BITOPT_LAYOUTS > 0
+  struct bitopt_layout *l;
+#endif /* CHAMELEON_BITOPT_LAYOUTS > 0 */
 
   /* The packet has a header that tells us what channel the packet is
      for. */
@@ -326,6 +514,15 @@ unpack_header(void)
     PRINTF("chameleon-bitopt: too short packet\n");
     return NULL;
   }
+
+#if CHAMELEON_BITOPT_LAYOUTS > 0
+  l = channel_layout(c);
+  if(l != NULL) {
+    unpack_compiled(l, hdrptr);
+    return c;
+  }
+#endif /* CHAMELEON_BITOPT_LAYOUTS > 0 */
+
   byteptr = bitptr = 0;
   for(a = c->attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
 #if CHAMELEON_WITH_MAC_LINK_ADDRESSES
@@ -41,13 +41,32 @@
 #include "net/rime.h"
 #include "lib/list.h"
 
-LIST(channel_list);
+#ifdef CHANNEL_CONF_HASH_SIZE
+#define CHANNEL_HASH_SIZE CHANNEL_CONF_HASH_SIZE
+#else /* CHANNEL_CONF_HASH_SIZE */
+#define CHANNEL_HASH_SIZE 8
+#endif /* CHANNEL_CONF_HASH_SIZE */
+
+/* Open channels are kept in a small hash table of lists, keyed by
+   channel number, so that the demultiplexing of an incoming packet
+   does not have to walk every open channel. Channels with the same
+   number end up in the same bucket, in the order they were opened,
+   which keeps the old first-opened-wins lookup semantics. The hash
+   size must be a power of two. */
+static void *channel_hash[CHANNEL_HASH_SIZE];
+
+#define CHANNEL_BUCKET(channelno) \
+  ((list_t)&channel_hash[(channelno) & (CHANNEL_HASH_SIZE - 1)])
 
 /*---------------------------------------------------------------------------*/
 void
 channel_init(void)
 {
-  list_init(channel_list);
+  int i;
+
+  for(i = 0; i < CHANNEL_HASH_SIZE; i++) {
+    list_init((list_t)&channel_hash[i]);
+  }
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -59,6 +78,7 @@ channel_set_attributes(uint16_t channelno,
   if(c != NULL) {
     c->attrlist = attrlist;
     c->hdrsize = chameleon_hdrsize(attrlist);
+    c->layout = 0;
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -66,20 +86,26 @@ void
 channel_open(struct channel *c, uint16_t channelno)
 {
   c->channelno = channelno;
-  list_add(channel_list, c);
+  c->layout = 0;
+#if RIMESTATS_CONF_ENABLED
+  c->rx = c->tx = 0;
+#endif /* RIMESTATS_CONF_ENABLED */
+  list_add(CHANNEL_BUCKET(channelno), c);
 }
 /*---------------------------------------------------------------------------*/
 void
 channel_close(struct channel *c)
 {
-  list_remove(channel_list, c);
+  list_remove(CHANNEL_BUCKET(c->channelno), c);
 }
 /*---------------------------------------------------------------------------*/
 struct channel *
 channel_lookup(uint16_t channelno)
 {
   struct channel *c;
-  for(c = list_head(channel_list); c != NULL; c = list_item_next(c)) {
+  for(c = list_head(CHANNEL_BUCKET(channelno));
+      c != NULL;
+      c = list_item_next(c)) {
     if(c->channelno == channelno) {
       return c;
     }
@@ -51,6 +51,13 @@ struct channel {
   uint16_t channelno;
   const struct packetbuf_attrlist *attrlist;
   uint8_t hdrsize;
+  /* Header layout private to the Chameleon module, reset whenever the
+     attribute list changes */
+  uint8_t layout;
+#if RIMESTATS_CONF_ENABLED
+  /* Per-channel packet counters, see RIMESTATS_CHANNEL_GET() */
+  unsigned long rx, tx;
+#endif /* RIMESTATS_CONF_ENABLED */
 };
 
 struct channel *channel_lookup(uint16_t channelno);
@@ -544,6 +544,294 @@ proactive_probing_callback(void *ptr)
     return;
   }
 }
+#if COLLECT_WINDOW > 1
+/*---------------------------------------------------------------------------*/
+/*
+ * Windowed operation: up to COLLECT_WINDOW packets are taken off the
+ * send queue and sent to the parent without waiting for the ACK of
+ * the previous one. Each packet in the window carries its own per-hop
+ * sequence number in PACKETBUF_ATTR_PACKET_ID, which the parent
+ * echoes in its ACK, so every packet is acknowledged, retransmitted
+ * and timed out individually.
+ */
+static void window_retransmit_callback(void *ptr);
+/*---------------------------------------------------------------------------*/
+static struct collect_window_entry *
+window_find(struct collect_conn *c, uint8_t seqno)
+{
+  int i;
+
+  for(i = 0; i < c->window_len; i++) {
+    if(c->window[i].seqno == seqno) {
+      return &c->window[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_remove(struct collect_conn *c, struct collect_window_entry *e)
+{
+  queuebuf_free(e->q);
+  c->window_len--;
+  memmove(e, e + 1,
+          (char *)&c->window[c->window_len] - (char *)e);
+  if(c->window_len == 0) {
+    c->sending = 0;
+    ctimer_stop(&c->retransmission_timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_flush(struct collect_conn *c)
+{
+  while(c->window_len > 0) {
+    window_remove(c, &c->window[0]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_transmit(struct collect_conn *c, struct collect_window_entry *e,
+                struct collect_neighbor *n)
+{
+  struct data_msg_hdr hdr;
+  int max_mac_rexmits;
+
+  queuebuf_to_packetbuf(e->q);
+
+  packetbuf_set_attr(PACKETBUF_ATTR_RELIABLE, 1);
+  max_mac_rexmits = e->max_rexmits - e->transmissions > MAX_MAC_REXMITS?
+    MAX_MAC_REXMITS : e->max_rexmits - e->transmissions;
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS, max_mac_rexmits);
+  packetbuf_set_attr(PACKETBUF_ATTR_PACKET_ID, e->seqno);
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.rtmetric = c->rtmetric;
+  memcpy(packetbuf_dataptr(), &hdr, sizeof(struct data_msg_hdr));
+
+  PRINTF("%d.%d: window: sending packet %d to %d.%d, %d transmissions\n",
+         rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         e->seqno, n->addr.u8[0], n->addr.u8[1], e->transmissions);
+
+  stats.datasent++;
+  c->send_time = clock_time();
+  unicast_send(&c->unicast_conn, &n->addr);
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function fills the window with packets from the send
+ * queue. It returns zero if there is no parent to send to and the
+ * window is empty, in which case the caller should look for a route.
+ */
+static int
+window_send(struct collect_conn *c)
+{
+  struct collect_neighbor *n;
+  struct collect_window_entry *e;
+  struct packetqueue_item *i;
+  int was_empty;
+
+  /* Packets in the window are all sent to the same parent. If the
+     parent has changed, we let the window drain (the retransmission
+     timer moves the remaining packets to the new parent) before new
+     packets are sent. */
+  if(c->window_len > 0 && !rimeaddr_cmp(&c->current_parent, &c->parent)) {
+    return 1;
+  }
+
+  n = collect_neighbor_list_find(&c->neighbor_list, &c->parent);
+  if(n == NULL) {
+    return c->window_len > 0;
+  }
+
+  was_empty = c->window_len == 0;
+  rimeaddr_copy(&c->current_parent, &c->parent);
+
+  while(c->window_len < COLLECT_WINDOW &&
+        (i = packetqueue_first(&c->send_queue)) != NULL) {
+    e = &c->window[c->window_len++];
+    c->sending = 1;
+
+    /* Take the queuebuf over from the send queue. */
+    e->q = packetqueue_queuebuf(i);
+    i->buf = NULL;
+    packetqueue_dequeue(&c->send_queue);
+
+    e->seqno = c->seqno;
+    c->seqno = (c->seqno + 1) % (1 << COLLECT_PACKET_ID_BITS);
+    e->transmissions = 0;
+    e->max_rexmits = queuebuf_attr(e->q, PACKETBUF_ATTR_MAX_REXMIT);
+
+    window_transmit(c, e, n);
+  }
+
+  /* Defensive programming, as in send_packet(): if the MAC/RDC layer
+     never calls us back, the retransmission timer still fires. */
+  if(was_empty && c->window_len > 0) {
+    ctimer_set(&c->retransmission_timer, 16 * REXMIT_TIME,
+               window_retransmit_callback, c);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_drop(struct collect_conn *c, struct collect_window_entry *e)
+{
+  struct collect_neighbor *n;
+
+  PRINTF("%d.%d: window: packet %d timed out after %d transmissions\n",
+         rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         e->seqno, e->transmissions);
+  stats.timedout++;
+  n = collect_neighbor_list_find(&c->neighbor_list, &c->current_parent);
+  if(n != NULL) {
+    collect_neighbor_tx_fail(n, e->max_rexmits);
+  }
+  window_remove(c, e);
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_packet_sent(struct collect_conn *c, int transmissions)
+{
+  struct collect_window_entry *e;
+
+  e = window_find(c, packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+  if(e != NULL) {
+    e->transmissions += transmissions;
+    if(e->transmissions >= e->max_rexmits) {
+      window_drop(c, e);
+      update_rtmetric(c);
+      window_send(c);
+      set_keepalive_timer(c);
+    }
+  }
+  if(c->window_len > 0) {
+    ctimer_set(&c->retransmission_timer,
+               REXMIT_TIME / 2 + (random_rand() % (REXMIT_TIME / 2)),
+               window_retransmit_callback, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * This function is called from the retransmission timer when one or
+ * more packets in the window have not been acknowledged. Every
+ * unacknowledged packet is retransmitted, or dropped if it has used
+ * up its transmissions.
+ */
+static void
+window_retransmit_callback(void *ptr)
+{
+  struct collect_conn *c = ptr;
+  struct collect_window_entry *e;
+  struct collect_neighbor *n;
+  uint8_t seqnos[COLLECT_WINDOW];
+  int i, len;
+
+  update_rtmetric(c);
+
+  /* If we have found a better parent, the packets in the window are
+     sent there instead, starting over their transmission count. */
+  if(!rimeaddr_cmp(&c->current_parent, &c->parent)) {
+    PRINTF("window: parent change from %d.%d to %d.%d\n",
+           c->current_parent.u8[0], c->current_parent.u8[1],
+           c->parent.u8[0], c->parent.u8[1]);
+    rimeaddr_copy(&c->current_parent, &c->parent);
+    for(i = 0; i < c->window_len; i++) {
+      c->window[i].transmissions = 0;
+    }
+  }
+  n = collect_neighbor_list_find(&c->neighbor_list, &c->current_parent);
+
+  /* The window may change under our feet when the MAC layer calls
+     back synchronously, so we go through the packets by sequence
+     number rather than by position. */
+  len = c->window_len;
+  for(i = 0; i < len; i++) {
+    seqnos[i] = c->window[i].seqno;
+  }
+  for(i = 0; i < len; i++) {
+    e = window_find(c, seqnos[i]);
+    if(e == NULL) {
+      continue;
+    }
+    /* Count the timeout itself as a transmission, so that packets are
+       eventually dropped even if the MAC layer never reports back. */
+    e->transmissions++;
+    if(e->transmissions >= e->max_rexmits) {
+      window_drop(c, e);
+    } else if(n != NULL) {
+      window_transmit(c, e, n);
+    }
+  }
+
+  window_send(c);
+  set_keepalive_timer(c);
+  if(c->window_len > 0) {
+    ctimer_set(&c->retransmission_timer,
+               REXMIT_TIME + (random_rand() % REXMIT_TIME),
+               window_retransmit_callback, c);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window_handle_ack(struct collect_conn *c)
+{
+  struct collect_window_entry *e;
+  struct collect_neighbor *n;
+  struct ack_msg msg;
+
+  e = window_find(c, packetbuf_attr(PACKETBUF_ATTR_PACKET_ID));
+  if(e == NULL ||
+     !rimeaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                   &c->current_parent)) {
+    stats.badack++;
+    return;
+  }
+
+  memcpy(&msg, packetbuf_dataptr(), sizeof(struct ack_msg));
+
+  /* As in handle_ack(), an ACK for a packet we have not yet been told
+     was sent is attributed MAX_MAC_REXMITS transmissions. */
+  if(e->transmissions == 0) {
+    e->transmissions = MAX_MAC_REXMITS;
+  }
+  n = collect_neighbor_list_find(&c->neighbor_list,
+                                 packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  if(n != NULL) {
+    collect_neighbor_tx(n, e->transmissions);
+    collect_neighbor_update_rtmetric(n, msg.rtmetric);
+  }
+
+  PRINTF("%d.%d: window: ACK for %d after %d transmissions, flags %02x\n",
+         rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+         e->seqno, e->transmissions, msg.flags);
+
+  if(msg.flags & ACK_FLAGS_CONGESTED) {
+    if(n != NULL) {
+      collect_neighbor_set_congested(n);
+      collect_neighbor_tx(n, e->max_rexmits * 2);
+    }
+  }
+  if((msg.flags & ACK_FLAGS_DROPPED) == 0 ||
+     (msg.flags & ACK_FLAGS_LIFETIME_EXCEEDED)) {
+    /* The packet was received by the parent, or it cannot be
+       delivered anyway: it leaves the window. */
+    window_remove(c, e);
+  } else if(n != NULL) {
+    /* The packet was dropped by the parent: it stays in the window
+       and is retransmitted when the retransmission timer fires. */
+    collect_neighbor_tx(n, e->max_rexmits);
+  }
+  update_rtmetric(c);
+
+  if(msg.flags & ACK_FLAGS_RTMETRIC_NEEDS_UPDATE) {
+    bump_advertisement(c);
+  }
+
+  window_send(c);
+  set_keepalive_timer(c);
+}
+#endif /* COLLECT_WINDOW > 1 */
 /*---------------------------------------------------------------------------*/
 /**
  * This function is called when a queued packet should be sent
@@ -561,6 +849,12 @@ send_queued_packet(struct collect_conn *c)
   struct data_msg_hdr hdr;
   int max_mac_rexmits;
 
+#if COLLECT_WINDOW > 1
+  if(window_send(c)) {
+    return;
+  }
+#endif /* COLLECT_WINDOW > 1 */
+
   /* If we are currently sending a packet, we do not attempt to send
      another one. */
   if(c->sending) {
@@ -767,6 +1061,11 @@ handle_ack(struct collect_conn *tc)
   struct ack_msg msg;
   struct collect_neighbor *n;
 
+#if COLLECT_WINDOW > 1
+  window_handle_ack(tc);
+  return;
+#endif /* COLLECT_WINDOW > 1 */
+
   PRINTF("handle_ack: sender %d.%d current_parent %d.%d, id %d seqno %d\n",
          packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[0],
          packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8[1],
@@ -1119,6 +1418,11 @@ node_packet_sent(struct unicast_conn *c, int status, int transmissions)
   if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
      PACKETBUF_ATTR_PACKET_TYPE_DATA) {
 
+#if COLLECT_WINDOW > 1
+    window_packet_sent(tc, transmissions);
+    return;
+#endif /* COLLECT_WINDOW > 1 */
+
     tc->transmissions += transmissions;
     PRINTF("tx %d\n", tc->transmissions);    
     PRINTF("%d.%d: MAC sent %d transmissions to %d.%d, status %d, total transmissions %d\n",
@@ -1289,6 +1593,9 @@ collect_open(struct collect_conn *tc, uint16_t channels,
   tc->is_router = is_router;
   tc->seqno = 10;
   tc->eseqno = 0;
+#if COLLECT_WINDOW > 1
+  tc->window_len = 0;
+#endif /* COLLECT_WINDOW > 1 */
   LIST_STRUCT_INIT(tc, send_queue_list);
   collect_neighbor_list_new(&tc->neighbor_list);
   tc->send_queue.list = &(tc->send_queue_list);
@@ -1369,6 +1676,9 @@ collect_close(struct collect_conn *tc)
   while(packetqueue_first(&tc->send_queue) != NULL) {
     packetqueue_dequeue(&tc->send_queue);
   }
+#if COLLECT_WINDOW > 1
+  window_flush(tc);
+#endif /* COLLECT_WINDOW > 1 */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -1385,6 +1695,10 @@ collect_set_sink(struct collect_conn *tc, int should_be_sink)
       packetqueue_dequeue(&tc->send_queue);
     }
 
+#if COLLECT_WINDOW > 1
+    window_flush(tc);
+#endif /* COLLECT_WINDOW > 1 */
+
     /* Stop the retransmission timer. */
     ctimer_stop(&tc->retransmission_timer);
   } else {
@@ -92,6 +92,26 @@ struct collect_callbacks {
 #define COLLECT_ANNOUNCEMENTS COLLECT_CONF_ANNOUNCEMENTS
 #endif /* COLLECT_CONF_ANNOUNCEMENTS */
 
+/* COLLECT_CONF_WINDOW defines how many packets a node may have in
+   flight towards its parent at the same time. With the default
+   window of one packet, Collect is stop-and-wait: the next packet is
+   sent only when the previous one has been acknowledged. With a
+   larger window, each packet is given its own per-hop sequence number
+   and is acknowledged individually by the parent, so nodes with
+   different window sizes can be mixed in the same network. */
+#ifdef COLLECT_CONF_WINDOW
+#define COLLECT_WINDOW COLLECT_CONF_WINDOW
+#else /* COLLECT_CONF_WINDOW */
+#define COLLECT_WINDOW 1
+#endif /* COLLECT_CONF_WINDOW */
+
+#if COLLECT_WINDOW > 1
+struct collect_window_entry {
+  struct queuebuf *q;
+  uint8_t seqno, transmissions, max_rexmits;
+};
+#endif /* COLLECT_WINDOW > 1 */
+
 struct collect_conn {
   struct unicast_conn unicast_conn;
 #if ! COLLECT_ANNOUNCEMENTS
@@ -119,6 +139,11 @@ struct collect_conn {
   uint8_t is_router;
 
   clock_time_t send_time;
+
+#if COLLECT_WINDOW > 1
+  struct collect_window_entry window[COLLECT_WINDOW];
+  uint8_t window_len;
+#endif /* COLLECT_WINDOW > 1 */
 };
 
 enum {
@@ -93,6 +93,15 @@ data_packet_forward(struct multihop_conn *multihop,
 
   rt = route_lookup(dest);
   if(rt == NULL) {
+    if(route_negative_lookup(dest)) {
+      /* Route discovery for this destination recently failed: drop
+         the packet instead of flooding another route request. */
+      PRINTF("data_packet_forward: destination unreachable, dropping\n");
+      if(prevhop == NULL && c->cb->timedout != NULL) {
+        c->cb->timedout(c);
+      }
+      return NULL;
+    }
     if(c->queued_data != NULL) {
       queuebuf_free(c->queued_data);
     }
@@ -146,6 +155,7 @@ route_timed_out(struct route_discovery_conn *rdc)
     ((char *)rdc - offsetof(struct mesh_conn, route_discovery_conn));
 
   if(c->queued_data != NULL) {
+    route_negative_add(&c->queued_data_dest);
     queuebuf_free(c->queued_data);
     c->queued_data = NULL;
   }
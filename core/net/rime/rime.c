@@ -116,6 +116,7 @@ input(void)
   }
   
   if(c != NULL) {
+    RIMESTATS_CHANNEL_ADD(c, rx);
     abc_input(c);
   }
 }
@@ -177,6 +178,7 @@ int
 rime_output(struct channel *c)
 {
   RIMESTATS_ADD(tx);
+  RIMESTATS_CHANNEL_ADD(c, tx);
   if(chameleon_create(c)) {
     packetbuf_compact();
 
@@ -61,9 +61,15 @@ extern struct rimestats rimestats;
 
 #define RIMESTATS_ADD(x) rimestats.x++
 #define RIMESTATS_GET(x) rimestats.x
+
+/* Per-channel counters (rx, tx), kept in struct channel */
+#define RIMESTATS_CHANNEL_ADD(c, x) (c)->x++
+#define RIMESTATS_CHANNEL_GET(c, x) (c)->x
 #else /* RIMESTATS_CONF_ENABLED */
 #define RIMESTATS_ADD(x)
 #define RIMESTATS_GET(x) 0
+#define RIMESTATS_CHANNEL_ADD(c, x)
+#define RIMESTATS_CHANNEL_GET(c, x) 0
 #endif /* RIMESTATS_CONF_ENABLED */
 
 #endif /* RIMESTATS_H_ */
@@ -43,6 +43,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -68,12 +69,49 @@
 #define DEFAULT_LIFETIME 60
 #endif /* ROUTE_CONF_DEFAULT_LIFETIME */
 
+/* The number of hash buckets used to index route entries by
+   destination. Must be a power of two. */
+#ifdef ROUTE_CONF_HASH_SIZE
+#define ROUTE_HASH_SIZE ROUTE_CONF_HASH_SIZE
+#else /* ROUTE_CONF_HASH_SIZE */
+#define ROUTE_HASH_SIZE 8
+#endif /* ROUTE_CONF_HASH_SIZE */
+
+/* The number of destinations that can be remembered as unreachable,
+   and for how many seconds. Setting the number of entries to zero
+   disables the negative cache. */
+#ifdef ROUTE_CONF_NEGATIVE_ENTRIES
+#define NUM_NEGATIVE_ENTRIES ROUTE_CONF_NEGATIVE_ENTRIES
+#else /* ROUTE_CONF_NEGATIVE_ENTRIES */
+#define NUM_NEGATIVE_ENTRIES 4
+#endif /* ROUTE_CONF_NEGATIVE_ENTRIES */
+
+#ifdef ROUTE_CONF_NEGATIVE_LIFETIME
+#define NEGATIVE_LIFETIME ROUTE_CONF_NEGATIVE_LIFETIME
+#else /* ROUTE_CONF_NEGATIVE_LIFETIME */
+#define NEGATIVE_LIFETIME 10
+#endif /* ROUTE_CONF_NEGATIVE_LIFETIME */
+
 /*
- * List of route entries.
+ * List of route entries, most recently used first.
  */
 LIST(route_table);
 MEMB(route_mem, struct route_entry, NUM_RT_ENTRIES);
 
+/*
+ * Route entries hashed on their destination address, chained
+ * through the hnext field.
+ */
+static struct route_entry *route_hash[ROUTE_HASH_SIZE];
+
+#if NUM_NEGATIVE_ENTRIES > 0
+struct negative_entry {
+  rimeaddr_t dest;
+  uint8_t time; /* Seconds left, zero if the entry is unused */
+};
+static struct negative_entry negative_cache[NUM_NEGATIVE_ENTRIES];
+#endif /* NUM_NEGATIVE_ENTRIES > 0 */
+
 static struct ctimer t;
 
 static int max_time = DEFAULT_LIFETIME;
@@ -87,21 +125,71 @@ static int max_time = DEFAULT_LIFETIME;
 #endif
 
 
+/*---------------------------------------------------------------------------*/
+static struct route_entry **
+hash_bucket(const rimeaddr_t *addr)
+{
+  uint8_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < sizeof(rimeaddr_t); i++) {
+    h = (h << 1) ^ addr->u8[i];
+  }
+  return &route_hash[h & (ROUTE_HASH_SIZE - 1)];
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(struct route_entry *e)
+{
+  struct route_entry **p;
+
+  for(p = hash_bucket(&e->dest); *p != NULL; p = &(*p)->hnext) {
+    if(*p == e) {
+      *p = e->hnext;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+negative_remove(const rimeaddr_t *dest)
+{
+#if NUM_NEGATIVE_ENTRIES > 0
+  int i;
+
+  for(i = 0; i < NUM_NEGATIVE_ENTRIES; i++) {
+    if(negative_cache[i].time != 0 &&
+       rimeaddr_cmp(&negative_cache[i].dest, dest)) {
+      negative_cache[i].time = 0;
+    }
+  }
+#endif /* NUM_NEGATIVE_ENTRIES > 0 */
+}
 /*---------------------------------------------------------------------------*/
 static void
 periodic(void *ptr)
 {
-  struct route_entry *e;
+  struct route_entry *e, *next;
+#if NUM_NEGATIVE_ENTRIES > 0
+  int i;
 
-  for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
+  for(i = 0; i < NUM_NEGATIVE_ENTRIES; i++) {
+    if(negative_cache[i].time != 0) {
+      negative_cache[i].time--;
+    }
+  }
+#endif /* NUM_NEGATIVE_ENTRIES > 0 */
+
+  for(e = list_head(route_table); e != NULL; e = next) {
+    next = list_item_next(e);
     e->time++;
     if(e->time >= max_time) {
       PRINTF("route periodic: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
 	     e->dest.u8[0], e->dest.u8[1],
 	     e->nexthop.u8[0], e->nexthop.u8[1],
 	     e->cost);
-      list_remove(route_table, e);
-      memb_free(&route_mem, e);
+      route_remove(e);
     }
   }
 
@@ -113,6 +201,10 @@ route_init(void)
 {
   list_init(route_table);
   memb_init(&route_mem);
+  memset(route_hash, 0, sizeof(route_hash));
+#if NUM_NEGATIVE_ENTRIES > 0
+  memset(negative_cache, 0, sizeof(negative_cache));
+#endif /* NUM_NEGATIVE_ENTRIES > 0 */
 
   ctimer_set(&t, CLOCK_SECOND, periodic, NULL);
 }
@@ -121,23 +213,29 @@ int
 route_add(const rimeaddr_t *dest, const rimeaddr_t *nexthop,
 	  uint8_t cost, uint8_t seqno)
 {
-  struct route_entry *e;
+  struct route_entry *e, **bucket;
+
+  /* A destination we have a route to is no longer unreachable. */
+  negative_remove(dest);
 
   /* Avoid inserting duplicate entries. */
   e = route_lookup(dest);
   if(e != NULL && rimeaddr_cmp(&e->nexthop, nexthop)) {
     list_remove(route_table, e);
   } else {
-    /* Allocate a new entry or reuse the oldest entry with highest cost. */
+    /* Allocate a new entry or reuse the least recently used entry. */
     e = memb_alloc(&route_mem);
     if(e == NULL) {
-      /* Remove oldest entry.  XXX */
       e = list_chop(route_table);
       PRINTF("route_add: removing entry to %d.%d with nexthop %d.%d and cost %d\n",
 	     e->dest.u8[0], e->dest.u8[1],
 	     e->nexthop.u8[0], e->nexthop.u8[1],
 	     e->cost);
+      hash_remove(e);
     }
+    bucket = hash_bucket(dest);
+    e->hnext = *bucket;
+    *bucket = e;
   }
 
   rimeaddr_copy(&e->dest, dest);
@@ -169,10 +267,7 @@ route_lookup(const rimeaddr_t *dest)
   best_entry = NULL;
   
   /* Find the route with the lowest cost. */
-  for(e = list_head(route_table); e != NULL; e = list_item_next(e)) {
-    /*    printf("route_lookup: comparing %d.%d.%d.%d with %d.%d.%d.%d\n",
-	   uip_ipaddr_to_quad(dest), uip_ipaddr_to_quad(&e->dest));*/
-
+  for(e = *hash_bucket(dest); e != NULL; e = e->hnext) {
     if(rimeaddr_cmp(dest, &e->dest)) {
       if(e->cost < lowest_cost) {
 	best_entry = e;
@@ -191,7 +286,10 @@ route_refresh(struct route_entry *e)
        out. */
     e->time = 0;
     e->decay = 0;
-    
+
+    /* Keep the route table in least recently used order. */
+    list_push(route_table, e);
+
     PRINTF("route_refresh: time %d last %d decay %d for entry to %d.%d with nexthop %d.%d and cost %d\n",
            e->time, e->time_last_decay, e->decay,
            e->dest.u8[0], e->dest.u8[1],
@@ -232,6 +330,7 @@ void
 route_remove(struct route_entry *e)
 {
   list_remove(route_table, e);
+  hash_remove(e);
   memb_free(&route_mem, e);
 }
 /*---------------------------------------------------------------------------*/
@@ -248,6 +347,7 @@ route_flush_all(void)
       break;
     }
   }
+  memset(route_hash, 0, sizeof(route_hash));
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -283,4 +383,47 @@ route_get(int num)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+void
+route_negative_add(const rimeaddr_t *dest)
+{
+#if NUM_NEGATIVE_ENTRIES > 0
+  struct negative_entry *n, *oldest;
+  int i;
+
+  /* Reuse the entry for the same destination, a free entry, or the
+     entry that is closest to expiring. */
+  oldest = &negative_cache[0];
+  for(i = 0; i < NUM_NEGATIVE_ENTRIES; i++) {
+    n = &negative_cache[i];
+    if(n->time == 0 || rimeaddr_cmp(&n->dest, dest)) {
+      oldest = n;
+      break;
+    }
+    if(n->time < oldest->time) {
+      oldest = n;
+    }
+  }
+  PRINTF("route_negative_add: %d.%d unreachable\n",
+         dest->u8[0], dest->u8[1]);
+  rimeaddr_copy(&oldest->dest, dest);
+  oldest->time = NEGATIVE_LIFETIME;
+#endif /* NUM_NEGATIVE_ENTRIES > 0 */
+}
+/*---------------------------------------------------------------------------*/
+int
+route_negative_lookup(const rimeaddr_t *dest)
+{
+#if NUM_NEGATIVE_ENTRIES > 0
+  int i;
+
+  for(i = 0; i < NUM_NEGATIVE_ENTRIES; i++) {
+    if(negative_cache[i].time != 0 &&
+       rimeaddr_cmp(&negative_cache[i].dest, dest)) {
+      return 1;
+    }
+  }
+#endif /* NUM_NEGATIVE_ENTRIES > 0 */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
@@ -55,6 +55,7 @@
 
 struct route_entry {
   struct route_entry *next;
+  struct route_entry *hnext;
   rimeaddr_t dest;
   rimeaddr_t nexthop;
   uint8_t seqno;
@@ -78,6 +79,26 @@ void route_set_lifetime(int seconds);
 int route_num(void);
 struct route_entry *route_get(int num);
 
+/**
+ * \brief      Remember that a destination could not be reached
+ * \param dest The destination address
+ *
+ *             This function is called when route discovery for a
+ *             destination has failed. The destination is remembered
+ *             for ROUTE_CONF_NEGATIVE_LIFETIME seconds, or until a
+ *             route to it is added, so that callers can avoid
+ *             starting a new route discovery for every packet.
+ */
+void route_negative_add(const rimeaddr_t *dest);
+
+/**
+ * \brief      Check if a destination is known to be unreachable
+ * \param dest The destination address
+ * \return     Non-zero if route discovery for the destination
+ *             recently failed, zero otherwise
+ */
+int route_negative_lookup(const rimeaddr_t *dest);
+
 #endif /* ROUTE_H_ */
 /** @} */
 /** @} */
@@ -54,6 +54,16 @@
 #define NACK_TIMEOUT CLOCK_SECOND / 4
 #define REPAIR_TIMEOUT CLOCK_SECOND / 4
 
+/* If set, receivers request all missing chunks of a page in a single
+   bitmap NACK. Nodes without it do not understand bitmap NACKs, so
+   this is off by default and should only be enabled on all nodes at
+   once. Bitmap NACKs from other nodes are always answered. */
+#ifdef RUDOLPH1_CONF_NACK_BITMAP
+#define NACK_BITMAP RUDOLPH1_CONF_NACK_BITMAP
+#else
+#define NACK_BITMAP 0
+#endif
+
 struct rudolph1_hdr {
   uint8_t type;
   uint8_t version;
@@ -62,17 +72,35 @@ struct rudolph1_hdr {
 
 #define RUDOLPH1_DATASIZE 64
 
+/* The number of chunks covered by one NACK bitmap. */
+#define PAGE_CHUNKS 16
+
 struct rudolph1_datapacket {
   struct rudolph1_hdr h;
   uint8_t datalen;
   uint8_t data[RUDOLPH1_DATASIZE];
 };
 
+/* A bitmap NACK: h.chunk is the first chunk of the page, bit n of
+   missing is set if chunk h.chunk + n is requested. */
+struct rudolph1_nack {
+  struct rudolph1_hdr h;
+  uint16_t missing;
+};
+
 enum {
   TYPE_DATA,
   TYPE_NACK,
+  TYPE_NACK_BITMAP,
 };
 
+#define FLAG_REPAIRING    0x01
+#define FLAG_NACK_QUEUED  0x02
+#define FLAG_NACK_PENDING 0x04
+
+#define PAGE_START(chunk) ((chunk) & ~(PAGE_CHUNKS - 1))
+#define CHUNK_BIT(chunk)  (1U << ((chunk) & (PAGE_CHUNKS - 1)))
+
 #define DEBUG 0
 #if DEBUG
 #include <stdio.h>
@@ -132,10 +160,76 @@ write_data(struct rudolph1_conn *c, int chunk, uint8_t *data, int datalen)
   }
 }
 /*---------------------------------------------------------------------------*/
+static uint16_t
+first_chunks(int n)
+{
+  /* A bitmap with the n lowest chunks of a page set. */
+  if(n <= 0) {
+    return 0;
+  } else if(n >= PAGE_CHUNKS) {
+    return 0xffff;
+  }
+  return (1U << n) - 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+store_chunk(struct rudolph1_conn *c, int chunk, uint8_t *data, int datalen)
+{
+  write_data(c, chunk, data, datalen);
+  c->received |= CHUNK_BIT(chunk);
+
+  /* Move past all chunks we now have in sequence. */
+  while(c->received & CHUNK_BIT(c->chunk)) {
+    c->chunk++;
+    if(PAGE_START(c->chunk) == c->chunk) {
+      c->received = 0;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_nack(struct rudolph1_conn *c)
 {
+#if NACK_BITMAP
+  struct rudolph1_nack *nack;
+  uint16_t page, last;
+#else
   struct rudolph1_hdr *hdr;
+#endif
+
+  if(c->flags & FLAG_REPAIRING) {
+    /* Do not cancel a queued repair; send the NACK after it. */
+    c->flags |= FLAG_NACK_PENDING;
+    return;
+  }
+  c->flags &= ~FLAG_NACK_PENDING;
+
+#if NACK_BITMAP
+  page = PAGE_START(c->chunk);
+  last = c->highest_chunk_heard;
+  if(last < c->chunk) {
+    last = c->chunk;
+  }
+  if(last >= page + PAGE_CHUNKS) {
+    last = page + PAGE_CHUNKS - 1;
+  }
+
+  packetbuf_clear();
+  nack = packetbuf_dataptr();
+  nack->h.type = TYPE_NACK_BITMAP;
+  nack->h.version = c->version;
+  nack->h.chunk = page;
+  nack->missing = first_chunks(last - page + 1) &
+    ~first_chunks(c->chunk - page) & ~c->received;
+  packetbuf_set_datalen(sizeof(struct rudolph1_nack));
+
+  PRINTF("%d.%d: Sending nack for %d:%d bitmap 0x%04x\n",
+	 rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+	 nack->h.version, nack->h.chunk, nack->missing);
+  if(ipolite_send(&c->ipolite, NACK_TIMEOUT, sizeof(struct rudolph1_nack))) {
+    c->flags |= FLAG_NACK_QUEUED;
+  }
+#else /* NACK_BITMAP */
   packetbuf_clear();
   packetbuf_hdralloc(sizeof(struct rudolph1_hdr));
   hdr = packetbuf_hdrptr();
@@ -147,7 +241,62 @@ send_nack(struct rudolph1_conn *c)
   PRINTF("%d.%d: Sending nack for %d:%d\n",
 	 rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
 	 hdr->version, hdr->chunk);
-  ipolite_send(&c->ipolite, NACK_TIMEOUT, sizeof(struct rudolph1_hdr));
+  if(ipolite_send(&c->ipolite, NACK_TIMEOUT, sizeof(struct rudolph1_hdr))) {
+    c->flags |= FLAG_NACK_QUEUED;
+  }
+#endif /* NACK_BITMAP */
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_repair(struct rudolph1_conn *c)
+{
+  int i;
+
+  for(i = 0; i < PAGE_CHUNKS; i++) {
+    if(c->repair_set & (1U << i)) {
+      break;
+    }
+  }
+  if(i == PAGE_CHUNKS) {
+    c->flags &= ~FLAG_REPAIRING;
+    if(c->flags & FLAG_NACK_PENDING) {
+      send_nack(c);
+    }
+    return;
+  }
+  c->repair_set &= ~(1U << i);
+
+  if(c->flags & FLAG_NACK_QUEUED) {
+    /* The repair replaces our queued NACK; resend it afterwards. */
+    c->flags = (c->flags & ~FLAG_NACK_QUEUED) | FLAG_NACK_PENDING;
+  }
+
+  PRINTF("%d.%d: sending repair for chunk %d\n",
+	 rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+	 c->repair_chunk + i);
+  format_data(c, c->repair_chunk + i);
+  if(ipolite_send(&c->ipolite, REPAIR_TIMEOUT, sizeof(struct rudolph1_hdr))) {
+    c->flags |= FLAG_REPAIRING;
+  } else {
+    c->flags &= ~FLAG_REPAIRING;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_repairs(struct rudolph1_conn *c, uint16_t page, uint16_t missing)
+{
+  uint16_t have;
+
+  /* Only repair chunks that we have ourselves. */
+  have = first_chunks(c->chunk - page);
+  if(PAGE_START(c->chunk) == page) {
+    have |= c->received;
+  }
+  if(c->repair_chunk != page) {
+    c->repair_chunk = page;
+    c->repair_set = 0;
+  }
+  c->repair_set |= missing & have;
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -159,11 +308,11 @@ handle_data(struct rudolph1_conn *c, struct rudolph1_datapacket *p)
 	   p->h.version, p->h.chunk);
     c->version = p->h.version;
     c->highest_chunk_heard = c->chunk = 0;
+    c->received = c->repair_set = 0;
       if(p->h.chunk != 0) {
 	send_nack(c);
       } else {
-	write_data(c, 0, p->data, p->datalen);
-	c->chunk = 1; /* Next chunk is 1. */
+	store_chunk(c, 0, p->data, p->datalen); /* Next chunk is 1. */
       }
       /*    }*/
   } else if(p->h.version == c->version) {
@@ -171,29 +320,36 @@ handle_data(struct rudolph1_conn *c, struct rudolph1_datapacket *p)
 	   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
 	   p->h.chunk, c->chunk, c->highest_chunk_heard);
 
+    if(c->highest_chunk_heard < p->h.chunk) {
+      c->highest_chunk_heard = p->h.chunk;
+    }
+
     if(p->h.chunk == c->chunk) {
       PRINTF("%d.%d: received chunk %d\n",
 	     rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
 	     p->h.chunk);
-      write_data(c, p->h.chunk, p->data, p->datalen);
-      if(c->highest_chunk_heard < c->chunk) {
-	c->highest_chunk_heard = c->chunk;
-      }
-      c->chunk++;
+      store_chunk(c, p->h.chunk, p->data, p->datalen);
     } else if(p->h.chunk > c->chunk) {
-      PRINTF("%d.%d: received chunk %d > %d, sending NACK\n",
-	     rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
-	     p->h.chunk, c->chunk);
-      send_nack(c);
-      c->highest_chunk_heard = p->h.chunk;
+      /* Keep full chunks from the current page even if they arrive
+	 out of order. The last, short, chunk completes the file and
+	 must be written in order. The first chunk must have been
+	 written before, as it starts the new file. */
+      if(c->chunk > 0 &&
+	 PAGE_START(p->h.chunk) == PAGE_START(c->chunk) &&
+	 p->datalen == RUDOLPH1_DATASIZE &&
+	 !(c->received & CHUNK_BIT(p->h.chunk))) {
+	PRINTF("%d.%d: received chunk %d out of order (%d)\n",
+	       rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
+	       p->h.chunk, c->chunk);
+	store_chunk(c, p->h.chunk, p->data, p->datalen);
+      }
     } else if(p->h.chunk < c->chunk) {
       /* Ignore packets with a lower chunk number */
     }
 
     /* If we have heard a higher chunk number, we send a NACK so that
-       we get a repair for the next packet. */
-    
-    if(c->highest_chunk_heard > p->h.chunk) {
+       we get repairs for the chunks we are missing. */
+    if(c->highest_chunk_heard >= c->chunk) {
       send_nack(c);
     }
   } else { /* p->h.version < c->current.h.version */
@@ -219,15 +375,31 @@ recv_trickle(struct trickle_conn *trickle)
 static void
 sent_ipolite(struct ipolite_conn *ipolite)
 {
+  struct rudolph1_conn *c = (struct rudolph1_conn *)
+    ((char *)ipolite - offsetof(struct rudolph1_conn, ipolite));
+
   PRINTF("%d.%d: Sent ipolite\n",
 	 rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1]);
+
+  c->flags &= ~FLAG_NACK_QUEUED;
+  if(c->flags & FLAG_REPAIRING) {
+    /* Queue the next repair right away. */
+    send_repair(c);
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
 dropped_ipolite(struct ipolite_conn *ipolite)
 {
+  struct rudolph1_conn *c = (struct rudolph1_conn *)
+    ((char *)ipolite - offsetof(struct rudolph1_conn, ipolite));
+
   PRINTF("%d.%d: dropped ipolite\n",
 	 rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1]);
+
+  /* The packetbuf holds the packet that caused the drop, so the next
+     repair is queued by recv_ipolite() once it has been handled. */
+  c->flags &= ~(FLAG_NACK_QUEUED | FLAG_REPAIRING);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -243,19 +415,17 @@ recv_ipolite(struct ipolite_conn *ipolite, const rimeaddr_t *from)
 
   c->nacks++;
 
-  if(p->h.type == TYPE_NACK) {
+  if(p->h.type == TYPE_NACK || p->h.type == TYPE_NACK_BITMAP) {
     PRINTF("%d.%d: Got NACK for %d:%d (%d:%d)\n",
 	   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
 	   p->h.version, p->h.chunk,
 	   c->version, c->chunk);
     if(p->h.version == c->version) {
-      if(p->h.chunk < c->chunk) {
-	/* Format and send a repair packet */
-	PRINTF("%d.%d: sending repair for chunk %d\n",
-	       rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
-	       p->h.chunk);
-	format_data(c, p->h.chunk);
-	ipolite_send(&c->ipolite, REPAIR_TIMEOUT, sizeof(struct rudolph1_hdr));
+      if(p->h.type == TYPE_NACK) {
+	/* A NACK for a single chunk. */
+	add_repairs(c, PAGE_START(p->h.chunk), CHUNK_BIT(p->h.chunk));
+      } else {
+	add_repairs(c, p->h.chunk, ((struct rudolph1_nack *)p)->missing);
       }
     } else if(LT(p->h.version, c->version)) {
       format_data(c, 0);
@@ -266,8 +436,18 @@ recv_ipolite(struct ipolite_conn *ipolite, const rimeaddr_t *from)
     PRINTF("%d.%d: got repair for chunk %d\n",
 	   rimeaddr_node_addr.u8[0], rimeaddr_node_addr.u8[1],
 	   p->h.chunk);
+    if(p->h.version == c->version &&
+       PAGE_START(p->h.chunk) == c->repair_chunk) {
+      /* No need to send this repair ourselves. */
+      c->repair_set &= ~CHUNK_BIT(p->h.chunk);
+    }
     handle_data(c, p);
   }
+
+  if(!(c->flags & FLAG_REPAIRING) &&
+     (c->repair_set != 0 || (c->flags & FLAG_NACK_PENDING))) {
+    send_repair(c);
+  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -306,6 +486,8 @@ rudolph1_open(struct rudolph1_conn *c, uint16_t channel,
   ipolite_open(&c->ipolite, channel + 1, 1, &ipolite);
   c->cb = cb;
   c->version = 0;
+  c->received = c->repair_set = 0;
+  c->flags = 0;
   c->send_interval = DEFAULT_SEND_INTERVAL;
 }
 /*---------------------------------------------------------------------------*/
@@ -321,6 +503,7 @@ rudolph1_send(struct rudolph1_conn *c, clock_time_t send_interval)
 {
   c->version++;
   c->chunk = c->highest_chunk_heard = 0;
+  c->received = c->repair_set = 0;
   /*  c->trickle_interval = TRICKLE_INTERVAL;*/
   format_data(c, 0);
   trickle_send(&c->trickle);
@@ -15,6 +15,12 @@
  * The rudolph1 module uses 2 channels; one for data transmissions and
  * one for NACKs and repair packets.
  *
+ * Chunks are grouped into pages of 16 chunks. A receiver keeps the
+ * full-size chunks it hears out of order within its current page and
+ * NACKs all missing chunks of the page with a single bitmap. A
+ * neighbor holding the data answers with a pipelined sequence of
+ * repairs.
+ *
  */
 
 /*
@@ -85,9 +91,12 @@ struct rudolph1_conn {
   struct ctimer t;
   clock_time_t send_interval;
   uint16_t chunk, highest_chunk_heard;
+  uint16_t received;
+  uint16_t repair_chunk, repair_set;
   uint8_t version;
   /*  uint8_t trickle_interval;*/
   uint8_t nacks;
+  uint8_t flags;
 };
 
 void rudolph1_open(struct rudolph1_conn *c, uint16_t channel,
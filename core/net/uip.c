@@ -80,6 +80,18 @@
 		      this #ifndef removes the entire compilation
 		      output of the uip.c file */
 
+#if UIP_TCP_SEND_WINDOW > 1
+#error "UIP_CONF_TCP_SEND_WINDOW > 1 is only supported by the IPv6 stack"
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
+
+#if UIP_CONN_HASH
+#error "UIP_CONF_CONN_HASH is only supported by the IPv6 stack"
+#endif /* UIP_CONN_HASH */
+
+#if UIP_TCP_SYN_COOKIES
+#error "UIP_CONF_TCP_SYN_COOKIES is only supported by the IPv6 stack"
+#endif /* UIP_TCP_SYN_COOKIES */
+
 
 #if UIP_CONF_IPV6
 #include "net/uip-neighbor.h"
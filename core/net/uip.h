@@ -1273,6 +1273,12 @@ extern void *uip_urgdata;
  */
 CCIF extern uint16_t uip_len;
 
+/**
+ * The length of the data that the application has sent with
+ * uip_send() in the current call.
+ */
+extern uint16_t uip_slen;
+
 /**
  * The length of the extension headers
  */
@@ -1284,6 +1290,10 @@ extern uint16_t uip_urglen, uip_surglen;
 #endif /* UIP_URGDATA > 0 */
 
 
+#if UIP_TCP_SEND_WINDOW > 1
+struct uip_tcp_segment;
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
+
 /**
  * Representation of a uIP TCP connection.
  *
@@ -1305,7 +1315,8 @@ struct uip_conn {
 			 receive next. */
   uint8_t snd_nxt[4];    /**< The sequence number that was last sent by
                          us. */
-  uint16_t len;          /**< Length of the data that was previously sent. */
+  uint16_t len;          /**< Length of the data that was previously sent,
+			 or of all data in flight with a send window. */
   uint16_t mss;          /**< Current maximum segment size for the
 			 connection. */
   uint16_t initialmss;   /**< Initial maximum segment size for the
@@ -1319,6 +1330,21 @@ struct uip_conn {
   uint8_t timer;         /**< The retransmission timer. */
   uint8_t nrtx;          /**< The number of retransmissions for the last
 			 segment sent. */
+#if UIP_CONN_HASH > 0
+  struct uip_conn *hnext; /**< The next connection in the hash bucket. */
+  uint16_t hslot;        /**< The hash bucket plus one, or zero. */
+#endif /* UIP_CONN_HASH > 0 */
+#if UIP_TCP_SEND_WINDOW > 1
+  struct uip_tcp_segment *segments; /**< The segments in flight, oldest
+			 first. */
+  uint16_t snd_wnd;      /**< The window advertised by the remote host. */
+  uint16_t rtt_seq;      /**< The amount of data in flight up to the end
+			 of the segment being timed, or zero. */
+  uint8_t rtt_time;      /**< Timer pulses since the timed segment was
+			 sent. */
+  uint8_t dupacks;       /**< The number of duplicate ACKs received. */
+  uint8_t sndflags;      /**< Send window state. */
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
 
   /** The application state. */
   uip_tcp_appstate_t appstate;
@@ -1357,6 +1383,11 @@ struct uip_udp_conn {
   uint16_t lport;        /**< The local port number in network byte order. */
   uint16_t rport;        /**< The remote port number in network byte order. */
   uint8_t  ttl;          /**< Default time-to-live. */
+#if UIP_CONN_HASH > 0
+  struct uip_udp_conn *hnext; /**< The next connection in the hash
+			 bucket. */
+  uint16_t hslot;        /**< The hash bucket plus one, or zero. */
+#endif /* UIP_CONN_HASH > 0 */
 
   /** The application state. */
   uip_udp_appstate_t appstate;
@@ -1905,6 +1936,12 @@ struct uip_udp_hdr {
                                                          + IP header */
 #define UIP_LLIPH_LEN (UIP_LLH_LEN + UIP_IPH_LEN)    /* size of L2
                                                         + IP header */
+
+/* The in-flight bytes of a connection are counted in the 16-bit len
+   field of struct uip_conn. */
+#if UIP_TCP_SEND_WINDOW > 1 && UIP_TCP_SEND_WINDOW * UIP_TCP_MSS > 65535
+#error "UIP_CONF_TCP_SEND_WINDOW segments of UIP_TCP_MSS bytes must not exceed 65535 bytes"
+#endif /* UIP_TCP_SEND_WINDOW * UIP_TCP_MSS > 65535 */
 #if UIP_CONF_IPV6
 /**
  * The sums below are quite used in ND. When used for uip_buf, we
@@ -75,6 +75,8 @@
 #include "net/uip-icmp6.h"
 #include "net/uip-nd6.h"
 #include "net/uip-ds6.h"
+#include "lib/memb.h"
+#include "lib/random.h"
 
 #include <string.h>
 
@@ -207,8 +209,12 @@ struct uip_conn *uip_conn;
 
 /* Temporary variables. */
 #if (UIP_TCP || UIP_UDP)
+#if UIP_CONNS > 255 || UIP_UDP_CONNS > 255 || UIP_LISTENPORTS > 255
+static uint16_t c;
+#else
 static uint8_t c;
 #endif
+#endif
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
 /* Keeps track of the last port used for a new connection. */
@@ -254,6 +260,60 @@ static uint8_t iss[4];
 uint8_t uip_acc32[4];
 static uint8_t opt;
 static uint16_t tmp16;
+
+#if UIP_CONN_HASH > 0
+/* Active connections, hashed on their ports and remote address. */
+static struct uip_conn *tcp_hash[UIP_CONN_HASH];
+
+/* Listening ports, hashed on the port. The entries are indices into
+   uip_listenports plus one, or zero at the end of a chain. */
+#if UIP_LISTENPORTS < 255
+typedef uint8_t listen_index_t;
+#else
+typedef uint16_t listen_index_t;
+#endif
+static listen_index_t listen_hash[UIP_CONN_HASH];
+static listen_index_t listen_next[UIP_LISTENPORTS];
+#endif /* UIP_CONN_HASH > 0 */
+
+#if UIP_TCP_SEND_WINDOW > 1
+/* A segment in flight, kept for retransmission. */
+struct uip_tcp_segment {
+  struct uip_tcp_segment *next;
+  uint16_t len;
+  uint8_t data[UIP_TCP_MSS];
+};
+
+MEMB(segment_memb, struct uip_tcp_segment, UIP_TCP_SEND_BUFFERS);
+static uint8_t segments_free;
+
+/* Flags for the sndflags field of a connection. */
+#define SND_ACCEPTED 0x01 /* Data was queued, tell the application. */
+#define SND_REFUSED  0x02 /* Data did not fit, ask for it again. */
+#define SND_RECOVERY 0x04 /* Retransmitting lost segments. */
+#define SND_CLOSE    0x08 /* Send a FIN when all data is acknowledged. */
+
+/* Results of ack_segments(). */
+#define ACK_NONE 0
+#define ACK_NEW  1
+#define ACK_DUP  2
+
+/* The number of duplicate ACKs that trigger a fast retransmit. */
+#define DUPACK_THRESHOLD 3
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
+
+#if UIP_TCP_SYN_COOKIES
+/* The key of the SYN cookie hash. */
+static uint32_t cookie_key[2];
+
+/* The MSS values that a SYN cookie can encode. */
+static const uint16_t cookie_mss[8] = {
+  32, 48, 64, 128, 256, 536, 1220, 1440
+};
+
+/* A SYN cookie is valid for one to two periods of this many seconds. */
+#define COOKIE_PERIOD_SHIFT 6
+#endif /* UIP_TCP_SYN_COOKIES */
 #endif /* UIP_TCP */
 /** @} */
 
@@ -263,6 +323,11 @@ static uint16_t tmp16;
 #if UIP_UDP
 struct uip_udp_conn *uip_udp_conn;
 struct uip_udp_conn uip_udp_conns[UIP_UDP_CONNS];
+
+#if UIP_CONN_HASH > 0
+/* UDP connections, hashed on the local port. */
+static struct uip_udp_conn *udp_hash[UIP_CONN_HASH];
+#endif /* UIP_CONN_HASH > 0 */
 #endif /* UIP_UDP */
 /** @} */
 
@@ -416,6 +481,355 @@ uip_udpchksum(void)
 #endif /* UIP_UDP && UIP_UDP_CHECKSUMS */
 #endif /* UIP_ARCH_CHKSUM */
 /*---------------------------------------------------------------------------*/
+#if (UIP_TCP || UIP_UDP) && UIP_CONN_HASH > 0
+static uint16_t
+port_hash(uint16_t port)
+{
+  return (port ^ (port >> 8)) % UIP_CONN_HASH;
+}
+#endif /* (UIP_TCP || UIP_UDP) && UIP_CONN_HASH > 0 */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_CONN_HASH > 0
+static uint16_t
+tcp_conn_hash(uint16_t lport, uint16_t rport, const uip_ipaddr_t *ripaddr)
+{
+  uint16_t h;
+  uint8_t i;
+
+  h = lport ^ rport;
+  for(i = 0; i < 8; ++i) {
+    h = ((h << 5) | (h >> 11)) ^ ripaddr->u16[i];
+  }
+  return h % UIP_CONN_HASH;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tcp_hash_insert(struct uip_conn *conn)
+{
+  struct uip_conn **p;
+  uint16_t h;
+
+  /* A reused connection may still be in the bucket of its old
+     address. */
+  if(conn->hslot != 0) {
+    for(p = &tcp_hash[conn->hslot - 1]; *p != conn; p = &(*p)->hnext);
+    *p = conn->hnext;
+  }
+
+  h = tcp_conn_hash(conn->lport, conn->rport, &conn->ripaddr);
+  conn->hnext = tcp_hash[h];
+  tcp_hash[h] = conn;
+  conn->hslot = h + 1;
+}
+#endif /* UIP_TCP && UIP_CONN_HASH > 0 */
+/*---------------------------------------------------------------------------*/
+#if UIP_UDP && UIP_CONN_HASH > 0
+static void
+udp_hash_insert(struct uip_udp_conn *conn)
+{
+  struct uip_udp_conn **p;
+  uint16_t h;
+
+  if(conn->hslot != 0) {
+    for(p = &udp_hash[conn->hslot - 1]; *p != conn; p = &(*p)->hnext);
+    *p = conn->hnext;
+  }
+
+  h = port_hash(conn->lport);
+  conn->hnext = udp_hash[h];
+  udp_hash[h] = conn;
+  conn->hslot = h + 1;
+}
+#endif /* UIP_UDP && UIP_CONN_HASH > 0 */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP
+static void
+rtt_estimate(struct uip_conn *conn, signed char m)
+{
+  /* This is taken directly from VJs original code in his paper */
+  m = m - (conn->sa >> 3);
+  conn->sa += m;
+  if(m < 0) {
+    m = -m;
+  }
+  m = m - (conn->sv >> 2);
+  conn->sv += m;
+  conn->rto = (conn->sa >> 3) + conn->sv;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+seqno32(const uint8_t *seqno)
+{
+  return ((uint32_t)seqno[0] << 24) | ((uint32_t)seqno[1] << 16) |
+    ((uint32_t)seqno[2] << 8) | seqno[3];
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+tcp_listening(uint16_t port)
+{
+#if UIP_CONN_HASH > 0
+  listen_index_t i;
+
+  for(i = listen_hash[port_hash(port)]; i != 0; i = listen_next[i - 1]) {
+    if(port == uip_listenports[i - 1]) {
+      return 1;
+    }
+  }
+#else /* UIP_CONN_HASH > 0 */
+  uint16_t i;
+
+  for(i = 0; i < UIP_LISTENPORTS; ++i) {
+    if(port == uip_listenports[i]) {
+      return 1;
+    }
+  }
+#endif /* UIP_CONN_HASH > 0 */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct uip_conn *
+tcp_conn_unused(void)
+{
+  struct uip_conn *conn;
+
+  /* Unused connections are kept in the same table as used
+     connections, but unused ones have the tcpstate set to
+     CLOSED. Also, connections in TIME_WAIT are kept track of and we'll
+     use the oldest one if no CLOSED connections are found. Thanks to
+     Eddie C. Dost for a very nice algorithm for the TIME_WAIT
+     search. */
+  conn = 0;
+  for(c = 0; c < UIP_CONNS; ++c) {
+    if(uip_conns[c].tcpstateflags == UIP_CLOSED) {
+      return &uip_conns[c];
+    }
+    if(uip_conns[c].tcpstateflags == UIP_TIME_WAIT) {
+      if(conn == 0 ||
+         uip_conns[c].timer > conn->timer) {
+        conn = &uip_conns[c];
+      }
+    }
+  }
+  return conn;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the MSS option of the incoming segment, or zero if it has
+   none. */
+static uint16_t
+tcp_mss_option(void)
+{
+  if((UIP_TCP_BUF->tcpoffset & 0xf0) > 0x50) {
+    for(c = 0; c < ((UIP_TCP_BUF->tcpoffset >> 4) - 5) << 2 ;) {
+      opt = uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + c];
+      if(opt == TCP_OPT_END) {
+        /* End of options. */
+        break;
+      } else if(opt == TCP_OPT_NOOP) {
+        ++c;
+        /* NOP option. */
+      } else if(opt == TCP_OPT_MSS &&
+                uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == TCP_OPT_MSS_LEN) {
+        /* An MSS option with the right option length. */
+        return ((uint16_t)uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 2 + c] << 8) |
+          (uint16_t)uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 3 + c];
+      } else {
+        /* All other options have a length field, so that we easily
+           can skip past them. */
+        if(uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == 0) {
+          /* If the length field is zero, the options are malformed
+             and we don't process them further. */
+          break;
+        }
+        c += uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c];
+      }
+    }
+  }
+  return 0;
+}
+#endif /* UIP_TCP */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_TCP_SYN_COOKIES
+static uint32_t
+cookie_mix(uint32_t h)
+{
+  h ^= h >> 16;
+  h *= 0x7feb352dUL;
+  h ^= h >> 15;
+  h *= 0x846ca68bUL;
+  h ^= h >> 16;
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+/* Computes the SYN cookie for the incoming segment, given the initial
+   sequence number of the peer and the period and MSS to encode. The
+   period and MSS are kept in the top eight bits of the cookie. */
+static uint32_t
+syn_cookie(uint32_t isn, uint8_t tag)
+{
+  uint32_t h;
+  uint8_t i;
+
+  h = cookie_key[0] ^ tag;
+  for(i = 0; i < 8; ++i) {
+    h = cookie_mix(h ^ UIP_IP_BUF->srcipaddr.u16[i]);
+  }
+  h = cookie_mix(h ^ ((uint32_t)UIP_TCP_BUF->srcport << 16) ^
+                 UIP_TCP_BUF->destport);
+  h = cookie_mix(h ^ isn ^ cookie_key[1]);
+  return ((uint32_t)tag << 24) | (h & 0xffffffUL);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+cookie_period(void)
+{
+  return (clock_seconds() >> COOKIE_PERIOD_SHIFT) & 0x1f;
+}
+#endif /* UIP_TCP && UIP_TCP_SYN_COOKIES */
+/*---------------------------------------------------------------------------*/
+#if UIP_TCP && UIP_TCP_SEND_WINDOW > 1
+static void
+drop_segments(struct uip_conn *conn)
+{
+  struct uip_tcp_segment *s;
+  uint16_t len;
+
+  /* Consider all data in flight as sent, so that a reset carries the
+     highest sequence number we have used. */
+  len = 0;
+  while(conn->segments != NULL) {
+    s = conn->segments;
+    conn->segments = s->next;
+    len += s->len;
+    memb_free(&segment_memb, s);
+    ++segments_free;
+  }
+  if(len > 0) {
+    uip_add32(conn->snd_nxt, len);
+    memcpy(conn->snd_nxt, uip_acc32, 4);
+    conn->len -= len;
+  }
+  conn->sndflags = 0;
+  conn->dupacks = 0;
+  conn->rtt_seq = 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+send_window_open(struct uip_conn *conn)
+{
+  struct uip_tcp_segment *s;
+  uint8_t n;
+
+  if((conn->sndflags & SND_CLOSE) || segments_free == 0) {
+    return 0;
+  }
+  n = 0;
+  for(s = conn->segments; s != NULL; s = s->next) {
+    ++n;
+  }
+  if(n >= UIP_TCP_SEND_WINDOW) {
+    return 0;
+  }
+
+  /* Only send a full segment into the advertised window. With nothing
+     in flight, a segment is sent regardless of the window so that a
+     zero window is probed by the retransmission timer. */
+  return conn->len == 0 ||
+    (uint32_t)conn->len + conn->mss <= conn->snd_wnd;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_segment(struct uip_conn *conn)
+{
+  struct uip_tcp_segment *s, **tail;
+
+  s = memb_alloc(&segment_memb);
+  --segments_free;
+  s->next = NULL;
+  s->len = uip_slen;
+  memcpy(s->data, uip_sappdata, uip_slen);
+  for(tail = &conn->segments; *tail != NULL; tail = &(*tail)->next);
+  *tail = s;
+
+  if(conn->len == 0) {
+    conn->timer = conn->rto;
+  }
+  conn->len += uip_slen;
+
+  /* Time one segment per round trip. */
+  if(conn->rtt_seq == 0) {
+    conn->rtt_seq = conn->len;
+    conn->rtt_time = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+ack_segments(struct uip_conn *conn)
+{
+  struct uip_tcp_segment *s;
+  uint32_t acked;
+  uint16_t len;
+
+  acked = seqno32(UIP_TCP_BUF->ackno) - seqno32(conn->snd_nxt);
+  if(acked == 0) {
+    /* An ACK that carries nothing new while data is in flight
+       indicates that the peer has received a later segment. */
+    if(conn->len > 0 && uip_len == 0 &&
+       (UIP_TCP_BUF->flags & (TCP_SYN | TCP_FIN)) == 0 &&
+       (((uint16_t)UIP_TCP_BUF->wnd[0] << 8) | UIP_TCP_BUF->wnd[1]) ==
+       conn->snd_wnd) {
+      if(conn->dupacks < 255) {
+        ++conn->dupacks;
+      }
+      return ACK_DUP;
+    }
+    return ACK_NONE;
+  }
+  if(acked > conn->len) {
+    return ACK_NONE;
+  }
+
+  uip_add32(conn->snd_nxt, (uint16_t)acked);
+  memcpy(conn->snd_nxt, uip_acc32, 4);
+  conn->len -= acked;
+
+  /* Free the acknowledged segments, and trim a partially acknowledged
+     one. */
+  len = acked;
+  while(len > 0) {
+    s = conn->segments;
+    if(s->len <= len) {
+      len -= s->len;
+      conn->segments = s->next;
+      memb_free(&segment_memb, s);
+      ++segments_free;
+    } else {
+      s->len -= len;
+      memmove(s->data, s->data + len, s->len);
+      len = 0;
+    }
+  }
+
+  /* Do RTT estimation if the timed segment was acknowledged. The
+     timing is abandoned whenever we retransmit. */
+  if(conn->rtt_seq != 0) {
+    if(acked >= conn->rtt_seq) {
+      rtt_estimate(conn, conn->rtt_time);
+      conn->rtt_seq = 0;
+    } else {
+      conn->rtt_seq -= acked;
+    }
+  }
+
+  conn->timer = conn->rto;
+  conn->nrtx = 0;
+  conn->dupacks = 0;
+  if(conn->len == 0) {
+    conn->sndflags &= ~SND_RECOVERY;
+  }
+  return ACK_NEW;
+}
+#endif /* UIP_TCP && UIP_TCP_SEND_WINDOW > 1 */
+/*---------------------------------------------------------------------------*/
 void
 uip_init(void)
 {
@@ -428,7 +842,22 @@ uip_init(void)
   }
   for(c = 0; c < UIP_CONNS; ++c) {
     uip_conns[c].tcpstateflags = UIP_CLOSED;
+#if UIP_CONN_HASH > 0
+    uip_conns[c].hslot = 0;
+#endif /* UIP_CONN_HASH > 0 */
   }
+#if UIP_CONN_HASH > 0
+  memset(tcp_hash, 0, sizeof(tcp_hash));
+  memset(listen_hash, 0, sizeof(listen_hash));
+#endif /* UIP_CONN_HASH > 0 */
+#if UIP_TCP_SYN_COOKIES
+  cookie_key[0] = ((uint32_t)random_rand() << 16) ^ random_rand();
+  cookie_key[1] = ((uint32_t)random_rand() << 16) ^ random_rand();
+#endif /* UIP_TCP_SYN_COOKIES */
+#if UIP_TCP_SEND_WINDOW > 1
+  memb_init(&segment_memb);
+  segments_free = UIP_TCP_SEND_BUFFERS;
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
 #endif /* UIP_TCP */
 
 #if UIP_ACTIVE_OPEN || UIP_UDP
@@ -438,7 +867,13 @@ uip_init(void)
 #if UIP_UDP
   for(c = 0; c < UIP_UDP_CONNS; ++c) {
     uip_udp_conns[c].lport = 0;
+#if UIP_CONN_HASH > 0
+    uip_udp_conns[c].hslot = 0;
+#endif /* UIP_CONN_HASH > 0 */
   }
+#if UIP_CONN_HASH > 0
+  memset(udp_hash, 0, sizeof(udp_hash));
+#endif /* UIP_CONN_HASH > 0 */
 #endif /* UIP_UDP */
 }
 /*---------------------------------------------------------------------------*/
@@ -484,6 +919,11 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   if(conn == 0) {
     return 0;
   }
+
+#if UIP_TCP_SEND_WINDOW > 1
+  /* Reclaim segments of a connection that was closed under our feet. */
+  drop_segments(conn);
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
   
   conn->tcpstateflags = UIP_SYN_SENT;
 
@@ -508,6 +948,9 @@ uip_connect(uip_ipaddr_t *ripaddr, uint16_t rport)
   conn->lport = uip_htons(lastport);
   conn->rport = rport;
   uip_ipaddr_copy(&conn->ripaddr, ripaddr);
+#if UIP_CONN_HASH > 0
+  tcp_hash_insert(conn);
+#endif /* UIP_CONN_HASH > 0 */
   
   return conn;
 }
@@ -579,6 +1022,9 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
     uip_ipaddr_copy(&conn->ripaddr, ripaddr);
   }
   conn->ttl = uip_ds6_if.cur_hop_limit;
+#if UIP_CONN_HASH > 0
+  udp_hash_insert(conn);
+#endif /* UIP_CONN_HASH > 0 */
   
   return conn;
 }
@@ -588,12 +1034,24 @@ uip_udp_new(const uip_ipaddr_t *ripaddr, uint16_t rport)
 void
 uip_unlisten(uint16_t port)
 {
+#if UIP_CONN_HASH > 0
+  listen_index_t *p;
+
+  for(p = &listen_hash[port_hash(port)]; *p != 0; p = &listen_next[*p - 1]) {
+    if(uip_listenports[*p - 1] == port) {
+      uip_listenports[*p - 1] = 0;
+      *p = listen_next[*p - 1];
+      return;
+    }
+  }
+#else /* UIP_CONN_HASH > 0 */
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(uip_listenports[c] == port) {
       uip_listenports[c] = 0;
       return;
     }
   }
+#endif /* UIP_CONN_HASH > 0 */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -602,6 +1060,10 @@ uip_listen(uint16_t port)
   for(c = 0; c < UIP_LISTENPORTS; ++c) {
     if(uip_listenports[c] == 0) {
       uip_listenports[c] = port;
+#if UIP_CONN_HASH > 0
+      listen_next[c] = listen_hash[port_hash(port)];
+      listen_hash[port_hash(port)] = c + 1;
+#endif /* UIP_CONN_HASH > 0 */
       return;
     }
   }
@@ -927,6 +1389,10 @@ uip_process(uint8_t flag)
 {
 #if UIP_TCP
   register struct uip_conn *uip_connr = uip_conn;
+#if UIP_TCP_SEND_WINDOW > 1
+  uint8_t ackstate = ACK_NONE;
+  uint8_t rexmit = 0;
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
 #endif /* UIP_TCP */
 #if UIP_UDP
   if(flag == UIP_UDP_SEND_CONN) {
@@ -939,6 +1405,15 @@ uip_process(uint8_t flag)
      particular connection. */
   if(flag == UIP_POLL_REQUEST) {
 #if UIP_TCP
+#if UIP_TCP_SEND_WINDOW > 1
+    /* With a send window, the application may be polled while data is
+       in flight. */
+    if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+      uip_len = uip_slen = 0;
+      uip_flags = UIP_POLL;
+      goto appwindow;
+    }
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
     if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
        !uip_outstanding(uip_connr)) {
       uip_flags = UIP_POLL;
@@ -988,12 +1463,20 @@ uip_process(uint8_t flag)
        * in which case we retransmit.
        */
       if(uip_outstanding(uip_connr)) {
+#if UIP_TCP_SEND_WINDOW > 1
+        if(uip_connr->rtt_seq != 0 && uip_connr->rtt_time < 127) {
+          ++(uip_connr->rtt_time);
+        }
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
         if(uip_connr->timer-- == 0) {
           if(uip_connr->nrtx == UIP_MAXRTX ||
              ((uip_connr->tcpstateflags == UIP_SYN_SENT ||
                uip_connr->tcpstateflags == UIP_SYN_RCVD) &&
               uip_connr->nrtx == UIP_MAXSYNRTX)) {
             uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_SEND_WINDOW > 1
+            drop_segments(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
                   
             /*
              * We call UIP_APPCALL() with uip_flags set to
@@ -1036,6 +1519,16 @@ uip_process(uint8_t flag)
 #endif /* UIP_ACTIVE_OPEN */
                      
             case UIP_ESTABLISHED:
+#if UIP_TCP_SEND_WINDOW > 1
+              /*
+               * With a send window, we retransmit the oldest segment
+               * ourselves and then the remaining ones as the peer
+               * acknowledges the retransmissions.
+               */
+              uip_connr->sndflags |= SND_RECOVERY;
+              uip_connr->rtt_seq = 0;
+              goto tcp_rexmit_segment;
+#else /* UIP_TCP_SEND_WINDOW > 1 */
               /*
                * In the ESTABLISHED state, we call upon the application
                * to do the actual retransmit after which we jump into
@@ -1045,6 +1538,7 @@ uip_process(uint8_t flag)
               uip_flags = UIP_REXMIT;
               UIP_APPCALL();
               goto apprexmit;
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
                      
             case UIP_FIN_WAIT_1:
             case UIP_CLOSING:
@@ -1053,6 +1547,18 @@ uip_process(uint8_t flag)
               goto tcp_send_finack;
           }
         }
+#if UIP_TCP_SEND_WINDOW > 1
+      }
+      if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+        /*
+         * If there was no need for a retransmission, we poll the
+         * application for new data, which may fit in the window even
+         * if there is data in flight.
+         */
+        uip_flags = UIP_POLL;
+        goto appwindow;
+      }
+#else /* UIP_TCP_SEND_WINDOW > 1 */
       } else if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
         /*
          * If there was no need for a retransmission, we poll the
@@ -1062,6 +1568,7 @@ uip_process(uint8_t flag)
         UIP_APPCALL();
         goto appsend;
       }
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
     }
     goto drop;
 #endif /* UIP_TCP */
@@ -1510,6 +2017,33 @@ uip_process(uint8_t flag)
   }
 
   /* Demultiplex this UDP packet between the UDP "connections". */
+#if UIP_CONN_HASH > 0
+  {
+    struct uip_udp_conn **p;
+    uint16_t h;
+
+    /* Look in the bucket of the port first, dropping connections that
+       have been removed or rebound since they were hashed. */
+    h = port_hash(UIP_UDP_BUF->destport);
+    for(p = &udp_hash[h]; (uip_udp_conn = *p) != NULL;) {
+      if(uip_udp_conn->lport == 0 || port_hash(uip_udp_conn->lport) != h) {
+        *p = uip_udp_conn->hnext;
+        uip_udp_conn->hslot = 0;
+        continue;
+      }
+      if(UIP_UDP_BUF->destport == uip_udp_conn->lport &&
+         (uip_udp_conn->rport == 0 ||
+          UIP_UDP_BUF->srcport == uip_udp_conn->rport) &&
+         (uip_is_addr_unspecified(&uip_udp_conn->ripaddr) ||
+          uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_udp_conn->ripaddr))) {
+        goto udp_found;
+      }
+      p = &uip_udp_conn->hnext;
+    }
+  }
+  /* Connections bound with uip_udp_bind() are only hashed once they
+     have been found by the scan below. */
+#endif /* UIP_CONN_HASH > 0 */
    for(uip_udp_conn = &uip_udp_conns[0];
       uip_udp_conn < &uip_udp_conns[UIP_UDP_CONNS];
       ++uip_udp_conn) {
@@ -1526,6 +2060,9 @@ uip_process(uint8_t flag)
         UIP_UDP_BUF->srcport == uip_udp_conn->rport) &&
        (uip_is_addr_unspecified(&uip_udp_conn->ripaddr) ||
         uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_udp_conn->ripaddr))) {
+#if UIP_CONN_HASH > 0
+      udp_hash_insert(uip_udp_conn);
+#endif /* UIP_CONN_HASH > 0 */
       goto udp_found;
     }
   }
@@ -1619,6 +2156,29 @@ uip_process(uint8_t flag)
 
   /* Demultiplex this segment. */
   /* First check any active connections. */
+#if UIP_CONN_HASH > 0
+  {
+    struct uip_conn **p;
+
+    /* Connections are hashed when they are opened. Closed ones are
+       dropped from their bucket as we come across them. */
+    p = &tcp_hash[tcp_conn_hash(UIP_TCP_BUF->destport, UIP_TCP_BUF->srcport,
+                                &UIP_IP_BUF->srcipaddr)];
+    while((uip_connr = *p) != NULL) {
+      if(uip_connr->tcpstateflags == UIP_CLOSED) {
+        *p = uip_connr->hnext;
+        uip_connr->hslot = 0;
+        continue;
+      }
+      if(UIP_TCP_BUF->destport == uip_connr->lport &&
+         UIP_TCP_BUF->srcport == uip_connr->rport &&
+         uip_ipaddr_cmp(&UIP_IP_BUF->srcipaddr, &uip_connr->ripaddr)) {
+        goto found;
+      }
+      p = &uip_connr->hnext;
+    }
+  }
+#else /* UIP_CONN_HASH > 0 */
   for(uip_connr = &uip_conns[0]; uip_connr <= &uip_conns[UIP_CONNS - 1];
       ++uip_connr) {
     if(uip_connr->tcpstateflags != UIP_CLOSED &&
@@ -1628,21 +2188,27 @@ uip_process(uint8_t flag)
       goto found;
     }
   }
+#endif /* UIP_CONN_HASH > 0 */
 
   /* If we didn't find and active connection that expected the packet,
      either this packet is an old duplicate, or this is a SYN packet
      destined for a connection in LISTEN. If the SYN flag isn't set,
      it is an old packet and we send a RST. */
   if((UIP_TCP_BUF->flags & TCP_CTL) != TCP_SYN) {
+#if UIP_TCP_SYN_COOKIES
+    /* With SYN cookies, the first ACK from the peer creates the
+       connection. */
+    if((UIP_TCP_BUF->flags & (TCP_SYN | TCP_RST | TCP_ACK)) == TCP_ACK &&
+       tcp_listening(UIP_TCP_BUF->destport)) {
+      goto found_cookie;
+    }
+#endif /* UIP_TCP_SYN_COOKIES */
     goto reset;
   }
   
-  tmp16 = UIP_TCP_BUF->destport;
   /* Next, check listening connections. */
-  for(c = 0; c < UIP_LISTENPORTS; ++c) {
-    if(tmp16 == uip_listenports[c]) {
-      goto found_listen;
-    }
+  if(tcp_listening(UIP_TCP_BUF->destport)) {
+    goto found_listen;
   }
   
   /* No matching connection found, so we send a RST packet. */
@@ -1705,26 +2271,110 @@ uip_process(uint8_t flag)
      connection and send a SYNACK in return. */
  found_listen:
   PRINTF("In found listen\n");
-  /* First we check if there are any connections avaliable. Unused
-     connections are kept in the same table as used connections, but
-     unused ones have the tcpstate set to CLOSED. Also, connections in
-     TIME_WAIT are kept track of and we'll use the oldest one if no
-     CLOSED connections are found. Thanks to Eddie C. Dost for a very
-     nice algorithm for the TIME_WAIT search. */
-  uip_connr = 0;
-  for(c = 0; c < UIP_CONNS; ++c) {
-    if(uip_conns[c].tcpstateflags == UIP_CLOSED) {
-      uip_connr = &uip_conns[c];
-      break;
-    }
-    if(uip_conns[c].tcpstateflags == UIP_TIME_WAIT) {
-      if(uip_connr == 0 ||
-         uip_conns[c].timer > uip_connr->timer) {
-        uip_connr = &uip_conns[c];
-      }
+#if UIP_TCP_SYN_COOKIES
+  /* With SYN cookies, we send the SYNACK without allocating a
+     connection. The MSS of the peer is encoded in the top bits of our
+     initial sequence number, along with the time period. */
+  tmp16 = tcp_mss_option();
+  if(tmp16 == 0 || tmp16 > UIP_TCP_MSS) {
+    tmp16 = UIP_TCP_MSS;
+  }
+  for(c = 7; c > 0 && cookie_mss[c] > tmp16; --c);
+  uip_add32(UIP_TCP_BUF->seqno, 1);
+  {
+    uint32_t cookie;
+
+    cookie = syn_cookie(seqno32(uip_acc32), (cookie_period() << 3) | c);
+    UIP_TCP_BUF->seqno[0] = cookie >> 24;
+    UIP_TCP_BUF->seqno[1] = cookie >> 16;
+    UIP_TCP_BUF->seqno[2] = cookie >> 8;
+    UIP_TCP_BUF->seqno[3] = cookie;
+  }
+  memcpy(UIP_TCP_BUF->ackno, uip_acc32, 4);
+
+  /* Swap port numbers. */
+  tmp16 = UIP_TCP_BUF->srcport;
+  UIP_TCP_BUF->srcport = UIP_TCP_BUF->destport;
+  UIP_TCP_BUF->destport = tmp16;
+
+  /* Swap IP addresses. */
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &UIP_IP_BUF->srcipaddr);
+  uip_ds6_select_src(&UIP_IP_BUF->srcipaddr, &UIP_IP_BUF->destipaddr);
+
+  UIP_TCP_BUF->flags = TCP_SYN | TCP_ACK;
+  UIP_TCP_BUF->optdata[0] = TCP_OPT_MSS;
+  UIP_TCP_BUF->optdata[1] = TCP_OPT_MSS_LEN;
+  UIP_TCP_BUF->optdata[2] = (UIP_TCP_MSS) / 256;
+  UIP_TCP_BUF->optdata[3] = (UIP_TCP_MSS) & 255;
+  uip_len = UIP_IPTCPH_LEN + TCP_OPT_MSS_LEN;
+  UIP_TCP_BUF->tcpoffset = ((UIP_TCPH_LEN + TCP_OPT_MSS_LEN) / 4) << 4;
+  UIP_TCP_BUF->wnd[0] = ((UIP_RECEIVE_WINDOW) >> 8);
+  UIP_TCP_BUF->wnd[1] = ((UIP_RECEIVE_WINDOW) & 0xff);
+  goto tcp_send_noconn;
+
+  /* This label will be jumped to if an ACK arrives on a listening
+     port. If it acknowledges a SYNACK that we sent with a valid
+     cookie, we create the connection in the SYN_RCVD state and
+     process the ACK as if the connection had existed all along. */
+ found_cookie:
+  {
+    uint32_t cookie;
+    uint8_t period;
+
+    cookie = seqno32(UIP_TCP_BUF->ackno) - 1;
+    period = cookie >> 27;
+    if(((cookie_period() - period) & 0x1f) > 1 ||
+       syn_cookie(seqno32(UIP_TCP_BUF->seqno), cookie >> 24) != cookie) {
+      /* Not one of our cookies, or one that is too old. */
+      goto reset;
     }
+    tmp16 = cookie_mss[(cookie >> 24) & 7];
   }
 
+  uip_connr = tcp_conn_unused();
+  if(uip_connr == 0) {
+    /* Our SYNACK is gone with the cookie, so we reset the connection
+       rather than leaving the peer with a connection that we do not
+       know about. */
+    UIP_STAT(++uip_stat.tcp.syndrop);
+    UIP_LOG("tcp: found no unused connections.");
+    goto reset;
+  }
+
+#if UIP_TCP_SEND_WINDOW > 1
+  drop_segments(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
+
+  uip_connr->rto = uip_connr->timer = UIP_RTO;
+  uip_connr->sa = 0;
+  uip_connr->sv = 4;
+  uip_connr->nrtx = 0;
+  uip_connr->lport = UIP_TCP_BUF->destport;
+  uip_connr->rport = UIP_TCP_BUF->srcport;
+  uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
+  uip_connr->tcpstateflags = UIP_SYN_RCVD;
+#if UIP_CONN_HASH > 0
+  tcp_hash_insert(uip_connr);
+#endif /* UIP_CONN_HASH > 0 */
+
+  /* Our SYN took the sequence number just before the one that the
+     peer acknowledges, and is now outstanding. */
+  {
+    uint32_t iss32;
+
+    iss32 = seqno32(UIP_TCP_BUF->ackno) - 1;
+    uip_connr->snd_nxt[0] = iss32 >> 24;
+    uip_connr->snd_nxt[1] = iss32 >> 16;
+    uip_connr->snd_nxt[2] = iss32 >> 8;
+    uip_connr->snd_nxt[3] = iss32;
+  }
+  uip_connr->len = 1;
+  memcpy(uip_connr->rcv_nxt, UIP_TCP_BUF->seqno, 4);
+  uip_connr->initialmss = uip_connr->mss =
+    tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
+  goto found;
+#else /* UIP_TCP_SYN_COOKIES */
+  uip_connr = tcp_conn_unused();
   if(uip_connr == 0) {
     /* All connections are used already, we drop packet and hope that
        the remote end will retransmit the packet at a time when we
@@ -1734,6 +2384,10 @@ uip_process(uint8_t flag)
     goto drop;
   }
   uip_conn = uip_connr;
+
+#if UIP_TCP_SEND_WINDOW > 1
+  drop_segments(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
   
   /* Fill in the necessary fields for the new connection. */
   uip_connr->rto = uip_connr->timer = UIP_RTO;
@@ -1744,6 +2398,9 @@ uip_process(uint8_t flag)
   uip_connr->rport = UIP_TCP_BUF->srcport;
   uip_ipaddr_copy(&uip_connr->ripaddr, &UIP_IP_BUF->srcipaddr);
   uip_connr->tcpstateflags = UIP_SYN_RCVD;
+#if UIP_CONN_HASH > 0
+  tcp_hash_insert(uip_connr);
+#endif /* UIP_CONN_HASH > 0 */
 
   uip_connr->snd_nxt[0] = iss[0];
   uip_connr->snd_nxt[1] = iss[1];
@@ -1759,37 +2416,10 @@ uip_process(uint8_t flag)
   uip_add_rcv_nxt(1);
 
   /* Parse the TCP MSS option, if present. */
-  if((UIP_TCP_BUF->tcpoffset & 0xf0) > 0x50) {
-    for(c = 0; c < ((UIP_TCP_BUF->tcpoffset >> 4) - 5) << 2 ;) {
-      opt = uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + c];
-      if(opt == TCP_OPT_END) {
-        /* End of options. */
-        break;
-      } else if(opt == TCP_OPT_NOOP) {
-        ++c;
-        /* NOP option. */
-      } else if(opt == TCP_OPT_MSS &&
-                uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == TCP_OPT_MSS_LEN) {
-        /* An MSS option with the right option length. */
-        tmp16 = ((uint16_t)uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 2 + c] << 8) |
-          (uint16_t)uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN + 3 + c];
-        uip_connr->initialmss = uip_connr->mss =
-          tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
-   
-        /* And we are done processing options. */
-        break;
-      } else {
-        /* All other options have a length field, so that we easily
-           can skip past them. */
-        if(uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == 0) {
-          /* If the length field is zero, the options are malformed
-             and we don't process them further. */
-          break;
-        }
-        c += uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c];
-      }
-    }
-  }
+  tmp16 = tcp_mss_option();
+  uip_connr->initialmss = uip_connr->mss =
+    tmp16 == 0 || tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
+#endif /* UIP_TCP_SYN_COOKIES */
   
   /* Our response will be a SYNACK. */
 #if UIP_ACTIVE_OPEN
@@ -1824,11 +2454,26 @@ uip_process(uint8_t flag)
      before we accept the reset. */
   if(UIP_TCP_BUF->flags & TCP_RST) {
     uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_SEND_WINDOW > 1
+    drop_segments(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
     UIP_LOG("tcp: got reset, aborting connection.");
     uip_flags = UIP_ABORT;
     UIP_APPCALL();
     goto drop;
   }
+  /* A SYN for a connection in TIME_WAIT is accepted as a new
+     connection if its sequence number is beyond the old connection
+     (RFC 1122, 4.2.2.13), so that a client that reconnects with the
+     same port does not have to wait for TIME_WAIT to expire. */
+  if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_TIME_WAIT &&
+     (UIP_TCP_BUF->flags & TCP_CTL) == TCP_SYN &&
+     (int32_t)(seqno32(UIP_TCP_BUF->seqno) -
+               seqno32(uip_connr->rcv_nxt)) > 0 &&
+     tcp_listening(UIP_TCP_BUF->destport)) {
+    uip_connr->tcpstateflags = UIP_CLOSED;
+    goto found_listen;
+  }
   /* Calculate the length of the data, if the application has sent
      any data to us. */
   c = (UIP_TCP_BUF->tcpoffset >> 4) << 2;
@@ -1863,6 +2508,15 @@ uip_process(uint8_t flag)
      data. If so, we update the sequence number, reset the length of
      the outstanding data, calculate RTT estimations, and reset the
      retransmission timer. */
+#if UIP_TCP_SEND_WINDOW > 1
+  if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED) {
+    /* With a send window, the ACK may cover any part of the data in
+       flight. */
+    if(UIP_TCP_BUF->flags & TCP_ACK) {
+      ackstate = ack_segments(uip_connr);
+    }
+  } else
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
   if((UIP_TCP_BUF->flags & TCP_ACK) && uip_outstanding(uip_connr)) {
     uip_add32(uip_connr->snd_nxt, uip_connr->len);
 
@@ -1878,18 +2532,7 @@ uip_process(uint8_t flag)
    
       /* Do RTT estimation, unless we have done retransmissions. */
       if(uip_connr->nrtx == 0) {
-        signed char m;
-        m = uip_connr->rto - uip_connr->timer;
-        /* This is taken directly from VJs original code in his paper */
-        m = m - (uip_connr->sa >> 3);
-        uip_connr->sa += m;
-        if(m < 0) {
-          m = -m;
-        }
-        m = m - (uip_connr->sv >> 2);
-        uip_connr->sv += m;
-        uip_connr->rto = (uip_connr->sa >> 3) + uip_connr->sv;
-
+        rtt_estimate(uip_connr, uip_connr->rto - uip_connr->timer);
       }
       /* Set the acknowledged flag. */
       uip_flags = UIP_ACKDATA;
@@ -1901,6 +2544,13 @@ uip_process(uint8_t flag)
     }
     
   }
+#if UIP_TCP_SEND_WINDOW > 1
+  /* Remember the window advertised by the peer. */
+  if(UIP_TCP_BUF->flags & TCP_ACK) {
+    uip_connr->snd_wnd = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) +
+      UIP_TCP_BUF->wnd[1];
+  }
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
 
   /* Do different things depending on in what state the connection is. */
   switch(uip_connr->tcpstateflags & UIP_TS_MASK) {
@@ -1940,36 +2590,10 @@ uip_process(uint8_t flag)
          (UIP_TCP_BUF->flags & TCP_CTL) == (TCP_SYN | TCP_ACK)) {
 
         /* Parse the TCP MSS option, if present. */
-        if((UIP_TCP_BUF->tcpoffset & 0xf0) > 0x50) {
-          for(c = 0; c < ((UIP_TCP_BUF->tcpoffset >> 4) - 5) << 2 ;) {
-            opt = uip_buf[UIP_IPTCPH_LEN + UIP_LLH_LEN + c];
-            if(opt == TCP_OPT_END) {
-              /* End of options. */
-              break;
-            } else if(opt == TCP_OPT_NOOP) {
-              ++c;
-              /* NOP option. */
-            } else if(opt == TCP_OPT_MSS &&
-                      uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == TCP_OPT_MSS_LEN) {
-              /* An MSS option with the right option length. */
-              tmp16 = (uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 2 + c] << 8) |
-                uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 3 + c];
-              uip_connr->initialmss =
-                uip_connr->mss = tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
-
-              /* And we are done processing options. */
-              break;
-            } else {
-              /* All other options have a length field, so that we easily
-                 can skip past them. */
-              if(uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c] == 0) {
-                /* If the length field is zero, the options are malformed
-                   and we don't process them further. */
-                break;
-              }
-              c += uip_buf[UIP_TCPIP_HLEN + UIP_LLH_LEN + 1 + c];
-            }
-          }
+        tmp16 = tcp_mss_option();
+        if(tmp16 != 0) {
+          uip_connr->initialmss =
+            uip_connr->mss = tmp16 > UIP_TCP_MSS? UIP_TCP_MSS: tmp16;
         }
         uip_connr->tcpstateflags = UIP_ESTABLISHED;
         uip_connr->rcv_nxt[0] = UIP_TCP_BUF->seqno[0];
@@ -2065,12 +2689,49 @@ uip_process(uint8_t flag)
          and the application will retransmit it. This is called the
          "persistent timer" and uses the retransmission mechanim.
       */
+#if UIP_TCP_SEND_WINDOW > 1
+      /* With a send window, the MSS stays at the initial MSS and the
+         window is instead checked before data is queued, so that
+         uip_mss() is the same when data is acknowledged as when it
+         was sent. */
+      if(ackstate == ACK_DUP && uip_connr->dupacks == DUPACK_THRESHOLD) {
+        /* Fast retransmit. */
+        uip_connr->sndflags |= SND_RECOVERY;
+        uip_connr->rtt_seq = 0;
+        UIP_STAT(++uip_stat.tcp.rexmit);
+        goto tcp_rexmit_segment;
+      }
+      if(ackstate == ACK_NEW && (uip_connr->sndflags & SND_RECOVERY) &&
+         !(uip_flags & UIP_NEWDATA)) {
+        /* A partial ACK while recovering: the next segment was lost
+           as well. */
+        UIP_STAT(++uip_stat.tcp.rexmit);
+        goto tcp_rexmit_segment;
+      }
+
+      if(uip_connr->sndflags & SND_CLOSE) {
+        /* The application has closed the connection. Send our FIN
+           once all data has been acknowledged. */
+        if(uip_connr->len == 0) {
+          uip_connr->sndflags = 0;
+          uip_connr->len = 1;
+          uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
+          uip_connr->nrtx = 0;
+          goto tcp_send_finack;
+        }
+        if(uip_flags & UIP_NEWDATA) {
+          goto tcp_send_ack;
+        }
+        goto drop;
+      }
+#else /* UIP_TCP_SEND_WINDOW > 1 */
       tmp16 = ((uint16_t)UIP_TCP_BUF->wnd[0] << 8) + (uint16_t)UIP_TCP_BUF->wnd[1];
       if(tmp16 > uip_connr->initialmss ||
          tmp16 == 0) {
         tmp16 = uip_connr->initialmss;
       }
       uip_connr->mss = tmp16;
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
 
       /* If this packet constitutes an ACK for outstanding data (flagged
          by the UIP_ACKDATA flag, we should call the application since it
@@ -2088,7 +2749,28 @@ uip_process(uint8_t flag)
          put into the uip_appdata and the length of the data should be
          put into uip_len. If the application don't have any data to
          send, uip_len must be set to 0. */
+#if UIP_TCP_SEND_WINDOW > 1
+      /* With a send window, uip_acked() tells the application that its
+         data has been queued, and uip_rexmit() that it did not fit and
+         must be sent again. Both are reported when the window is open,
+         so that the application can send right away. */
+    appwindow:
+      if(uip_connr->sndflags & SND_CLOSE) {
+        goto drop;
+      }
+      if(send_window_open(uip_connr)) {
+        if(uip_connr->sndflags & SND_ACCEPTED) {
+          uip_flags |= UIP_ACKDATA;
+        }
+        if(uip_connr->sndflags & SND_REFUSED) {
+          uip_flags |= UIP_REXMIT;
+        }
+        uip_connr->sndflags &= ~(SND_ACCEPTED | SND_REFUSED);
+      }
+      if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA | UIP_REXMIT | UIP_POLL)) {
+#else /* UIP_TCP_SEND_WINDOW > 1 */
       if(uip_flags & (UIP_NEWDATA | UIP_ACKDATA)) {
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
         uip_slen = 0;
         UIP_APPCALL();
 
@@ -2097,12 +2779,25 @@ uip_process(uint8_t flag)
         if(uip_flags & UIP_ABORT) {
           uip_slen = 0;
           uip_connr->tcpstateflags = UIP_CLOSED;
+#if UIP_TCP_SEND_WINDOW > 1
+          drop_segments(uip_connr);
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
           UIP_TCP_BUF->flags = TCP_RST | TCP_ACK;
           goto tcp_send_nodata;
         }
 
         if(uip_flags & UIP_CLOSE) {
           uip_slen = 0;
+#if UIP_TCP_SEND_WINDOW > 1
+          if(uip_connr->len > 0) {
+            /* The FIN is sent after the data in flight. */
+            uip_connr->sndflags |= SND_CLOSE;
+            if(uip_flags & UIP_NEWDATA) {
+              goto tcp_send_ack;
+            }
+            goto drop;
+          }
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
           uip_connr->len = 1;
           uip_connr->tcpstateflags = UIP_FIN_WAIT_1;
           uip_connr->nrtx = 0;
@@ -2112,6 +2807,33 @@ uip_process(uint8_t flag)
 
         /* If uip_slen > 0, the application has data to be sent. */
         if(uip_slen > 0) {
+#if UIP_TCP_SEND_WINDOW > 1
+          if(uip_slen > uip_connr->mss) {
+            uip_slen = uip_connr->mss;
+          }
+          /* Keep a copy of the data for retransmission if it fits in
+             the window, otherwise ask for it again later. */
+          if(send_window_open(uip_connr)) {
+            queue_segment(uip_connr);
+            uip_connr->sndflags |= SND_ACCEPTED;
+          } else {
+            uip_connr->sndflags |= SND_REFUSED;
+            uip_slen = 0;
+          }
+        }
+        uip_appdata = uip_sappdata;
+
+        if(uip_slen > 0) {
+          /* Have the application called again if there is room for
+             more data. */
+          if(send_window_open(uip_connr)) {
+            tcpip_poll_tcp(uip_connr);
+          }
+          uip_len = uip_slen + UIP_TCPIP_HLEN;
+          UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+          goto tcp_send_noopts;
+        }
+#else /* UIP_TCP_SEND_WINDOW > 1 */
 
           /* If the connection has acknowledged data, the contents of
              the ->len variable should be discarded. */
@@ -2156,6 +2878,7 @@ uip_process(uint8_t flag)
           /* Send the packet. */
           goto tcp_send_noopts;
         }
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
         /* If there is no data to send, just send out a pure ACK if
            there is newdata. */
         if(uip_flags & UIP_NEWDATA) {
@@ -2231,6 +2954,17 @@ uip_process(uint8_t flag)
       }
   }
   goto drop;
+
+#if UIP_TCP_SEND_WINDOW > 1
+  /* We jump here to retransmit the oldest segment in flight. */
+ tcp_rexmit_segment:
+  uip_slen = uip_connr->segments->len;
+  memcpy(uip_sappdata, uip_connr->segments->data, uip_slen);
+  uip_len = uip_slen + UIP_TCPIP_HLEN;
+  rexmit = 1;
+  UIP_TCP_BUF->flags = TCP_ACK | TCP_PSH;
+  goto tcp_send_noopts;
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
   
   /* We jump here when we are ready to send the packet, and just want
      to set the appropriate TCP sequence numbers in the TCP header. */
@@ -2259,6 +2993,15 @@ uip_process(uint8_t flag)
   UIP_TCP_BUF->seqno[1] = uip_connr->snd_nxt[1];
   UIP_TCP_BUF->seqno[2] = uip_connr->snd_nxt[2];
   UIP_TCP_BUF->seqno[3] = uip_connr->snd_nxt[3];
+#if UIP_TCP_SEND_WINDOW > 1
+  if((uip_connr->tcpstateflags & UIP_TS_MASK) == UIP_ESTABLISHED &&
+     !rexmit && !(UIP_TCP_BUF->flags & TCP_SYN)) {
+    /* Everything but retransmissions follows the data in flight. */
+    uip_add32(uip_connr->snd_nxt,
+              uip_connr->len - (uip_len - UIP_IPTCPH_LEN));
+    memcpy(UIP_TCP_BUF->seqno, uip_acc32, 4);
+  }
+#endif /* UIP_TCP_SEND_WINDOW > 1 */
 
   UIP_IP_BUF->proto = UIP_PROTO_TCP;
 
@@ -322,6 +322,27 @@
 #define UIP_CONNS (UIP_CONF_MAX_CONNECTIONS)
 #endif /* UIP_CONF_MAX_CONNECTIONS */
 
+/**
+ * The number of hash buckets used to find the connection of an
+ * incoming TCP segment or UDP datagram.
+ *
+ * By default, uIP finds the connection of an incoming packet by
+ * scanning all connections. With many connections, it is faster to
+ * look the connection up in a hash table indexed by the ports and the
+ * remote address. The hash tables require a few bytes per bucket,
+ * and the listening ports and connections grow by a few bytes each.
+ *
+ * Hashing is only supported by the IPv6 stack. Set to zero to scan
+ * the connection tables.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_CONN_HASH
+#define UIP_CONN_HASH (UIP_CONF_CONN_HASH)
+#else
+#define UIP_CONN_HASH 0
+#endif
+
 
 /**
  * The maximum number of simultaneously listening TCP ports.
@@ -336,6 +357,29 @@
 #define UIP_LISTENPORTS (UIP_CONF_MAX_LISTENPORTS)
 #endif /* UIP_CONF_MAX_LISTENPORTS */
 
+/**
+ * Determines if SYN cookies should be used for incoming connections.
+ *
+ * Normally, uIP allocates a connection for every SYN that arrives on
+ * a listening port, and drops SYNs when all connections are in
+ * use. With SYN cookies, uIP answers a SYN without allocating a
+ * connection: the initial sequence number of the SYNACK encodes the
+ * MSS of the peer along with a keyed hash of the connection, and the
+ * connection is allocated when the peer acknowledges the SYNACK. The
+ * SYNACK is then not retransmitted by uIP; the peer retransmits its
+ * SYN instead.
+ *
+ * SYN cookies are only supported by the IPv6 stack. The key is taken
+ * from random_rand().
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_SYN_COOKIES
+#define UIP_TCP_SYN_COOKIES (UIP_CONF_TCP_SYN_COOKIES)
+#else
+#define UIP_TCP_SYN_COOKIES 0
+#endif
+
 /**
  * Determines if support for TCP urgent data notification should be
  * compiled in.
@@ -398,6 +442,44 @@
 #define UIP_RECEIVE_WINDOW (UIP_CONF_RECEIVE_WINDOW)
 #endif
 
+/**
+ * The number of TCP segments that a connection may have in flight.
+ *
+ * By default, uIP allows only one unacknowledged segment per
+ * connection, and the application must regenerate the data of the
+ * segment when it is retransmitted. With a larger send window, uIP
+ * copies the segments it sends into retransmission buffers and
+ * retransmits them by itself, using fast retransmit on duplicate
+ * ACKs. The application is then told that its data has been
+ * acknowledged (uip_acked()) as soon as uIP has queued it, and is
+ * asked to send again (uip_rexmit()) only when its data did not fit
+ * in the window.
+ *
+ * The send window is only supported by the IPv6 stack. The window
+ * times UIP_TCP_MSS must not exceed 65535 bytes; this is checked in
+ * uip.h, where the header sizes that UIP_TCP_MSS depends on are known.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_SEND_WINDOW
+#define UIP_TCP_SEND_WINDOW (UIP_CONF_TCP_SEND_WINDOW)
+#else
+#define UIP_TCP_SEND_WINDOW 1
+#endif
+
+/**
+ * The number of retransmission buffers shared by all TCP
+ * connections when UIP_TCP_SEND_WINDOW is larger than one. Each
+ * buffer holds one segment of UIP_TCP_MSS bytes.
+ *
+ * \hideinitializer
+ */
+#ifdef UIP_CONF_TCP_SEND_BUFFERS
+#define UIP_TCP_SEND_BUFFERS (UIP_CONF_TCP_SEND_BUFFERS)
+#else
+#define UIP_TCP_SEND_BUFFERS UIP_TCP_SEND_WINDOW
+#endif
+
 /**
  * How long a connection should stay in the TIME_WAIT state.
  *
@@ -146,6 +146,8 @@ typedef unsigned short uip_stats_t;
 #define cfs_write    pfs_write
 #define cfs_seek     pfs_seek
 #define cfs_remove   pfs_remove
+/* pfs reads files sequentially and cannot seek. */
+#define WEBSERVER_CONF_CFS_SEEK 0
 #else /* WITH_PFS */
 #define CFS_READ     (O_RDONLY)
 #define CFS_WRITE    (O_WRONLY | O_CREAT | O_TRUNC)
@@ -95,9 +95,10 @@ cfs_offset_t
 cfs_seek (int fd, cfs_offset_t offset, int whence)
 {
   File *file;
-  if (whence != CFS_SEEK_SET) return -1;
+  if (whence != CFS_SEEK_SET && whence != CFS_SEEK_CUR) return -1;
   file = get_file(fd);
   if (!file) return 0;
+  if (whence == CFS_SEEK_CUR) offset += file->FilePtr;
   if (file_setpos(file, offset) != 0) return -1;
   return file->FilePtr;
 }
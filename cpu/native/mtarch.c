@@ -32,12 +32,43 @@
  *
  */
 
+/* The fortified longjmp() refuses to jump between stacks, which is
+   what MTARCH_CONF_FAST_SWITCH does. This must come before any system
+   header is included, so the option has to be set on the command
+   line, e.g., with DEFINES=MTARCH_CONF_FAST_SWITCH=1. */
+#if MTARCH_CONF_FAST_SWITCH
+#undef _FORTIFY_SOURCE
+#endif /* MTARCH_CONF_FAST_SWITCH */
+
 #include "sys/mt.h"
 
 #ifndef MTARCH_STACKSIZE
 #define MTARCH_STACKSIZE 4096
 #endif /* MTARCH_STACKSIZE */
 
+/* Number of thread stacks kept in a static pool. Threads started
+   while the pool is empty get their stack from the heap. With 0,
+   every stack comes from the heap. */
+#ifdef MTARCH_CONF_STACK_POOL
+#define MTARCH_STACK_POOL MTARCH_CONF_STACK_POOL
+#else
+#define MTARCH_STACK_POOL 0
+#endif
+
+/* If set, switch between threads with _setjmp()/_longjmp() and use
+   ucontext only to enter a thread for the first time. This avoids the
+   signal mask system calls of swapcontext() and the per-thread
+   ucontext_t. */
+#ifdef MTARCH_CONF_FAST_SWITCH
+#define MTARCH_FAST_SWITCH MTARCH_CONF_FAST_SWITCH
+#else
+#define MTARCH_FAST_SWITCH 0
+#endif
+
+#if MTARCH_FAST_SWITCH && defined(_FORTIFY_SOURCE) && _FORTIFY_SOURCE > 0
+#error "MTARCH_CONF_FAST_SWITCH must be set on the command line"
+#endif
+
 #if defined(_WIN32) || defined(__CYGWIN__)
 
 #define WIN32_LEAN_AND_MEAN
@@ -52,17 +83,39 @@ static void *main_fiber;
 #define _XOPEN_SOURCE
 #endif
 
+#if MTARCH_FAST_SWITCH
+#include <setjmp.h>
+#endif /* MTARCH_FAST_SWITCH */
+
 #include <stdlib.h>
 #include <signal.h>
 #include <ucontext.h>
 
+#include "lib/memb.h"
+
 struct mtarch_t {
   char stack[MTARCH_STACKSIZE];
+#if MTARCH_FAST_SWITCH
+  jmp_buf context;
+  void (* function)(void *data);
+  void *data;
+  char started;
+#else /* MTARCH_FAST_SWITCH */
   ucontext_t context;
+#endif /* MTARCH_FAST_SWITCH */
 };
 
+#if MTARCH_FAST_SWITCH
+static jmp_buf main_context;
+static struct mtarch_t *running;
+#else /* MTARCH_FAST_SWITCH */
 static ucontext_t main_context;
 static ucontext_t *running_context;
+#endif /* MTARCH_FAST_SWITCH */
+
+#if MTARCH_STACK_POOL
+MEMB(stacks, struct mtarch_t, MTARCH_STACK_POOL);
+#endif /* MTARCH_STACK_POOL */
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
 
@@ -74,6 +127,20 @@ mtarch_init(void)
 
   main_fiber = ConvertThreadToFiber(NULL);
 
+#elif defined(__linux)
+
+#if MTARCH_STACK_POOL
+  memb_init(&stacks);
+#endif /* MTARCH_STACK_POOL */
+
+#if MTARCH_FAST_SWITCH
+  /* Bind _setjmp() and _longjmp() while still on the main stack, as
+     lazy symbol binding needs more stack than most threads do. */
+  if(_setjmp(main_context) == 0) {
+    _longjmp(main_context, 1);
+  }
+#endif /* MTARCH_FAST_SWITCH */
+
 #endif /* _WIN32 || __CYGWIN__ */
 }
 /*--------------------------------------------------------------------------*/
@@ -87,6 +154,14 @@ mtarch_remove(void)
 #endif /* _WIN32 || __CYGWIN__ */
 }
 /*--------------------------------------------------------------------------*/
+#if defined(__linux) && MTARCH_FAST_SWITCH
+static void
+start_running(void)
+{
+  running->function(running->data);
+}
+#endif /* __linux && MTARCH_FAST_SWITCH */
+/*--------------------------------------------------------------------------*/
 void
 mtarch_start(struct mtarch_thread *thread,
 	     void (* function)(void *data),
@@ -98,8 +173,28 @@ mtarch_start(struct mtarch_thread *thread,
 
 #elif defined(__linux)
 
+#if MTARCH_STACK_POOL
+  thread->mt_thread = memb_alloc(&stacks);
+  if(thread->mt_thread == NULL)
+#endif /* MTARCH_STACK_POOL */
   thread->mt_thread = malloc(sizeof(struct mtarch_t));
 
+  /* Fill the stack with a known pattern so that mtarch_stack_usage()
+     can find how deep the thread has been. */
+  {
+    int i;
+
+    for(i = 0; i < MTARCH_STACKSIZE; ++i) {
+      ((struct mtarch_t *)thread->mt_thread)->stack[i] = (char)i;
+    }
+  }
+
+#if MTARCH_FAST_SWITCH
+  /* The context is only made when the thread is first run. */
+  ((struct mtarch_t *)thread->mt_thread)->function = function;
+  ((struct mtarch_t *)thread->mt_thread)->data = data;
+  ((struct mtarch_t *)thread->mt_thread)->started = 0;
+#else /* MTARCH_FAST_SWITCH */
   getcontext(&((struct mtarch_t *)thread->mt_thread)->context);
 
   ((struct mtarch_t *)thread->mt_thread)->context.uc_link = NULL;
@@ -125,6 +220,7 @@ mtarch_start(struct mtarch_thread *thread,
        address thus requiring special handling. */
   makecontext(&((struct mtarch_t *)thread->mt_thread)->context,
 	      (void (*)(void))function, 1, data);
+#endif /* MTARCH_FAST_SWITCH */
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
 }
@@ -136,6 +232,12 @@ mtarch_yield(void)
 
   SwitchToFiber(main_fiber);
 
+#elif defined(__linux) && MTARCH_FAST_SWITCH
+
+  if(_setjmp(running->context) == 0) {
+    _longjmp(main_context, 1);
+  }
+
 #elif defined(__linux)
 
   swapcontext(running_context, &main_context);
@@ -150,6 +252,28 @@ mtarch_exec(struct mtarch_thread *thread)
 
   SwitchToFiber(thread->mt_thread);
 
+#elif defined(__linux) && MTARCH_FAST_SWITCH
+
+  running = thread->mt_thread;
+  if(_setjmp(main_context) == 0) {
+    if(running->started) {
+      _longjmp(running->context, 1);
+    } else {
+      /* Enter the thread on its own stack. The context is not needed
+         afterwards as the thread never returns through it. */
+      ucontext_t start_context, dummy;
+
+      running->started = 1;
+      getcontext(&start_context);
+      start_context.uc_link = NULL;
+      start_context.uc_stack.ss_sp = running->stack;
+      start_context.uc_stack.ss_size = sizeof(running->stack);
+      makecontext(&start_context, start_running, 0);
+      swapcontext(&dummy, &start_context);
+    }
+  }
+  running = NULL;
+
 #elif defined(__linux)
 
   running_context = &((struct mtarch_t *)thread->mt_thread)->context;
@@ -168,6 +292,12 @@ mtarch_stop(struct mtarch_thread *thread)
 
 #elif defined(linux) || defined(__linux)
 
+#if MTARCH_STACK_POOL
+  if(memb_inmemb(&stacks, thread->mt_thread)) {
+    memb_free(&stacks, thread->mt_thread);
+    return;
+  }
+#endif /* MTARCH_STACK_POOL */
   free(thread->mt_thread);
 
 #endif /* _WIN32 || __CYGWIN__ || __linux */
@@ -183,3 +313,21 @@ mtarch_pstop(void)
 {
 }
 /*--------------------------------------------------------------------------*/
+#if defined(__linux)
+int
+mtarch_stack_usage(struct mt_thread *t)
+{
+  struct mtarch_t *thread = t->thread.mt_thread;
+  int i;
+
+  /* The stack grows downwards, so the untouched part of the pattern
+     is at the low end. */
+  for(i = 0; i < MTARCH_STACKSIZE; ++i) {
+    if(thread->stack[i] != (char)i) {
+      break;
+    }
+  }
+  return MTARCH_STACKSIZE - i;
+}
+/*--------------------------------------------------------------------------*/
+#endif /* __linux */
@@ -39,4 +39,12 @@ struct mtarch_thread {
   void *mt_thread;
 };
 
+struct mt_thread;
+
+#if defined(__linux)
+/* Returns the deepest stack use in bytes seen so far by a thread. The
+   stacks of the Windows fibers cannot be inspected. */
+int mtarch_stack_usage(struct mt_thread *t);
+#endif /* __linux */
+
 #endif /* MTARCH_H_ */
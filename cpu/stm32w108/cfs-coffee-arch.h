@@ -118,6 +118,10 @@
 #define COFFEE_ERASE(sector) \
         stm32w_flash_erase(sector)
 
+/* The internal flash is memory-mapped. */
+#define COFFEE_MAP(offset) \
+        ((const void *)(COFFEE_START + (offset)))
+
 
 void stm32w_flash_read(uint32_t address, void *data, uint32_t length);
 
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of range queries through the Antelope indexes.
+ *         It fills a relation with rows whose keys are spread in a
+ *         pseudo-random order over 0 ... 65520, and then runs range
+ *         queries of QUERY_WIDTH keys. The same queries run without
+ *         an index, through a MAXHEAP index and through a BTREE
+ *         index. Each query is checked against the expected number
+ *         of rows.
+ *
+ *         The number of rows is set with DEFINES=ROWS=n. Removing a
+ *         relation does not remove the files of its indexes, so they
+ *         are left in the directory.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+PROCESS(index_bench_process, "Antelope index benchmark");
+AUTOSTART_PROCESSES(&index_bench_process);
+
+#ifndef ROWS
+#define ROWS		10000L
+#endif
+#define QUERIES		50
+#define QUERY_WIDTH	100
+#define KEYS		65521UL
+
+static db_handle_t handle;
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+/* Runs a query to completion. Returns the number of result rows, or
+   -1 if the query failed. */
+static long
+run_query(const char *query)
+{
+  db_result_t result;
+  long rows;
+
+  result = db_query(&handle, query);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", query,
+           db_get_result_message(result));
+    db_free(&handle);
+    return -1;
+  }
+
+  rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      rows++;
+    } else if(result != DB_OK) {
+      db_free(&handle);
+      if(DB_ERROR(result)) {
+        printf("Processing \"%s\" failed: %s\n", query,
+               db_get_result_message(result));
+        return -1;
+      }
+    }
+  }
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+/* 40503 is coprime to KEYS, so the first KEYS rows get distinct
+   keys. */
+static unsigned long
+key(long row)
+{
+  return (row * 40503UL) % KEYS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+range_queries(const char *index)
+{
+  char query[80];
+  long i, j, low, rows, expected_rows;
+  double t, insert_time, query_time;
+
+  run_query("REMOVE RELATION t;");
+  if(run_query("CREATE RELATION t;") < 0 ||
+     run_query("CREATE ATTRIBUTE id DOMAIN INT IN t;") < 0 ||
+     run_query("CREATE ATTRIBUTE value DOMAIN LONG IN t;") < 0) {
+    exit(1);
+  }
+  if(index != NULL) {
+    sprintf(query, "CREATE INDEX t.id TYPE %s;", index);
+    if(run_query(query) < 0) {
+      exit(1);
+    }
+  }
+
+  insert_time = now();
+  for(i = 0; i < ROWS; i++) {
+    sprintf(query, "INSERT (%lu, %ld) INTO t;", key(i), i);
+    if(run_query(query) < 0) {
+      printf("%s: insert failed after %ld rows\n",
+             index != NULL ? index : "No index", i);
+      return;
+    }
+  }
+  insert_time = now() - insert_time;
+
+  query_time = 0;
+  for(i = 0; i < QUERIES; i++) {
+    low = (i * 7919) % KEYS;
+    sprintf(query, "SELECT id, value FROM t WHERE id >= %ld AND id <= %ld;",
+            low, low + QUERY_WIDTH - 1);
+    t = now();
+    rows = run_query(query);
+    query_time += now() - t;
+
+    expected_rows = 0;
+    for(j = 0; j < ROWS; j++) {
+      if(key(j) >= low && key(j) < low + QUERY_WIDTH) {
+        expected_rows++;
+      }
+    }
+    if(rows != expected_rows) {
+      printf("%s: query %ld got %ld rows, expected %ld\n",
+             index != NULL ? index : "No index", i, rows, expected_rows);
+      exit(1);
+    }
+  }
+
+  printf("%s, %ld rows: insert %.1f us/row, range query %.0f us\n",
+         index != NULL ? index : "No index", (long)ROWS,
+         insert_time / ROWS * 1e6, query_time / QUERIES * 1e6);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(index_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  range_queries(NULL);
+  range_queries("MAXHEAP");
+  range_queries("BTREE");
+
+  run_query("REMOVE RELATION t;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of inserts in Antelope. It inserts rows one
+ *         query at a time, first on their own and then in a batch
+ *         started with db_insert_begin(). This runs without an index,
+ *         with a BTREE index and with a MAXHEAP index on the key.
+ *
+ *         In the middle of a batch, a selection checks that it sees
+ *         every row inserted so far. After the inserts, the number of
+ *         rows and a set of range queries are checked against the
+ *         expected results. Compile with DEFINES=DB_INSERT_BUFFER_SIZE=0
+ *         to run the batches without buffering.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+PROCESS(insert_bench_process, "Antelope insert benchmark");
+AUTOSTART_PROCESSES(&insert_bench_process);
+
+#ifndef ROWS
+#define ROWS		20000L
+#endif
+#define QUERIES		20
+#define QUERY_WIDTH	500
+#define KEYS		65521UL
+
+static db_handle_t handle;
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+/* Runs a query to completion. Returns the number of result rows, or
+   -1 if the query failed. */
+static long
+run_query(const char *query)
+{
+  db_result_t result;
+  long rows;
+
+  result = db_query(&handle, query);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", query,
+           db_get_result_message(result));
+    db_free(&handle);
+    return -1;
+  }
+
+  rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      rows++;
+    } else if(result != DB_OK) {
+      db_free(&handle);
+      if(DB_ERROR(result)) {
+        printf("Processing \"%s\" failed: %s\n", query,
+               db_get_result_message(result));
+        return -1;
+      }
+    }
+  }
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+/* 40503 is coprime to KEYS, so the first KEYS rows get distinct
+   keys. */
+static unsigned long
+key(long row)
+{
+  return (row * 40503UL) % KEYS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check(const char *setup, const char *what, long rows, long expected_rows)
+{
+  if(rows != expected_rows) {
+    printf("%s: %s got %ld rows, expected %ld\n",
+           setup, what, rows, expected_rows);
+    exit(1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert(const char *index, int batch)
+{
+  char setup[32];
+  char query[80];
+  long i, j, low, expected_rows;
+  double t;
+
+  sprintf(setup, "%s, %s", index != NULL ? index : "No index",
+          batch ? "batched" : "plain");
+
+  run_query("REMOVE RELATION t;");
+  if(run_query("CREATE RELATION t;") < 0 ||
+     run_query("CREATE ATTRIBUTE id DOMAIN INT IN t;") < 0 ||
+     run_query("CREATE ATTRIBUTE value DOMAIN LONG IN t;") < 0) {
+    exit(1);
+  }
+  if(index != NULL) {
+    sprintf(query, "CREATE INDEX t.id TYPE %s;", index);
+    if(run_query(query) < 0) {
+      exit(1);
+    }
+  }
+
+  t = now();
+  if(batch && DB_ERROR(db_insert_begin("t"))) {
+    printf("%s: db_insert_begin() failed\n", setup);
+    exit(1);
+  }
+  for(i = 0; i < ROWS; i++) {
+    sprintf(query, "INSERT (%lu, %ld) INTO t;", key(i), i);
+    if(run_query(query) < 0) {
+      exit(1);
+    }
+    if(batch && i == ROWS / 2) {
+      check(setup, "a selection in the batch",
+            run_query("SELECT id FROM t;"), i + 1);
+    }
+  }
+  if(batch && DB_ERROR(db_insert_end())) {
+    printf("%s: db_insert_end() failed\n", setup);
+    exit(1);
+  }
+  t = now() - t;
+
+  check(setup, "a selection of all rows", run_query("SELECT id FROM t;"),
+        ROWS);
+  for(i = 0; i < QUERIES; i++) {
+    low = (i * 7919) % KEYS;
+    expected_rows = 0;
+    for(j = 0; j < ROWS; j++) {
+      if(key(j) >= low && key(j) < low + QUERY_WIDTH) {
+        expected_rows++;
+      }
+    }
+    sprintf(query, "SELECT id, value FROM t WHERE id >= %ld AND id <= %ld;",
+            low, low + QUERY_WIDTH - 1);
+    check(setup, "a range query", run_query(query), expected_rows);
+  }
+
+  printf("%s, %ld rows: %.0f inserts/s\n", setup, (long)ROWS, ROWS / t);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(insert_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  insert(NULL, 0);
+  insert(NULL, 1);
+  insert("BTREE", 0);
+  insert("BTREE", 1);
+  insert("MAXHEAP", 0);
+  insert("MAXHEAP", 1);
+
+  run_query("REMOVE RELATION t;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the join operators in Antelope. It joins two
+ *         relations on a numeric attribute in three setups, so that
+ *         the planner picks a different operator for each:
+ *
+ *         - no index: the hash join;
+ *         - a MAXHEAP index on the right relation: the index nested
+ *           loop join;
+ *         - INLINE indexes on both relations: the merge join.
+ *
+ *         Each join is checked against the expected number of rows
+ *         and the sum of the projected values. With
+ *         DEFINES=DB_JOIN_HASH_MEMORY=0, the join without an index is
+ *         rejected, since the nested loop join needs one.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+PROCESS(join_bench_process, "Antelope join benchmark");
+AUTOSTART_PROCESSES(&join_bench_process);
+
+static db_handle_t handle;
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+/* Runs a query to completion. Returns the number of result rows, or
+   -1 if the query failed. The two projected values of each result
+   row are added to the sum if one is given, the second one three
+   times so that swapped columns are noticed. */
+static long
+run_query(const char *query, long *sum)
+{
+  attribute_value_t value;
+  db_result_t result;
+  long rows;
+
+  result = db_query(&handle, query);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", query,
+           db_get_result_message(result));
+    db_free(&handle);
+    return -1;
+  }
+
+  rows = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW) {
+      rows++;
+      if(sum != NULL) {
+        db_get_value(&value, &handle, 0);
+        *sum += db_value_to_long(&value);
+        db_get_value(&value, &handle, 1);
+        *sum += 3 * db_value_to_long(&value);
+      }
+    } else if(result != DB_OK) {
+      db_free(&handle);
+      if(DB_ERROR(result)) {
+        printf("Processing \"%s\" failed: %s\n", query,
+               db_get_result_message(result));
+        return -1;
+      }
+    }
+  }
+  return rows;
+}
+/*---------------------------------------------------------------------------*/
+static void
+create_relation(const char *name, const char *value, const char *index)
+{
+  char query[64];
+
+  sprintf(query, "REMOVE RELATION %s;", name);
+  run_query(query, NULL);
+  sprintf(query, "CREATE RELATION %s;", name);
+  if(run_query(query, NULL) < 0) {
+    exit(1);
+  }
+  sprintf(query, "CREATE ATTRIBUTE id DOMAIN INT IN %s;", name);
+  if(run_query(query, NULL) < 0) {
+    exit(1);
+  }
+  sprintf(query, "CREATE ATTRIBUTE %s DOMAIN LONG IN %s;", value, name);
+  if(run_query(query, NULL) < 0) {
+    exit(1);
+  }
+  if(index != NULL) {
+    sprintf(query, "CREATE INDEX %s.id TYPE %s;", name, index);
+    if(run_query(query, NULL) < 0) {
+      exit(1);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Joins a left relation of the even keys 0, 2, ..., 2 * (left - 1)
+   with a right relation of right rows. The right keys are spread over
+   0 ... keys - 1, in ascending order if sorted is set, since an INLINE
+   index requires that. */
+static void
+join(const char *setup, long left, long right, long keys,
+     const char *left_index, const char *right_index, int sorted)
+{
+  char query[64];
+  long i, id, rows, sum, expected_rows, expected_sum;
+  double t;
+
+  create_relation("a", "x", left_index);
+  create_relation("b", "y", right_index);
+
+  for(i = 0; i < left; i++) {
+    sprintf(query, "INSERT (%ld, %ld) INTO a;", i * 2, i);
+    if(run_query(query, NULL) < 0) {
+      exit(1);
+    }
+  }
+
+  expected_rows = expected_sum = 0;
+  for(i = 0; i < right; i++) {
+    id = sorted ? i * keys / right : i * 7 % keys;
+    sprintf(query, "INSERT (%ld, %ld) INTO b;", id, i);
+    if(run_query(query, NULL) < 0) {
+      exit(1);
+    }
+    if(id % 2 == 0 && id / 2 < left) {
+      expected_rows++;
+      expected_sum += id / 2 + 3 * i;
+    }
+  }
+
+  sum = 0;
+  t = now();
+  rows = run_query("JOIN a, b ON id PROJECT x, y;", &sum);
+  t = now() - t;
+  if(rows < 0) {
+    return;
+  }
+  if(rows != expected_rows || sum != expected_sum) {
+    printf("%s: got %ld rows, expected %ld%s\n", setup, rows,
+           expected_rows, sum != expected_sum ? ", wrong values" : "");
+    exit(1);
+  }
+  printf("%s, %ld x %ld rows, %ld matches: %.1f ms\n",
+         setup, left, right, rows, t * 1000);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(join_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  db_init();
+
+  join("No index", 2000, 20000, 4000, NULL, NULL, 0);
+  join("MAXHEAP index", 2000, 20000, 4000, NULL, "MAXHEAP", 0);
+  join("INLINE indexes", 200, 5000, 400, "INLINE", "INLINE", 1);
+
+  run_query("REMOVE RELATION a;", NULL);
+  run_query("REMOVE RELATION b;", NULL);
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
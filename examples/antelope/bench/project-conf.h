@@ -0,0 +1,8 @@
+/* The benchmarks time the database, not the emulated flash of the
+   native platform, so the relations are stored in host files. */
+#undef DB_FEATURE_COFFEE
+#define DB_FEATURE_COFFEE	0
+
+/* Large enough B+-tree nodes and files for the index benchmark. */
+#define DB_BTREE_NODE_SIZE	256
+#define DB_BTREE_NODE_LIMIT	32768
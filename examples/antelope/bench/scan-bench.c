@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of sequential scans in Antelope. It fills a
+ *         relation with 8-byte rows and prints the rate at which a
+ *         selection with a predicate on a non-indexed attribute
+ *         processes them.
+ *
+ *         The number of rows is set with DEFINES=ROWS=n. Compile
+ *         with DEFINES=DB_STORAGE_BLOCK_SIZE=0 to compare against
+ *         reading one row at a time.
+ */
+
+#include "contiki.h"
+#include "antelope.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+PROCESS(scan_bench_process, "Antelope scan benchmark");
+AUTOSTART_PROCESSES(&scan_bench_process);
+
+#ifndef ROWS
+#define ROWS	10000L
+#endif
+#define ROUNDS	5
+
+static db_handle_t handle;
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+/* Runs a query to completion. Returns the number of rows that were
+   processed, or -1 if the query failed. */
+static long
+run_query(const char *query)
+{
+  db_result_t result;
+  long processed;
+
+  result = db_query(&handle, query);
+  if(DB_ERROR(result)) {
+    printf("Query \"%s\" failed: %s\n", query,
+           db_get_result_message(result));
+    db_free(&handle);
+    return -1;
+  }
+
+  processed = 0;
+  while(db_processing(&handle)) {
+    result = db_process(&handle);
+    if(result == DB_GOT_ROW || result == DB_OK) {
+      processed++;
+    } else {
+      db_free(&handle);
+      if(DB_ERROR(result)) {
+        printf("Processing \"%s\" failed: %s\n", query,
+               db_get_result_message(result));
+        return -1;
+      }
+    }
+  }
+  return processed;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(scan_bench_process, ev, data)
+{
+  static char query[64];
+  static long i;
+  double t, best;
+  long processed;
+
+  PROCESS_BEGIN();
+
+  db_init();
+
+  run_query("REMOVE RELATION samples;");
+  if(run_query("CREATE RELATION samples;") < 0 ||
+     run_query("CREATE ATTRIBUTE id DOMAIN INT IN samples;") < 0 ||
+     run_query("CREATE ATTRIBUTE sensor DOMAIN INT IN samples;") < 0 ||
+     run_query("CREATE ATTRIBUTE value DOMAIN LONG IN samples;") < 0) {
+    exit(1);
+  }
+
+  for(i = 0; i < ROWS; i++) {
+    sprintf(query, "INSERT (%ld, %ld, %ld) INTO samples;",
+            i & 0x7fff, i % 16, (i * 7919) % 100000);
+    if(run_query(query) < 0) {
+      exit(1);
+    }
+  }
+
+  /* Report the best round, which is the least disturbed by the
+     host. */
+  best = 0;
+  for(i = 0; i < ROUNDS; i++) {
+    t = now();
+    processed = run_query("SELECT id, value FROM samples WHERE value < 10;");
+    t = now() - t;
+    if(processed != ROWS) {
+      printf("Scanned %ld rows instead of %ld\n", processed, (long)ROWS);
+      exit(1);
+    }
+    if(best == 0 || t < best) {
+      best = t;
+    }
+  }
+  printf("Scan of %ld rows: %.0f rows/s\n", (long)ROWS, ROWS / best);
+
+  run_query("REMOVE RELATION samples;");
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of vectored and positional I/O in CFS. It writes
+ *         a file of records that each consist of three separate
+ *         buffers: a header, a payload and a trailer. The records are
+ *         written with one cfs_write() per buffer, with one
+ *         cfs_writev() per record and with one cfs_writev() per
+ *         RECORDS_PER_WRITE records. They are then read back in a
+ *         pseudo-random order with cfs_seek() followed by three
+ *         cfs_read() calls, with cfs_seek() followed by cfs_readv(),
+ *         and with cfs_pread(). Every record read is checked.
+ *
+ *         The file is stored through the POSIX file system. Build
+ *         with make COFFEE=1 to use Coffee on the emulated flash of
+ *         the native platform instead. The number of records is set
+ *         with DEFINES=RECORDS=n.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#if WITH_COFFEE
+#include "cfs/cfs-coffee.h"
+#endif /* WITH_COFFEE */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+PROCESS(cfs_iovec_bench_process, "CFS vectored I/O benchmark");
+AUTOSTART_PROCESSES(&cfs_iovec_bench_process);
+
+#ifndef RECORDS
+#define RECORDS			8000L
+#endif
+#define RECORDS_PER_WRITE	8
+
+#define HEADER_SIZE		6
+#define PAYLOAD_SIZE		20
+#define TRAILER_SIZE		2
+#define RECORD_SIZE		(HEADER_SIZE + PAYLOAD_SIZE + TRAILER_SIZE)
+
+#define FILENAME		"records"
+
+struct record {
+  unsigned char header[HEADER_SIZE];
+  unsigned char payload[PAYLOAD_SIZE];
+  unsigned char trailer[TRAILER_SIZE];
+};
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fill_record(struct record *r, long i)
+{
+  memset(r->header, i, HEADER_SIZE);
+  memset(r->payload, i * 3 + 1, PAYLOAD_SIZE);
+  memset(r->trailer, i * 7 + 2, TRAILER_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_iovec(struct cfs_iovec *iov, struct record *r)
+{
+  iov[0].iov_base = r->header;
+  iov[0].iov_len = HEADER_SIZE;
+  iov[1].iov_base = r->payload;
+  iov[1].iov_len = PAYLOAD_SIZE;
+  iov[2].iov_base = r->trailer;
+  iov[2].iov_len = TRAILER_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_file(int flags)
+{
+  int fd;
+
+  fd = cfs_open(FILENAME, flags);
+  if(fd < 0) {
+    printf("Failed to open the file\n");
+    exit(1);
+  }
+  return fd;
+}
+/*---------------------------------------------------------------------------*/
+/* Writes the file with one call per buffer, per record or per
+   RECORDS_PER_WRITE records. */
+static void
+write_records(const char *method, int records_per_call)
+{
+  static struct record records[RECORDS_PER_WRITE];
+  struct cfs_iovec iov[3 * RECORDS_PER_WRITE];
+  long i;
+  int fd, k, n;
+  double t;
+
+  cfs_remove(FILENAME);
+#if WITH_COFFEE
+  if(cfs_coffee_reserve(FILENAME, RECORDS * RECORD_SIZE) < 0) {
+    printf("Failed to reserve the file\n");
+    exit(1);
+  }
+#endif /* WITH_COFFEE */
+  fd = open_file(CFS_WRITE);
+
+  t = now();
+  for(i = 0; i < RECORDS; i += RECORDS_PER_WRITE) {
+    for(k = 0; k < RECORDS_PER_WRITE; k++) {
+      fill_record(&records[k], i + k);
+      set_iovec(&iov[3 * k], &records[k]);
+    }
+    if(records_per_call == 0) {
+      for(k = 0; k < 3 * RECORDS_PER_WRITE; k++) {
+        if(cfs_write(fd, iov[k].iov_base, iov[k].iov_len) != iov[k].iov_len) {
+          break;
+        }
+      }
+      n = k == 3 * RECORDS_PER_WRITE;
+    } else {
+      for(k = n = 0; k < RECORDS_PER_WRITE; k += records_per_call) {
+        n += cfs_writev(fd, &iov[3 * k], 3 * records_per_call);
+      }
+      n = n == RECORDS_PER_WRITE * RECORD_SIZE;
+    }
+    if(!n) {
+      printf("%s failed\n", method);
+      exit(1);
+    }
+  }
+  t = now() - t;
+  cfs_close(fd);
+
+  printf("Write, %s: %.0f records/s\n", method, RECORDS / t);
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_record(int fd, int method, struct record *r, cfs_offset_t offset)
+{
+  struct cfs_iovec iov[3];
+
+  switch(method) {
+  case 0:
+    return cfs_seek(fd, offset, CFS_SEEK_SET) == offset &&
+      cfs_read(fd, r->header, HEADER_SIZE) == HEADER_SIZE &&
+      cfs_read(fd, r->payload, PAYLOAD_SIZE) == PAYLOAD_SIZE &&
+      cfs_read(fd, r->trailer, TRAILER_SIZE) == TRAILER_SIZE;
+  case 1:
+    set_iovec(iov, r);
+    return cfs_seek(fd, offset, CFS_SEEK_SET) == offset &&
+      cfs_readv(fd, iov, 3) == RECORD_SIZE;
+  default:
+    return cfs_pread(fd, r, RECORD_SIZE, offset) == RECORD_SIZE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_records(const char *name, int method)
+{
+  struct record r, expected;
+  long i, j;
+  int fd;
+  double t;
+
+  fd = open_file(CFS_READ);
+
+  t = now();
+  for(i = 0; i < RECORDS; i++) {
+    j = (i * 7919) % RECORDS;
+    if(!read_record(fd, method, &r, (cfs_offset_t)j * RECORD_SIZE)) {
+      printf("%s failed\n", name);
+      exit(1);
+    }
+    fill_record(&expected, j);
+    if(memcmp(&r, &expected, RECORD_SIZE) != 0) {
+      printf("%s: wrong contents in record %ld\n", name, j);
+      exit(1);
+    }
+  }
+  t = now() - t;
+
+  if(method == 2) {
+    if(cfs_seek(fd, 0, CFS_SEEK_CUR) != 0) {
+      printf("%s moved the file position\n", name);
+      exit(1);
+    }
+    if(cfs_pread(fd, &r, RECORD_SIZE,
+                 (cfs_offset_t)RECORDS * RECORD_SIZE) != 0) {
+      printf("%s read past the end of the file\n", name);
+      exit(1);
+    }
+  }
+  cfs_close(fd);
+
+  printf("Random read, %s: %.0f records/s\n", name, RECORDS / t);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(cfs_iovec_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+#if WITH_COFFEE
+  cfs_coffee_format();
+#endif /* WITH_COFFEE */
+
+  write_records("cfs_write per buffer", 0);
+  read_records("cfs_seek and 3 x cfs_read", 0);
+  write_records("cfs_writev per record", 1);
+  read_records("cfs_seek and cfs_readv", 1);
+  write_records("cfs_writev per 8 records", RECORDS_PER_WRITE);
+  read_records("cfs_pread", 2);
+
+  cfs_remove(FILENAME);
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the chameleon-bitopt header module. It packs
+ *         and unpacks randomized headers for the attribute lists of
+ *         collect, multihop and runicast on the native platform, and
+ *         prints the operations per second together with a checksum
+ *         of the headers and attributes.
+ *
+ *         The checksum does not depend on how headers are built, so
+ *         it must be the same for every build. Compile with
+ *         DEFINES=CHAMELEON_BITOPT_CONF_LAYOUTS=0 to compare against
+ *         interpreting the attribute list on every packet.
+ */
+
+#include "contiki.h"
+#include "net/rime.h"
+#include "net/rime/chameleon-bitopt.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+PROCESS(chameleon_bench_process, "Chameleon benchmark");
+AUTOSTART_PROCESSES(&chameleon_bench_process);
+
+#define CHECKED_PACKETS  200000UL
+#define TIMED_PACKETS    2000000UL
+#define ROUNDS           5
+
+static const struct packetbuf_attrlist collect_attributes[] = {
+  COLLECT_ATTRIBUTES
+  PACKETBUF_ATTR_LAST
+};
+static const struct packetbuf_attrlist multihop_attributes[] = {
+  MULTIHOP_ATTRIBUTES
+  PACKETBUF_ATTR_LAST
+};
+static const struct packetbuf_attrlist runicast_attributes[] = {
+  RUNICAST_ATTRIBUTES
+  PACKETBUF_ATTR_LAST
+};
+
+static uint8_t buf[PACKETBUF_SIZE + PACKETBUF_HDR_SIZE];
+static int len;
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_random_attributes(const struct packetbuf_attrlist *attrlist)
+{
+  const struct packetbuf_attrlist *a;
+  rimeaddr_t addr;
+
+  for(a = attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
+    if(PACKETBUF_IS_ADDR(a->type)) {
+      addr.u8[0] = random_rand();
+      addr.u8[1] = random_rand();
+      packetbuf_set_addr(a->type, &addr);
+    } else {
+      packetbuf_set_attr(a->type, random_rand() &
+                         ((1 << (a->len > 15 ? 15 : a->len)) - 1));
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+checksum_attributes(unsigned long sum,
+                    const struct packetbuf_attrlist *attrlist)
+{
+  const struct packetbuf_attrlist *a;
+
+  for(a = attrlist; a->type != PACKETBUF_ATTR_NONE; ++a) {
+    if(PACKETBUF_IS_ADDR(a->type)) {
+      sum = sum * 31 + packetbuf_addr(a->type)->u8[0];
+      sum = sum * 31 + packetbuf_addr(a->type)->u8[1];
+    } else {
+      sum = sum * 31 + packetbuf_attr(a->type);
+    }
+  }
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the best time of ROUNDS runs of TIMED_PACKETS packets,
+   minus the time spent on setting up the packet buffer. */
+static double
+time_packets(struct channel *c, int pack)
+{
+  double best, base, t;
+  unsigned long i;
+  int r;
+
+  best = base = 1e9;
+  for(r = 0; r < ROUNDS; r++) {
+    t = now();
+    for(i = 0; i < TIMED_PACKETS; i++) {
+      packetbuf_clear();
+      packetbuf_copyfrom(buf, len);
+    }
+    t = now() - t;
+    if(t < base) {
+      base = t;
+    }
+
+    t = now();
+    for(i = 0; i < TIMED_PACKETS; i++) {
+      packetbuf_clear();
+      packetbuf_copyfrom(buf, len);
+      if(pack) {
+        chameleon_bitopt.output(c);
+      } else {
+        chameleon_bitopt.input();
+      }
+    }
+    t = now() - t;
+    if(t < best) {
+      best = t;
+    }
+  }
+  return best - base;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(const char *name, const struct packetbuf_attrlist *attrlist,
+    uint16_t channelno)
+{
+  static struct channel c;
+  unsigned long sum;
+  unsigned long i;
+  int j;
+
+  memset(&c, 0, sizeof(c));
+  channel_open(&c, channelno);
+  channel_set_attributes(channelno, attrlist);
+
+  random_init(1);
+  sum = 0;
+  for(i = 0; i < CHECKED_PACKETS; i++) {
+    packetbuf_clear();
+    packetbuf_copyfrom("hello", 5);
+    set_random_attributes(attrlist);
+    chameleon_bitopt.output(&c);
+
+    len = packetbuf_copyto(buf);
+    for(j = 0; j < len; j++) {
+      sum = sum * 31 + buf[j];
+    }
+
+    packetbuf_clear();
+    packetbuf_copyfrom(buf, len);
+    chameleon_bitopt.input();
+    sum = checksum_attributes(sum, attrlist);
+  }
+
+  printf("%s: checksum %08lx, pack %.0f/s, unpack %.0f/s\n", name, sum,
+         TIMED_PACKETS / time_packets(&c, 1),
+         TIMED_PACKETS / time_packets(&c, 0));
+
+  channel_close(&c);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(chameleon_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  run("collect", collect_attributes, 130);
+  run("multihop", multihop_attributes, 131);
+  run("runicast", runicast_attributes, 132);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A simulation of the sector wear caused by a long, randomized
+ *         workload on Coffee. It runs on the native platform, where
+ *         Coffee uses the emulated flash memory, and prints the
+ *         distribution of the erase counts of the sectors at the end.
+ *
+ *         The workload mixes static files, which are written once and
+ *         replaced rarely, with log files that are appended to until
+ *         they are rotated. Compile with
+ *         DEFINES=COFFEE_CONF_WEAR_LEVELLING_ALLOCATOR=0 to compare
+ *         against the first-fit allocator.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "lib/random.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+PROCESS(coffee_wear_process, "Coffee wear simulation");
+AUTOSTART_PROCESSES(&coffee_wear_process);
+
+#define STEPS			200000UL
+#define STATIC_FILES		8
+#define STATIC_SIZE		8192
+#define LOG_FILES		4
+#define LOG_RECORD_SIZE		256
+#define LOG_LIMIT		(32 * 1024UL)
+#define MAX_SECTORS		64
+
+static unsigned char buf[STATIC_SIZE];
+/*---------------------------------------------------------------------------*/
+static int
+write_static_file(unsigned i)
+{
+  char name[16];
+  int fd;
+  int r;
+
+  sprintf(name, "static%u", i);
+  cfs_remove(name);
+  if(cfs_coffee_reserve(name, STATIC_SIZE) < 0) {
+    return -1;
+  }
+
+  fd = cfs_open(name, CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  r = cfs_write(fd, buf, STATIC_SIZE);
+  cfs_close(fd);
+
+  return r == STATIC_SIZE ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+append_log_record(unsigned i)
+{
+  char name[16];
+  int fd;
+  int r;
+
+  sprintf(name, "log%u", i);
+  fd = cfs_open(name, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return -1;
+  }
+
+  if(cfs_seek(fd, 0, CFS_SEEK_END) + LOG_RECORD_SIZE > LOG_LIMIT) {
+    /* Rotate the log. */
+    cfs_close(fd);
+    cfs_remove(name);
+    fd = cfs_open(name, CFS_WRITE);
+    if(fd < 0) {
+      return -1;
+    }
+  }
+
+  r = cfs_write(fd, buf, LOG_RECORD_SIZE);
+  cfs_close(fd);
+
+  return r == LOG_RECORD_SIZE ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_erase_counts(void)
+{
+  static unsigned long counts[MAX_SECTORS];
+  struct cfs_coffee_stats stats;
+  unsigned long min, max, total;
+  unsigned long long squares;
+  unsigned sectors;
+  unsigned i;
+
+  sectors = cfs_coffee_get_erase_counts(counts, MAX_SECTORS);
+  if(sectors > MAX_SECTORS) {
+    sectors = MAX_SECTORS;
+  }
+
+  min = max = counts[0];
+  total = 0;
+  squares = 0;
+  printf("Erase counts:");
+  for(i = 0; i < sectors; i++) {
+    printf(" %lu", counts[i]);
+    if(counts[i] < min) {
+      min = counts[i];
+    }
+    if(counts[i] > max) {
+      max = counts[i];
+    }
+    total += counts[i];
+    squares += (unsigned long long)counts[i] * counts[i];
+  }
+  printf("\n");
+
+  printf("Sectors %u, erases %lu, min %lu, max %lu, mean %lu, variance %lu\n",
+         sectors, total, min, max, total / sectors,
+         (unsigned long)(squares / sectors -
+                         (unsigned long long)(total / sectors) * (total / sectors)));
+
+  cfs_coffee_get_stats(&stats);
+  printf("Write amplification %lu.%02lu\n",
+         stats.bytes_written / stats.bytes_requested,
+         stats.bytes_written * 100 / stats.bytes_requested % 100);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_wear_process, ev, data)
+{
+  static unsigned long step;
+  unsigned i;
+
+  PROCESS_BEGIN();
+
+  random_init(1);
+  memset(buf, 0xa5, sizeof(buf));
+
+  printf("Formatting the file system\n");
+  cfs_coffee_format();
+
+  for(i = 0; i < STATIC_FILES; i++) {
+    if(write_static_file(i) < 0) {
+      printf("Failed to create static file %u\n", i);
+      exit(1);
+    }
+  }
+
+  for(step = 0; step < STEPS; step++) {
+    if(random_rand() % 200 == 0) {
+      i = random_rand() % STATIC_FILES;
+      if(write_static_file(i) < 0) {
+        printf("Failed to replace static file %u at step %lu\n", i, step);
+        exit(1);
+      }
+    } else {
+      i = random_rand() % LOG_FILES;
+      if(append_log_record(i) < 0) {
+        printf("Failed to append to log file %u at step %lu\n", i, step);
+        exit(1);
+      }
+    }
+
+    /* Let the background garbage collector run. */
+    PROCESS_PAUSE();
+  }
+
+  print_erase_counts();
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
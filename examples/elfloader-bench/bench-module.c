@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         The module loaded by the ELF loader benchmark. It is
+ *         compiled for 32-bit x86, so that the relocations can be
+ *         applied by elfloader-x86.c, and is never run.
+ *
+ *         The module defines a few hundred functions and variables
+ *         that refer to each other and to the core, which gives the
+ *         loader a few thousand relocations against both module and
+ *         core symbols.
+ */
+
+/* The core symbols are only referred to, so their types do not
+   matter. */
+extern char etimer_set[], process_post[], list_add[], memb_free[];
+extern char random_rand[];
+
+char module_process[32];
+char module_timer[32];
+char module_list[8];
+char module_memb[16];
+
+#define FUNCTION(n)						\
+  int value##n;							\
+  int								\
+  function##n(void)						\
+  {								\
+    value##n += ((int (*)(void))random_rand)();			\
+    ((void (*)(void *, int))etimer_set)(module_timer, value##n); \
+    ((int (*)(void *, int, void *))process_post)(module_process, \
+                                                 0x80, &value##n); \
+    ((void (*)(void *, void *))list_add)(module_list, &value##n); \
+    return ((int (*)(void *, void *))memb_free)(module_memb, &value##n); \
+  }
+
+#define FUNCTIONS(m)						\
+  FUNCTION(m##0) FUNCTION(m##1) FUNCTION(m##2) FUNCTION(m##3)	\
+  FUNCTION(m##4) FUNCTION(m##5) FUNCTION(m##6) FUNCTION(m##7)	\
+  FUNCTION(m##8) FUNCTION(m##9)
+
+#define ENTRIES(m)						\
+  function##m##0, function##m##1, function##m##2, function##m##3, \
+  function##m##4, function##m##5, function##m##6, function##m##7, \
+  function##m##8, function##m##9,
+
+FUNCTIONS(1) FUNCTIONS(2) FUNCTIONS(3) FUNCTIONS(4) FUNCTIONS(5)
+FUNCTIONS(6) FUNCTIONS(7) FUNCTIONS(8) FUNCTIONS(9) FUNCTIONS(10)
+FUNCTIONS(11) FUNCTIONS(12) FUNCTIONS(13) FUNCTIONS(14) FUNCTIONS(15)
+FUNCTIONS(16) FUNCTIONS(17) FUNCTIONS(18) FUNCTIONS(19) FUNCTIONS(20)
+
+int (* const functions[])(void) = {
+  ENTRIES(1) ENTRIES(2) ENTRIES(3) ENTRIES(4) ENTRIES(5)
+  ENTRIES(6) ENTRIES(7) ENTRIES(8) ENTRIES(9) ENTRIES(10)
+  ENTRIES(11) ENTRIES(12) ENTRIES(13) ENTRIES(14) ENTRIES(15)
+  ENTRIES(16) ENTRIES(17) ENTRIES(18) ENTRIES(19) ENTRIES(20)
+};
+
+void * const autostart_processes[] = { module_process, 0 };
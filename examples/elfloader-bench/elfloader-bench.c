@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the ELF loader. It loads bench-module.ce,
+ *         and bench-module.celf if CELF modules are enabled, ROUNDS
+ *         times each from a fresh copy, and prints the time and the
+ *         number of cfs_read() calls per load.
+ *
+ *         The module imports core symbols, so the symbol table of the
+ *         core must be built in a second pass:
+ *
+ *           make
+ *           make CORE=elfloader-bench.native elfloader-bench.native
+ *
+ *         Compile with DEFINES=ELFLOADER_CONF_READ_BUFFER_SIZE=256,
+ *         ELFLOADER_CONF_SYMBOL_CACHE_SIZE=1024,SYMTAB_CONF_HASH_SIZE=4096
+ *         and ELFLOADER_CONF_CELF=1 to compare the options of the
+ *         loader. Building the module needs a compiler that
+ *         supports -m32.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "loader/elfloader.h"
+#include "loader/symbols.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+PROCESS(elfloader_bench_process, "ELF loader benchmark");
+AUTOSTART_PROCESSES(&elfloader_bench_process);
+
+#define ROUNDS		20
+#define COPY		"bench-module.tmp"
+
+static unsigned long reads;
+/*---------------------------------------------------------------------------*/
+int __real_cfs_read(int fd, void *buf, unsigned int len);
+
+int
+__wrap_cfs_read(int fd, void *buf, unsigned int len)
+{
+  reads++;
+  return __real_cfs_read(fd, buf, len);
+}
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+/* The loader writes the relocated values into the file, so every
+   load starts from a fresh copy. */
+static int
+copy_module(const char *name)
+{
+  static char buf[1024];
+  int from, to, len;
+
+  from = cfs_open(name, CFS_READ);
+  if(from < 0) {
+    return -1;
+  }
+  to = cfs_open(COPY, CFS_READ | CFS_WRITE);
+  if(to < 0) {
+    cfs_close(from);
+    return -1;
+  }
+  while((len = __real_cfs_read(from, buf, sizeof(buf))) > 0) {
+    cfs_write(to, buf, len);
+  }
+  cfs_close(from);
+  cfs_seek(to, 0, CFS_SEEK_SET);
+  return to;
+}
+/*---------------------------------------------------------------------------*/
+static void
+load(const char *name)
+{
+  int fd, i, ret;
+  double t;
+
+  t = 0;
+  reads = 0;
+  for(i = 0; i < ROUNDS; i++) {
+    fd = copy_module(name);
+    if(fd < 0) {
+      printf("%s: could not be opened\n", name);
+      exit(1);
+    }
+    t -= now();
+    ret = elfloader_load(fd);
+    t += now();
+    cfs_close(fd);
+    if(ret != ELFLOADER_OK) {
+      printf("%s: load failed with %d, symbol '%s'\n",
+             name, ret, elfloader_unknown);
+      exit(1);
+    }
+  }
+  cfs_remove(COPY);
+
+  printf("%s: %.2f ms and %lu cfs_read calls per load\n",
+         name, t / ROUNDS * 1000, reads / ROUNDS);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(elfloader_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("%d core symbols\n", symbols_nelts);
+  load("bench-module.ce");
+#if ELFLOADER_CELF
+  load("bench-module.celf");
+#endif /* ELFLOADER_CELF */
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -282,7 +282,9 @@ serial_input(FILE *inslip)
 
 unsigned char slip_buf[2048];
 int slip_end, slip_begin, slip_packet_end, slip_packet_count;
-static struct timer send_delay_timer;
+/* A callback timer, as its expiry must wake up the main loop so that
+   the next packet is flushed. */
+static struct ctimer send_delay_timer;
 /* delay between slip packets */
 static clock_time_t send_delay = SEND_DELAY;
 /*---------------------------------------------------------------------------*/
@@ -345,7 +347,7 @@ slip_flushbuf(int fd)
         }
         /* a delay between slip packets to avoid losing data */
         if(send_delay > 0) {
-          timer_set(&send_delay_timer, send_delay);
+          ctimer_set(&send_delay_timer, send_delay, NULL, NULL);
         }
       }
     }
@@ -463,7 +465,7 @@ static int
 set_fd(fd_set *rset, fd_set *wset)
 {
   /* Anything to flush? */
-  if(!slip_empty() && (send_delay == 0 || timer_expired(&send_delay_timer))) {
+  if(!slip_empty() && (send_delay == 0 || ctimer_expired(&send_delay_timer))) {
     FD_SET(slipfd, wset);
   }
 
@@ -536,7 +538,6 @@ slip_init(void)
     stty_telos(slipfd);
   }
 
-  timer_set(&send_delay_timer, 0);
   slip_send(slipfd, SLIP_END);
   inslip = fdopen(slipfd, "r");
   if(inslip == NULL) {
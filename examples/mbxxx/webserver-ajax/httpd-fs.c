@@ -80,6 +80,7 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
     if(httpd_fs_strcmp(name, f->name) == 0) {
       file->data = f->data;
       file->len = f->len - 1;
+      file->hdr = NULL;
 #if HTTPD_FS_STATISTICS
       ++count[i];
 #endif /* HTTPD_FS_STATISTICS */
@@ -93,6 +94,13 @@ httpd_fs_open(const char *name, struct httpd_fs_file *file)
   return 0;
 }
 /*-----------------------------------------------------------------------------------*/
+int
+httpd_fs_open_gzip(const char *name, struct httpd_fs_file *file)
+{
+  /* There are no gzip-compressed variants of these files. */
+  return httpd_fs_open(name, file);
+}
+/*-----------------------------------------------------------------------------------*/
 void
 httpd_fs_init(void)
 {
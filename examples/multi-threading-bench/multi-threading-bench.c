@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the native multi-threading implementation. It
+ *         starts a number of threads, switches between them, and
+ *         prints the thread switches per second. On Linux, it also
+ *         prints the memory each thread takes and the deepest stack
+ *         use of any thread.
+ *
+ *         The memory per thread counts the heap used by starting the
+ *         threads, the share of the static stack pool, if any, and
+ *         the struct mt_thread itself. Compile with
+ *         DEFINES=MTARCH_CONF_FAST_SWITCH=1,MTARCH_CONF_STACK_POOL=64
+ *         and MTARCH_STACKSIZE set to compare against the default
+ *         implementation.
+ */
+
+#include "contiki.h"
+#include "sys/mt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#if defined(__linux)
+#include <malloc.h>
+#endif /* __linux */
+
+PROCESS(mt_bench_process, "Multi-threading benchmark");
+AUTOSTART_PROCESSES(&mt_bench_process);
+
+#define THREADS   64
+#define SWITCHES  2000000L
+
+static struct mt_thread threads[THREADS];
+static unsigned long yields;
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+#if defined(__linux)
+static long
+thread_memory(size_t heap_before)
+{
+  long bytes;
+
+  bytes = (long)(mallinfo2().uordblks - heap_before) / THREADS;
+#ifdef MTARCH_CONF_STACK_POOL
+  /* The pool is an array, so consecutive threads get adjacent
+     entries. */
+  bytes += (long)MTARCH_CONF_STACK_POOL *
+    ((char *)threads[1].thread.mt_thread -
+     (char *)threads[0].thread.mt_thread) / THREADS;
+#endif /* MTARCH_CONF_STACK_POOL */
+  return bytes + sizeof(struct mt_thread);
+}
+#endif /* __linux */
+/*---------------------------------------------------------------------------*/
+/* Uses some stack, so that threads do not all stop at the same depth. */
+static int
+recurse(int n)
+{
+  volatile char buf[64];
+
+  buf[0] = n;
+  if(n > 0) {
+    return recurse(n - 1) + buf[0];
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+thread_main(void *data)
+{
+  recurse((int)(long)data % 8);
+  while(1) {
+    yields++;
+    mt_yield();
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mt_bench_process, ev, data)
+{
+  static double t;
+  static long i;
+#if defined(__linux)
+  static size_t before;
+  int usage, max;
+#endif /* __linux */
+
+  PROCESS_BEGIN();
+
+  mt_init();
+
+#if defined(__linux)
+  before = mallinfo2().uordblks;
+#endif /* __linux */
+  for(i = 0; i < THREADS; i++) {
+    mt_start(&threads[i], thread_main, (void *)i);
+  }
+#if defined(__linux)
+  printf("Memory per thread: %ld bytes\n", thread_memory(before));
+#endif /* __linux */
+
+  t = now();
+  for(i = 0; i < SWITCHES; i++) {
+    mt_exec(&threads[i % THREADS]);
+  }
+  t = now() - t;
+  printf("Switches: %.0f/s (%lu yields)\n", SWITCHES / t, yields);
+
+#if defined(__linux)
+  max = 0;
+  for(i = 0; i < THREADS; i++) {
+    usage = mtarch_stack_usage(&threads[i]);
+    if(usage > max) {
+      max = usage;
+    }
+  }
+  printf("Deepest stack use: %d bytes\n", max);
+#endif /* __linux */
+
+  for(i = 0; i < THREADS; i++) {
+    mt_stop(&threads[i]);
+  }
+  mt_remove();
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
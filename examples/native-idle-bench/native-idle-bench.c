@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the idle behaviour of the native main loop.
+ *         It runs a periodic event timer for SECONDS seconds, counts
+ *         the lines that arrive on stdin, and then prints how often
+ *         the process woke up, the CPU time it used and how late the
+ *         timer was at most.
+ *
+ *         Wake-ups are counted as voluntary context switches. Feed
+ *         stdin from a slow pipe, for instance with
+ *         (while sleep 1; do echo line; done) | ./native-idle-bench.native,
+ *         or redirect it from /dev/null to check the behaviour at end
+ *         of file. Compile with DEFINES=SELECT_CONF_EPOLL=0 to measure
+ *         the select() loop.
+ */
+
+#include "contiki.h"
+#include "dev/serial-line.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+PROCESS(native_idle_bench_process, "Native idle benchmark");
+AUTOSTART_PROCESSES(&native_idle_bench_process);
+
+#define SECONDS		10
+#define INTERVAL	(CLOCK_SECOND / 10)
+/*---------------------------------------------------------------------------*/
+static long
+cpu_ms(const struct rusage *ru)
+{
+  return (ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000L +
+    (ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) / 1000;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(native_idle_bench_process, ev, data)
+{
+  static struct etimer et;
+  static struct rusage start;
+  static clock_time_t late;
+  static long ticks, lines;
+  struct rusage end;
+  clock_time_t now;
+
+  PROCESS_BEGIN();
+
+  getrusage(RUSAGE_SELF, &start);
+  etimer_set(&et, INTERVAL);
+
+  while(ticks < SECONDS * CLOCK_SECOND / INTERVAL) {
+    PROCESS_WAIT_EVENT();
+    if(ev == PROCESS_EVENT_TIMER && data == &et) {
+      now = clock_time();
+      if(now - etimer_expiration_time(&et) > late) {
+        late = now - etimer_expiration_time(&et);
+      }
+      ticks++;
+      etimer_reset(&et);
+    } else if(ev == serial_line_event_message) {
+      lines++;
+    }
+  }
+
+  getrusage(RUSAGE_SELF, &end);
+  printf("%d s, %ld timer events, %ld lines: %ld wakeups/s, "
+         "%ld ms CPU, timer up to %lu ms late\n",
+         SECONDS, ticks, lines,
+         (end.ru_nvcsw - start.ru_nvcsw) / SECONDS,
+         cpu_ms(&end) - cpu_ms(&start),
+         (unsigned long)(late * 1000 / CLOCK_SECOND));
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
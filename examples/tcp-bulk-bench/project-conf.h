@@ -0,0 +1,16 @@
+/* The node talks to the host over an Ethernet TAP interface, with
+   segments of a typical Ethernet MSS. */
+#undef UIP_CONF_LLH_LEN
+#define UIP_CONF_LLH_LEN		14
+#undef UIP_CONF_LL_802154
+#define UIP_CONF_LL_802154		0
+#undef UIP_CONF_BUFFER_SIZE
+#define UIP_CONF_BUFFER_SIZE		1280
+#undef UIP_CONF_TCP_MSS
+#define UIP_CONF_TCP_MSS		1200
+#undef UIP_CONF_RECEIVE_WINDOW
+#define UIP_CONF_RECEIVE_WINDOW		1200
+#undef UIP_CONF_ROUTER
+#define UIP_CONF_ROUTER			0
+#undef UIP_CONF_IPV6_RPL
+#define UIP_CONF_IPV6_RPL		0
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of bulk TCP transfers from uIP. The node listens
+ *         on port 8080 of fc00::2 on the TAP interface of the native
+ *         platform and sends TOTAL bytes to each client that
+ *         connects. It prints the transfer rate once everything has
+ *         been acknowledged. The stream is the bytes 0 ... 255,
+ *         repeated, so that the client can check it.
+ *
+ *         Outgoing frames can be delayed by DELAY clock ticks, and
+ *         full-sized segments dropped with a probability of LOSS
+ *         percent, to emulate a slower link. Compile with
+ *         DEFINES=UIP_CONF_TCP_SEND_WINDOW=8,DELAY=20 to measure a
+ *         send window of eight segments with 20 ms added delay.
+ *
+ *         Run as root, bring tap0 up with the address fc00::1/64,
+ *         and connect from the host, for instance with
+ *         nc fc00::2 8080 > /dev/null.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/uip-ds6.h"
+#include "tapdev-drv.h"
+#include "tapdev6.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+PROCESS(tcp_bulk_bench_process, "TCP bulk transfer benchmark");
+PROCESS(delay_process, "Link delay");
+AUTOSTART_PROCESSES(&tcp_bulk_bench_process, &delay_process);
+
+#ifndef TOTAL
+#define TOTAL		(256L * 1024L)
+#endif
+#ifndef DELAY
+#define DELAY		0
+#endif
+#ifndef LOSS
+#define LOSS		0
+#endif
+
+/* The number of frames that can be delayed at the same time. */
+#define QUEUE_SIZE	64
+
+static struct {
+  clock_time_t due;
+  uint16_t len;
+  uint8_t has_lladdr;
+  uip_lladdr_t lladdr;
+  uint8_t buf[UIP_BUFSIZE];
+} queue[QUEUE_SIZE];
+static int queue_head, queue_tail;
+
+static uint8_t block[4096];
+static struct psock ps;
+static uint8_t inbuf[8];
+static long sent;
+static double start;
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+static int
+set_fd(fd_set *rset, fd_set *wset)
+{
+  FD_SET(tapdev_fd(), rset);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_fd(fd_set *rset, fd_set *wset)
+{
+  if(FD_ISSET(tapdev_fd(), rset)) {
+    process_poll(&tapdev_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static const struct select_callback tap_fd = { set_fd, handle_fd };
+/*---------------------------------------------------------------------------*/
+/* The output function of the stack, which queues the frame until it
+   is due. */
+static uint8_t
+delay_send(const uip_lladdr_t *lladdr)
+{
+  if((queue_tail + 1) % QUEUE_SIZE == queue_head) {
+    return 0;
+  }
+  if(LOSS > 0 && uip_len > UIP_TCP_MSS && random() % 100 < LOSS) {
+    return 0;
+  }
+  queue[queue_tail].due = clock_time() + DELAY;
+  queue[queue_tail].len = uip_len;
+  queue[queue_tail].has_lladdr = lladdr != NULL;
+  if(lladdr != NULL) {
+    queue[queue_tail].lladdr = *lladdr;
+  }
+  memcpy(queue[queue_tail].buf, uip_buf, uip_len + UIP_LLH_LEN);
+  queue_tail = (queue_tail + 1) % QUEUE_SIZE;
+  process_poll(&delay_process);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(delay_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    while(queue_head != queue_tail &&
+          queue[queue_head].due <= clock_time()) {
+      memcpy(uip_buf, queue[queue_head].buf,
+             queue[queue_head].len + UIP_LLH_LEN);
+      uip_len = queue[queue_head].len;
+      tapdev_send(queue[queue_head].has_lladdr ?
+                  &queue[queue_head].lladdr : NULL);
+      uip_len = 0;
+      queue_head = (queue_head + 1) % QUEUE_SIZE;
+    }
+    if(queue_head != queue_tail) {
+      etimer_set(&et, queue[queue_head].due - clock_time());
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et) ||
+                               ev == PROCESS_EVENT_POLL);
+    } else {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(send_data(struct psock *p))
+{
+  PSOCK_BEGIN(p);
+
+  for(sent = 0; sent < TOTAL; sent += sizeof(block)) {
+    PSOCK_SEND(p, block, sizeof(block));
+  }
+  PSOCK_CLOSE(p);
+
+  PSOCK_END(p);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tcp_bulk_bench_process, ev, data)
+{
+  static uip_ipaddr_t addr;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < sizeof(block); i++) {
+    block[i] = i;
+  }
+
+  /* The TAP driver sets itself as the output function when it
+     starts, so the delay queue is put in front of it afterwards. */
+  process_start(&tapdev_process, NULL);
+  tcpip_set_outputfunc(delay_send);
+  select_set_callback(tapdev_fd(), &tap_fd);
+
+  uip_ip6addr(&addr, 0xfc00, 0, 0, 0, 0, 0, 0, 2);
+  uip_ds6_addr_add(&addr, 0, ADDR_MANUAL);
+  uip_ds6_prefix_add(&addr, 64, 0);
+  tcp_listen(UIP_HTONS(8080));
+  printf("Listening on port 8080, send window %d\n", UIP_TCP_SEND_WINDOW);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == tcpip_event);
+    if(uip_connected()) {
+      PSOCK_INIT(&ps, inbuf, sizeof(inbuf));
+      start = now();
+    }
+    if(uip_closed()) {
+      printf("Sent %ld bytes in %.2f s: %.0f kB/s\n",
+             sent, now() - start, sent / (now() - start) / 1024);
+    } else if(uip_aborted() || uip_timedout()) {
+      printf("The connection was lost after %ld bytes\n", sent);
+    } else {
+      send_data(&ps);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
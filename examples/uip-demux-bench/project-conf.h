@@ -0,0 +1,10 @@
+/* The number of open connections, which is set with
+   DEFINES=CONNECTIONS=n. */
+#ifndef CONNECTIONS
+#define CONNECTIONS			200
+#endif
+#undef UIP_CONF_MAX_CONNECTIONS
+#define UIP_CONF_MAX_CONNECTIONS	CONNECTIONS
+
+#undef UIP_CONF_IPV6_RPL
+#define UIP_CONF_IPV6_RPL		0
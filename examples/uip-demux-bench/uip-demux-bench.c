@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A benchmark of the connection lookup of incoming TCP
+ *         segments in uIP. It opens UIP_CONNS connections to different
+ *         peers, marks them as established, and then feeds ACK-only
+ *         segments through uip_input() in a pseudo-random order over
+ *         the connections. It prints the best rate of ROUNDS rounds.
+ *
+ *         Each segment acknowledges nothing new, so it must be
+ *         matched to its connection without any reply. A segment that
+ *         produces output was not matched and is counted.
+ *
+ *         Compile with DEFINES=CONNECTIONS=n,UIP_CONF_CONN_HASH=m to
+ *         set the number of connections and of hash buckets.
+ */
+
+#include "contiki.h"
+#include "contiki-net.h"
+#include "net/uip-ds6.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+PROCESS(uip_demux_bench_process, "uIP demultiplexing benchmark");
+AUTOSTART_PROCESSES(&uip_demux_bench_process);
+
+#define SEGMENTS	2000000L
+#define ROUNDS		3
+
+#define IPBUF ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static uint8_t segments[UIP_CONNS][UIP_IPTCPH_LEN];
+/*---------------------------------------------------------------------------*/
+static double
+now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+/*---------------------------------------------------------------------------*/
+/* Opens an established connection to a peer and builds an ACK-only
+   segment from that peer into segments[i]. */
+static void
+open_connection(int i)
+{
+  uip_ds6_addr_t *lladdr;
+  uip_ipaddr_t peer;
+  struct uip_conn *conn;
+
+  lladdr = uip_ds6_get_link_local(-1);
+  uip_ip6addr(&peer, 0xfe80, 0, 0, 0, 0x200, 0, 0x1000 + (i >> 8), i);
+  conn = uip_connect(&peer, UIP_HTONS(1000 + i));
+  if(conn == NULL) {
+    printf("Failed to open connection %d\n", i);
+    exit(1);
+  }
+  conn->tcpstateflags = UIP_ESTABLISHED;
+  conn->len = 0;
+  memset(conn->rcv_nxt, 0, sizeof(conn->rcv_nxt));
+  conn->rcv_nxt[3] = 1;
+
+  memset(uip_buf, 0, UIP_LLH_LEN + UIP_IPTCPH_LEN);
+  IPBUF->vtc = 0x60;
+  IPBUF->len[1] = UIP_TCPH_LEN;
+  IPBUF->proto = UIP_PROTO_TCP;
+  IPBUF->ttl = 64;
+  uip_ipaddr_copy(&IPBUF->srcipaddr, &peer);
+  uip_ipaddr_copy(&IPBUF->destipaddr, &lladdr->ipaddr);
+  IPBUF->srcport = conn->rport;
+  IPBUF->destport = conn->lport;
+  memcpy(IPBUF->seqno, conn->rcv_nxt, sizeof(IPBUF->seqno));
+  memcpy(IPBUF->ackno, conn->snd_nxt, sizeof(IPBUF->ackno));
+  IPBUF->tcpoffset = 5 << 4;
+  /* ACK */
+  IPBUF->flags = 0x10;
+  IPBUF->wnd[0] = 4;
+  uip_len = UIP_IPTCPH_LEN;
+  uip_ext_len = 0;
+  IPBUF->tcpchksum = ~(uip_tcpchksum());
+  memcpy(segments[i], &uip_buf[UIP_LLH_LEN], UIP_IPTCPH_LEN);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(uip_demux_bench_process, ev, data)
+{
+  static struct etimer et;
+  long i, round, unmatched;
+  double t, best;
+
+  PROCESS_BEGIN();
+
+  /* Let the stack start before the connections are opened. */
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  for(i = 0; i < UIP_CONNS; i++) {
+    open_connection(i);
+  }
+
+  best = 0;
+  unmatched = 0;
+  for(round = 0; round < ROUNDS; round++) {
+    t = now();
+    for(i = 0; i < SEGMENTS; i++) {
+      memcpy(&uip_buf[UIP_LLH_LEN], segments[(i * 7919) % UIP_CONNS],
+             UIP_IPTCPH_LEN);
+      uip_len = UIP_IPTCPH_LEN;
+      uip_input();
+      if(uip_len != 0) {
+        unmatched++;
+      }
+    }
+    t = now() - t;
+    if(best == 0 || t < best) {
+      best = t;
+    }
+  }
+
+  printf("%d connections, %d hash buckets: %.0f segments/s, "
+         "%ld unmatched\n", UIP_CONNS, UIP_CONN_HASH, SEGMENTS / best,
+         unmatched);
+  exit(unmatched != 0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
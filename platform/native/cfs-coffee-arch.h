@@ -56,6 +56,21 @@
 #define COFFEE_LOG_TABLE_LIMIT		256
 #define COFFEE_MICRO_LOGS		0
 #define COFFEE_IO_SEMANTICS		1
+#ifdef COFFEE_CONF_INCREMENTAL_GC
+#define COFFEE_INCREMENTAL_GC		COFFEE_CONF_INCREMENTAL_GC
+#else
+#define COFFEE_INCREMENTAL_GC		1
+#endif
+#ifdef COFFEE_CONF_WEAR_LEVELLING_ALLOCATOR
+#define COFFEE_WEAR_LEVELLING_ALLOCATOR	COFFEE_CONF_WEAR_LEVELLING_ALLOCATOR
+#else
+#define COFFEE_WEAR_LEVELLING_ALLOCATOR	COFFEE_INCREMENTAL_GC
+#endif
+#ifdef COFFEE_CONF_IOV_BUFFER_SIZE
+#define COFFEE_IOV_BUFFER_SIZE		COFFEE_CONF_IOV_BUFFER_SIZE
+#else
+#define COFFEE_IOV_BUFFER_SIZE		COFFEE_PAGE_SIZE
+#endif
 
 #define COFFEE_WRITE(buf, size, offset)				\
 		xmem_pwrite((char *)(buf), (size), COFFEE_START + (offset))
@@ -66,6 +81,12 @@
 #define COFFEE_ERASE(sector)					\
   		xmem_erase(COFFEE_SECTOR_SIZE, COFFEE_START + (sector) * COFFEE_SECTOR_SIZE)
 
+/* The emulated flash memory can be accessed directly. */
+#define COFFEE_MAP(offset)					\
+		xmem_map(COFFEE_START + (offset))
+
+const void *xmem_map(unsigned long offset);
+
 #define READ_HEADER(hdr, page)						\
   COFFEE_READ((hdr), sizeof (*hdr), (page) * COFFEE_PAGE_SIZE)
 
@@ -66,9 +66,34 @@
 #define SELECT_MAX 8
 #endif
 
+/* Wait for file descriptors with epoll instead of select(). The
+   callbacks still see fd_sets, but the descriptors are only
+   re-registered when the set they ask for changes. */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#elif defined(__linux__)
+#define SELECT_EPOLL 1
+#else
+#define SELECT_EPOLL 0
+#endif
+
+#if SELECT_EPOLL
+#include <errno.h>
+#include <sys/epoll.h>
+#endif /* SELECT_EPOLL */
+
 static const struct select_callback *select_callback[SELECT_MAX];
 static int select_max = 0;
 
+#if SELECT_EPOLL
+static int epoll_fd = -1;
+/* The events each descriptor is registered for with epoll. */
+static uint32_t select_events[SELECT_MAX];
+/* Descriptors epoll refuses, such as regular files. Like select(), we
+   treat them as always ready. */
+static uint8_t select_always[SELECT_MAX];
+#endif /* SELECT_EPOLL */
+
 SENSORS(&pir_sensor, &vib_sensor, &button_sensor);
 
 static uint8_t serial_id[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08};
@@ -87,6 +112,16 @@ select_set_callback(int fd, const struct select_callback *callback)
 
     select_callback[fd] = callback;
 
+#if SELECT_EPOLL
+    /* The descriptor is added again with the events its new callback
+       asks for. */
+    if(select_events[fd] != 0 && !select_always[fd]) {
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    select_events[fd] = 0;
+    select_always[fd] = 0;
+#endif /* SELECT_EPOLL */
+
     /* Update fd max */
     if(callback != NULL) {
       if(fd > select_max) {
@@ -116,9 +151,15 @@ static void
 stdin_handle_fd(fd_set *rset, fd_set *wset)
 {
   char c;
+  int n;
   if(FD_ISSET(STDIN_FILENO, rset)) {
-    if(read(STDIN_FILENO, &c, 1) > 0) {
+    n = read(STDIN_FILENO, &c, 1);
+    if(n > 0) {
       serial_line_input_byte(c);
+    } else if(n == 0) {
+      /* End of file: stop waking up for a descriptor that is always
+         readable. */
+      select_set_callback(STDIN_FILENO, NULL);
     }
   }
 }
@@ -154,6 +195,162 @@ set_rime_addr(void)
 }
 
 
+/*---------------------------------------------------------------------------*/
+/* Milliseconds to sleep before the next event timer is due, 0 if
+   there is more to do right away and -1 if nothing is scheduled. */
+static int
+select_timeout(int pending)
+{
+#if WITH_GUI
+  /* The console is not woken up by a descriptor. */
+  return pending ? 0 : 1;
+#else /* WITH_GUI */
+  long left;
+
+  if(pending) {
+    return 0;
+  }
+  if(!etimer_pending()) {
+    return -1;
+  }
+  left = (long)(etimer_next_expiration_time() - clock_time());
+  if(left <= 0) {
+    return 0;
+  }
+  /* Round up, so that the timer has expired when the wait ends. */
+  return (left * 1000 + CLOCK_SECOND - 1) / CLOCK_SECOND;
+#endif /* WITH_GUI */
+}
+/*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+static void
+select_wait(int timeout)
+{
+  struct epoll_event events[SELECT_MAX];
+  struct epoll_event ev;
+  fd_set fdr;
+  fd_set fdw;
+  uint8_t ready[SELECT_MAX];
+  uint32_t want;
+  int maxfd;
+  int n;
+  int i;
+
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  maxfd = -1;
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
+      maxfd = i;
+    }
+  }
+
+  /* Bring the registrations in line with what the callbacks asked
+     for. This only makes a system call when a set changes. */
+  memset(ready, 0, sizeof(ready));
+  for(i = 0; i <= maxfd; i++) {
+    want = (FD_ISSET(i, &fdr) ? EPOLLIN : 0) | (FD_ISSET(i, &fdw) ? EPOLLOUT : 0);
+    if(select_always[i]) {
+      select_events[i] = want;
+      if(want != 0) {
+        ready[i] = 1;
+        timeout = 0;
+      }
+      continue;
+    }
+    if(want == select_events[i]) {
+      continue;
+    }
+    ev.events = want;
+    ev.data.fd = i;
+    if(want == 0) {
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, i, NULL);
+    } else if(epoll_ctl(epoll_fd, select_events[i] == 0 ?
+                        EPOLL_CTL_ADD : EPOLL_CTL_MOD, i, &ev) < 0) {
+      if(errno == EPERM) {
+        select_always[i] = 1;
+        ready[i] = 1;
+        timeout = 0;
+      } else {
+        perror("epoll_ctl");
+        want = 0;
+      }
+    }
+    select_events[i] = want;
+  }
+
+  n = epoll_wait(epoll_fd, events, SELECT_MAX, timeout);
+  if(n < 0 && errno != EINTR) {
+    perror("epoll_wait");
+  }
+  for(i = 0; i < n; i++) {
+    if(events[i].data.fd < SELECT_MAX) {
+      ready[events[i].data.fd] = 1;
+    }
+  }
+
+  /* Hand the callbacks fd_sets holding only the ready descriptors. */
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  for(i = 0; i < n; i++) {
+    if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      FD_SET(events[i].data.fd, &fdr);
+    }
+    if(events[i].events & (EPOLLOUT | EPOLLERR)) {
+      FD_SET(events[i].data.fd, &fdw);
+    }
+  }
+  for(i = 0; i <= maxfd; i++) {
+    if(select_always[i] && ready[i]) {
+      if(select_events[i] & EPOLLIN) {
+        FD_SET(i, &fdr);
+      }
+      if(select_events[i] & EPOLLOUT) {
+        FD_SET(i, &fdw);
+      }
+    }
+  }
+  for(i = 0; i <= maxfd; i++) {
+    if(ready[i] && select_callback[i] != NULL) {
+      select_callback[i]->handle_fd(&fdr, &fdw);
+    }
+  }
+}
+#else /* SELECT_EPOLL */
+static void
+select_wait(int timeout)
+{
+  fd_set fdr;
+  fd_set fdw;
+  int maxfd;
+  int i;
+  int retval;
+  struct timeval tv;
+
+  FD_ZERO(&fdr);
+  FD_ZERO(&fdw);
+  maxfd = 0;
+  for(i = 0; i <= select_max; i++) {
+    if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
+      maxfd = i;
+    }
+  }
+
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = (timeout % 1000) * 1000;
+  retval = select(maxfd + 1, &fdr, &fdw, NULL, timeout < 0 ? NULL : &tv);
+  if(retval < 0) {
+    perror("select");
+  } else if(retval > 0) {
+    /* timeout => retval == 0 */
+    for(i = 0; i <= maxfd; i++) {
+      if(select_callback[i] != NULL) {
+        select_callback[i]->handle_fd(&fdr, &fdw);
+      }
+    }
+  }
+}
+#endif /* SELECT_EPOLL */
 /*---------------------------------------------------------------------------*/
 int contiki_argc = 0;
 char **contiki_argv;
@@ -187,6 +384,14 @@ main(int argc, char **argv)
 #endif
 #endif
 
+#if SELECT_EPOLL
+  epoll_fd = epoll_create(SELECT_MAX);
+  if(epoll_fd < 0) {
+    perror("epoll_create");
+    return 1;
+  }
+#endif /* SELECT_EPOLL */
+
   process_init();
   process_start(&etimer_process, NULL);
   ctimer_init();
@@ -236,41 +441,19 @@ main(int argc, char **argv)
 
   select_set_callback(STDIN_FILENO, &stdin_fd);
   while(1) {
-    fd_set fdr;
-    fd_set fdw;
-    int maxfd;
-    int i;
     int retval;
-    struct timeval tv;
 
     retval = process_run();
 
-    tv.tv_sec = 0;
-    tv.tv_usec = retval ? 1 : 1000;
-
-    FD_ZERO(&fdr);
-    FD_ZERO(&fdw);
-    maxfd = 0;
-    for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
-        maxfd = i;
-      }
-    }
+    /* Sleep until a descriptor is ready or the next event timer is
+       due, then let the timer process run if one is. */
+    select_wait(select_timeout(retval));
 
-    retval = select(maxfd + 1, &fdr, &fdw, NULL, &tv);
-    if(retval < 0) {
-      perror("select");
-    } else if(retval > 0) {
-      /* timeout => retval == 0 */
-      for(i = 0; i <= maxfd; i++) {
-        if(select_callback[i] != NULL) {
-          select_callback[i]->handle_fd(&fdr, &fdw);
-        }
-      }
+    if(etimer_pending() &&
+       (long)(etimer_next_expiration_time() - clock_time()) <= 0) {
+      etimer_request_poll();
     }
 
-    etimer_request_poll();
-
 #if WITH_GUI
     if(console_resize()) {
        ctk_restore();
@@ -25,7 +25,8 @@
       <identifier>sky1</identifier>
       <description>shell</description>
       <source EXPORT="discard">[CONTIKI_DIR]/examples/collect/collect-view-shell.c</source>
-      <commands EXPORT="discard">make collect-view-shell.sky TARGET=sky</commands>
+      <commands EXPORT="discard">make clean TARGET=sky
+make collect-view-shell.sky TARGET=sky</commands>
       <firmware EXPORT="copy">[CONTIKI_DIR]/examples/collect/collect-view-shell.sky</firmware>
       <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
       <moteinterface>org.contikios.cooja.interfaces.RimeAddress</moteinterface>
@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2026, Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/*
+ * Converts an ELF module into a compact ELF (CELF) module that is
+ * loaded with core/loader/celfloader.c, see celfloader.h.
+ *
+ * The sections of the module are merged into the text, rodata, data
+ * and bss segments, COMMON symbols are allocated in the bss segment,
+ * and every relocation against a symbol that is defined in the module
+ * is turned into a relocation against a segment. Only the symbols
+ * that the module imports keep their names. The relocations are
+ * grouped by target and sorted by offset.
+ *
+ * Usage: elf2celf [-v] module.ce module.celf
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "loader/celfloader.h"
+
+#define SHT_SYMTAB 2
+#define SHT_RELA   4
+#define SHT_NOBITS 8
+#define SHT_REL    9
+#define SHF_ALLOC  2
+
+#define SHN_UNDEF  0
+#define SHN_COMMON 0xfff2
+
+#define ELF32_R_SYM(info)  ((info) >> 8)
+#define ELF32_R_TYPE(info) ((uint8_t)(info))
+
+struct reloc {
+  int group;
+  struct celf_reloc r;
+};
+
+struct group {
+  int target;
+  const char *name;
+  int relocs;
+};
+
+static uint8_t *elf;
+static long elfsize;
+
+static uint8_t *segment[CELF_SEGMENTS];
+static uint32_t segment_size[CELF_SEGMENTS];
+static const char *segment_name[CELF_SEGMENTS] = {
+  ".text", ".rodata", ".data", ".bss"
+};
+
+static struct group *groups;
+static int ngroups;
+static struct reloc *relocs;
+static int nrelocs;
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *msg, const char *arg)
+{
+  fprintf(stderr, "elf2celf: %s%s\n", msg, arg);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get(uint32_t offset, int len)
+{
+  uint32_t v;
+
+  if(offset + len > elfsize) {
+    fail("truncated file", "");
+  }
+  for(v = 0; len > 0; --len) {
+    v = (v << 8) | elf[offset + len - 1];
+  }
+  return v;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put(FILE *f, uint32_t v, int len)
+{
+  for(; len > 0; --len, v >>= 8) {
+    putc(v & 0xff, f);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+shdr(int i, int field)
+{
+  return get(get(32, 4) + get(46, 2) * i + 4 * field, 4);
+}
+#define SH_NAME   0
+#define SH_TYPE   1
+#define SH_FLAGS  2
+#define SH_OFFSET 4
+#define SH_SIZE   5
+#define SH_LINK   6
+#define SH_INFO   7
+#define SH_ALIGN  8
+/*---------------------------------------------------------------------------*/
+static const char *
+string(uint32_t offset)
+{
+  if(offset >= elfsize || memchr(&elf[offset], 0, elfsize - offset) == NULL) {
+    fail("bad string table", "");
+  }
+  return (const char *)&elf[offset];
+}
+/*---------------------------------------------------------------------------*/
+static int
+prefix(const char *name, const char *p)
+{
+  return strncmp(name, p, strlen(p)) == 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+place(int seg, uint32_t size, uint32_t align)
+{
+  uint32_t offset;
+
+  if(align > 1) {
+    segment_size[seg] = (segment_size[seg] + align - 1) & ~(align - 1);
+  }
+  offset = segment_size[seg];
+  segment_size[seg] += size;
+  segment[seg] = realloc(segment[seg], segment_size[seg] + 1);
+  memset(segment[seg] + offset, 0, size);
+  return offset;
+}
+/*---------------------------------------------------------------------------*/
+static int
+find_group(int target, const char *name)
+{
+  int i;
+
+  for(i = 0; i < ngroups; ++i) {
+    if(groups[i].target == target &&
+       (name == NULL || strcmp(groups[i].name, name) == 0)) {
+      return i;
+    }
+  }
+  groups = realloc(groups, (ngroups + 1) * sizeof(struct group));
+  groups[ngroups].target = target;
+  groups[ngroups].name = name;
+  groups[ngroups].relocs = 0;
+  return ngroups++;
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare_groups(const void *a, const void *b)
+{
+  const struct group *ga = a, *gb = b;
+
+  if(ga->target != gb->target) {
+    return ga->target - gb->target;
+  }
+  return ga->name == NULL ? 0 : strcmp(ga->name, gb->name);
+}
+/*---------------------------------------------------------------------------*/
+static int *group_order;
+
+static int
+compare_relocs(const void *a, const void *b)
+{
+  const struct reloc *ra = a, *rb = b;
+
+  if(ra->group != rb->group) {
+    return group_order[ra->group] - group_order[rb->group];
+  }
+  if(ra->r.segment != rb->r.segment) {
+    return ra->r.segment - rb->r.segment;
+  }
+  return ra->r.offset - rb->r.offset;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  FILE *f;
+  int verbose, shnum, i, j, seg, imports;
+  int *section_segment;
+  uint32_t *section_base, *common_base;
+  uint32_t strs, symtab, symnum, strtab, sym, offset, entsize, info;
+  uint32_t value, autostart_offset;
+  int autostart_segment;
+  int32_t addend;
+  uint16_t shndx;
+  const char *name;
+  struct group *sorted;
+  long size;
+
+  verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  if(argc != 3 + verbose) {
+    fprintf(stderr, "usage: %s [-v] module.ce module.celf\n", argv[0]);
+    return 1;
+  }
+
+  f = fopen(argv[1 + verbose], "rb");
+  if(f == NULL) {
+    fail("cannot open ", argv[1 + verbose]);
+  }
+  fseek(f, 0, SEEK_END);
+  elfsize = ftell(f);
+  rewind(f);
+  elf = malloc(elfsize);
+  if(fread(elf, 1, elfsize, f) != elfsize) {
+    fail("cannot read ", argv[1 + verbose]);
+  }
+  fclose(f);
+
+  /* Only little-endian 32-bit relocatable files. */
+  if(elfsize < 52 || memcmp(elf, "\177ELF\001\001\001", 7) != 0 ||
+     get(16, 2) != 1) {
+    fail("not a 32-bit little-endian relocatable ELF file: ",
+	 argv[1 + verbose]);
+  }
+
+  shnum = get(48, 2);
+  strs = shdr(get(50, 2), SH_OFFSET);
+  section_segment = calloc(shnum, sizeof(int));
+  section_base = calloc(shnum, sizeof(uint32_t));
+
+  /* Merge the sections into the segments, in file order. */
+  symtab = symnum = strtab = 0;
+  for(i = 0; i < shnum; ++i) {
+    name = string(strs + shdr(i, SH_NAME));
+    section_segment[i] = -1;
+    if(shdr(i, SH_TYPE) == SHT_SYMTAB) {
+      symtab = shdr(i, SH_OFFSET);
+      symnum = shdr(i, SH_SIZE) / 16;
+      strtab = shdr(shdr(i, SH_LINK), SH_OFFSET);
+      continue;
+    }
+    if(!(shdr(i, SH_FLAGS) & SHF_ALLOC)) {
+      continue;
+    }
+    for(seg = 0; seg < CELF_SEGMENTS; ++seg) {
+      if(prefix(name, segment_name[seg])) {
+	break;
+      }
+    }
+    if(seg == CELF_SEGMENTS) {
+      if(verbose) {
+	fprintf(stderr, "elf2celf: ignoring section %s\n", name);
+      }
+      continue;
+    }
+    if((seg == CELF_BSS) != (shdr(i, SH_TYPE) == SHT_NOBITS)) {
+      fail("unexpected section type of ", name);
+    }
+    section_segment[i] = seg;
+    section_base[i] = place(seg, shdr(i, SH_SIZE), shdr(i, SH_ALIGN));
+    if(seg != CELF_BSS) {
+      memcpy(segment[seg] + section_base[i],
+	     &elf[shdr(i, SH_OFFSET)], shdr(i, SH_SIZE));
+    }
+  }
+  if(symtab == 0) {
+    fail("no symbol table", "");
+  }
+  if(segment_size[CELF_TEXT] == 0) {
+    fail("no text segment", "");
+  }
+
+  /* COMMON symbols are allocated in the bss segment. */
+  common_base = calloc(symnum, sizeof(uint32_t));
+  autostart_segment = CELF_IMPORT;
+  autostart_offset = 0;
+  for(sym = 0; sym < symnum; ++sym) {
+    shndx = get(symtab + sym * 16 + 14, 2);
+    value = get(symtab + sym * 16 + 4, 4);
+    name = string(strtab + get(symtab + sym * 16, 4));
+    if(shndx == SHN_COMMON) {
+      common_base[sym] = place(CELF_BSS, get(symtab + sym * 16 + 8, 4), value);
+      seg = CELF_BSS;
+      value = common_base[sym];
+    } else if(shndx < shnum && section_segment[shndx] >= 0) {
+      seg = section_segment[shndx];
+      value += section_base[shndx];
+    } else {
+      continue;
+    }
+    if(strcmp(name, "autostart_processes") == 0) {
+      autostart_segment = seg;
+      autostart_offset = value;
+    }
+  }
+
+  /* Collect the relocations of the segments. */
+  for(i = 0; i < shnum; ++i) {
+    if(shdr(i, SH_TYPE) != SHT_REL && shdr(i, SH_TYPE) != SHT_RELA) {
+      continue;
+    }
+    j = shdr(i, SH_INFO);
+    if(j >= shnum || section_segment[j] < 0) {
+      continue;
+    }
+    entsize = shdr(i, SH_TYPE) == SHT_RELA ? 12 : 8;
+    for(offset = shdr(i, SH_OFFSET);
+	offset < shdr(i, SH_OFFSET) + shdr(i, SH_SIZE);
+	offset += entsize) {
+      info = get(offset + 4, 4);
+      sym = ELF32_R_SYM(info);
+      if(sym >= symnum) {
+	fail("bad symbol index", "");
+      }
+      if(entsize == 12) {
+	addend = get(offset + 8, 4);
+      } else {
+	/* Like the ELF loader, read the addend from the location. */
+	addend = get(shdr(j, SH_OFFSET) + get(offset, 4), 4);
+      }
+
+      relocs = realloc(relocs, (nrelocs + 1) * sizeof(struct reloc));
+      relocs[nrelocs].r.segment = section_segment[j];
+      relocs[nrelocs].r.offset = section_base[j] + get(offset, 4);
+      relocs[nrelocs].r.type = ELF32_R_TYPE(info);
+      if(section_base[j] + get(offset, 4) > 0xffff) {
+	fail("relocation offset too large in ", string(strs + shdr(j, SH_NAME)));
+      }
+
+      shndx = get(symtab + sym * 16 + 14, 2);
+      value = get(symtab + sym * 16 + 4, 4);
+      name = string(strtab + get(symtab + sym * 16, 4));
+      if(shndx == SHN_UNDEF) {
+	if(*name == 0) {
+	  fail("relocation against an unnamed undefined symbol", "");
+	}
+	if(strlen(name) > CELF_NAME_MAX) {
+	  fail("name of imported symbol too long: ", name);
+	}
+	relocs[nrelocs].group = find_group(CELF_IMPORT, name);
+      } else if(shndx == SHN_COMMON) {
+	relocs[nrelocs].group = find_group(CELF_BSS, NULL);
+	addend += common_base[sym];
+      } else if(shndx < shnum && section_segment[shndx] >= 0) {
+	relocs[nrelocs].group = find_group(section_segment[shndx], NULL);
+	addend += section_base[shndx] + value;
+      } else {
+	fail("relocation against a symbol in an unknown section: ", name);
+      }
+      relocs[nrelocs].r.addend = addend;
+      groups[relocs[nrelocs].group].relocs++;
+      ++nrelocs;
+    }
+  }
+
+  for(seg = 0; seg < CELF_SEGMENTS; ++seg) {
+    if(segment_size[seg] > 0xffff) {
+      fail("segment too large: ", segment_name[seg]);
+    }
+  }
+
+  /* The segments first, then the imports by name. */
+  sorted = malloc((ngroups + 1) * sizeof(struct group));
+  memcpy(sorted, groups, ngroups * sizeof(struct group));
+  qsort(sorted, ngroups, sizeof(struct group), compare_groups);
+  group_order = malloc((ngroups + 1) * sizeof(int));
+  for(i = 0; i < ngroups; ++i) {
+    group_order[find_group(sorted[i].target, sorted[i].name)] = i;
+  }
+  qsort(relocs, nrelocs, sizeof(struct reloc), compare_relocs);
+
+  f = fopen(argv[2 + verbose], "wb");
+  if(f == NULL) {
+    fail("cannot create ", argv[2 + verbose]);
+  }
+  fwrite(CELF_MAGIC, 1, CELF_MAGIC_SIZE, f);
+  put(f, CELF_VERSION, 1);
+  put(f, autostart_segment, 1);
+  put(f, autostart_offset, 2);
+  for(seg = 0; seg < CELF_SEGMENTS; ++seg) {
+    put(f, segment_size[seg], 2);
+  }
+  put(f, ngroups, 2);
+  put(f, nrelocs, 2);
+  for(seg = 0; seg < CELF_BSS; ++seg) {
+    fwrite(segment[seg], 1, segment_size[seg], f);
+  }
+  imports = 0;
+  for(i = j = 0; i < ngroups; ++i) {
+    put(f, sorted[i].target, 1);
+    put(f, sorted[i].name == NULL ? 0 : strlen(sorted[i].name), 1);
+    put(f, sorted[i].relocs, 2);
+    if(sorted[i].name != NULL) {
+      fputs(sorted[i].name, f);
+      ++imports;
+    }
+    for(; j < nrelocs && group_order[relocs[j].group] == i; ++j) {
+      put(f, relocs[j].r.offset, 2);
+      put(f, relocs[j].r.segment, 1);
+      put(f, relocs[j].r.type, 1);
+      put(f, relocs[j].r.addend, 4);
+    }
+  }
+  size = ftell(f);
+  fclose(f);
+
+  if(verbose) {
+    fprintf(stderr, "elf2celf: %ld bytes ELF, %ld bytes CELF, "
+	    "%d relocations, %d imported symbols\n",
+	    elfsize, size, nrelocs, imports);
+  }
+  return 0;
+}